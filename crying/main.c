@@ -8,13 +8,14 @@
 #include <stdio.h>
 #include <unistd.h>
 
+#include "../ring/ring_link.h"
+
 #define UART_CH UART0
 #define MSTR 0
 #define HRTBT 1
 #define CRY 2
 #define MTR 3
 
-#define TIMEOUT 20
 #define MAX_PAY 5
 
 // ADC sampling / UI
@@ -25,6 +26,10 @@
 #define P2P_WINDOW_MS 200
 #define P2P_SAMPLES (P2P_WINDOW_MS / TIME_BETWEEN_SAMPLES_MS)
 
+// a subscription ('S') the master has not renewed for this long is dropped; it renews every second, so a master
+// that restarted without streaming (or died) stops the 'C' pushes after three missed renewals
+#define SUB_LAPSE_MS 3000
+
 // Calibration duration (ms)
 #define CAL_BASELINE_MS 3000          // 3 s quiet
 #define CAL_MAX_MS 5000               // 5 s loud playback
@@ -83,43 +88,26 @@ static void draw_line(display_t *d, FontxFile *fx, int x, int y, const char *s,
   displayDrawString(d, fx, x, y, (uint8_t *)s, col);
 }
 
+// the ring's receive/forward thread and its queue of frames for us (ring/ring_link.h)
+static ring_link_t g_link;
+
 // -------- safe exit on Ctrl+C ----------
 static void handle_sigint(int sig __attribute__((unused)))
 {
   displayFillScreen(&g_disp, RGB_BLACK);
   printf("\nExited\n");
   display_destroy(&g_disp);
+  ring_link_stop(&g_link);
+  ring_link_report(&g_link);
   pynq_destroy();
   exit(0);
 }
 
 // -------- uart I/O ----------
-static int timeouted_byte(int ms)
-{
-  int waited = 0;
-  while (waited < ms)
-  {
-    if (uart_has_data(UART_CH))
-      return (int)uart_recv(UART_CH);
-    sleep_msec(1);
-    waited += 1;
-  }
-  return -1;
-}
-
-static int receive_byte(void)
-{
-  return timeouted_byte(TIMEOUT);
-}
-
-// [DST][SRC][LEN][PAYLOAD...]
+// [SYNC][DST][SRC][LEN][PAYLOAD...][CRC8] (ring/ring_frame.h)
 static void send_message(uint8_t dst, uint8_t src, const uint8_t payload[], uint8_t len)
 {
-  uart_send(UART_CH, dst);
-  uart_send(UART_CH, src);
-  uart_send(UART_CH, len);
-  for (int i = 0; i < len; i++)
-    uart_send(UART_CH, payload[i]);
+  ring_link_send(&g_link, dst, src, payload, len);
 }
 
 #define SEND_MESSAGE(dst, src, payload) \
@@ -130,48 +118,16 @@ static uint8_t g_src = 0;
 static uint8_t g_len = 0;
 static uint8_t g_payload[MAX_PAY];
 
+// Non-blocking: takes the next complete frame for us that the ring thread queued (frames for other nodes were
+// already forwarded there). Returns its payload length, -1 if there is none.
 static int receive_message(void)
 {
-  if (!uart_has_data(UART_CH))
+  ring_frame_t f;
+  if (!ring_link_pop(&g_link, &f))
     return -1;
-
-  int b = receive_byte(); // DST
-  if (b < 0) return -1;
-  uint8_t dst = (uint8_t)b;
-
-  b = receive_byte(); // SRC
-  if (b < 0) return -1;
-  uint8_t src = (uint8_t)b;
-
-  b = receive_byte(); // LEN
-  if (b < 0) return -1;
-  uint8_t len = (uint8_t)b;
-
-  // Forward frames not addressed to me
-  if (dst != CRY)
-  {
-    uart_send(UART_CH, dst);
-    uart_send(UART_CH, src);
-    uart_send(UART_CH, len);
-    for (int i = 0; i < len; i++)
-    {
-      int pb = receive_byte();
-      if (pb < 0) return -2;
-      uart_send(UART_CH, (uint8_t)pb);
-    }
-    return 0;
-  }
-
-  if (len > MAX_PAY) len = MAX_PAY;
-
-  for (int i = 0; i < len; i++)
-  {
-    b = receive_byte();
-    if (b < 0) return -3;
-    g_payload[i] = (uint8_t)b;
-  }
-
-  g_src = src;
+  uint8_t len = f.len > MAX_PAY ? MAX_PAY : f.len;
+  memcpy(g_payload, f.pay, len);
+  g_src = f.src;
   g_len = len;
   return (int)g_len;
 }
@@ -200,6 +156,7 @@ static float g_p2p_max    = 0.2f;   // volts (reference max p2p)
 
 static float   g_latest_pct = 0.0f;
 static uint8_t g_latest_cry = 0;
+static uint32_t g_cry_windows = 0; // completed p2p windows, a publication goes out once per new one
 
 // Update windowed peak-to-peak (max-min) and map to %
 static void cry_sampler_update(void)
@@ -233,6 +190,7 @@ static void cry_sampler_update(void)
     float pct = 100.0f * x;
     g_latest_pct = pct;
     g_latest_cry = (uint8_t)(pct + 0.5f);
+    g_cry_windows++;
 
     // reset window
     g_win_min = 10.0f;
@@ -360,6 +318,13 @@ int main(void)
   uart_reset_fifos(UART_CH);
   switchbox_set_pin(IO_AR0, SWB_UART0_RX);
   switchbox_set_pin(IO_AR1, SWB_UART0_TX);
+  // the ring thread reads UART0 from here on, so only once its pins are routed
+  if (ring_link_start(&g_link, UART_CH, CRY, 1) != 0)
+  {
+    printf("ring thread failed to start\n");
+    pynq_destroy();
+    return 1;
+  }
   buttons_init();
   switches_init();
 
@@ -418,6 +383,10 @@ int main(void)
 
   uint32_t last_ui_ms = 0;
   uint32_t tick = 0;
+  int pub_ms = 0;              // publish period the master subscribed to ('S'), 0 = only answer polls
+  uint32_t sub_ms = 0;         // when the subscription was last renewed
+  uint32_t last_pub_ms = 0;
+  uint32_t last_pub_window = 0;
 
   while (1)
   {
@@ -440,6 +409,9 @@ int main(void)
       g_latest_cry = 40;
     }
 
+    // what the master's collect frame picks up as it passes (ring thread)
+    ring_link_fill(&g_link, RING_COLLECT_CRY, g_latest_cry);
+
     // Button 3 = RESTART (long press ~1s)
     // Note: shares button 3 with other uses; short press is ignored here, long press restarts.
     int b3 = get_button_state(3);
@@ -516,12 +488,33 @@ int main(void)
         uint8_t rsp[] = {'C', g_latest_cry};
         SEND_MESSAGE(MSTR, CRY, rsp);
       }
+      else if (cmd == 'S' && g_len >= 2)
+      {
+        // subscription: push 'C' at most every payload[1] * 10 ms from now on (0 stops it)
+        pub_ms = g_payload[1] * 10;
+        sub_ms = now_msec_u32();
+      }
+    }
+
+    // streaming: each finished p2p window goes out once, no faster than the subscribed rate. half a window of
+    // slack, or jitter in when windows finish would skip every other one at a rate of one window
+    uint32_t pub_now = now_msec_u32();
+    if (pub_ms > 0 && (uint32_t)(pub_now - sub_ms) >= SUB_LAPSE_MS)
+      pub_ms = 0; // the master stopped renewing
+    if (pub_ms > 0 && g_cry_windows != last_pub_window &&
+        (uint32_t)(pub_now - last_pub_ms) + P2P_WINDOW_MS / 2 >= (uint32_t)pub_ms)
+    {
+      last_pub_ms = pub_now;
+      last_pub_window = g_cry_windows;
+      uint8_t pub[] = {'C', g_latest_cry};
+      SEND_MESSAGE(MSTR, CRY, pub);
     }
 
     sleep_msec(2);
   }
 
   display_destroy(&g_disp);
+  ring_link_stop(&g_link);
   pynq_destroy();
   return 0;
 }
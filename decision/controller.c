@@ -0,0 +1,1082 @@
+// controller.c — decision algorithm, see controller.h
+// This used to live as statics in main.c. It was moved out unchanged (globals became controller_t fields) so
+// the simulator benchmarks exactly the logic that ships.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller.h"
+
+static void ctrl_log(controller_t *c, const char *fmt, ...)
+{
+  if (!c->hooks.log)
+    return;
+
+  char buf[128];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof buf, fmt, ap);
+  va_end(ap);
+  c->hooks.log(c->hooks.ctx, buf);
+}
+
+void controller_init(controller_t *c, const controller_hooks_t *hooks)
+{
+  memset(c, 0, sizeof *c);
+  c->hooks = *hooks;
+  c->thresholdBPM = 10;
+  c->thresholdCRY = 1;
+  controller_consts_default(&c->consts);
+  c->curA = 4;
+  c->curF = 4;
+  c->lastBPM = -1;
+  c->lastCRY = -1;
+  c->prevA = -1;
+  c->prevF = -1;
+  c->anchorA_mem = -1;
+  c->anchorF_mem = -1;
+  c->algo_start_ms = -1.0;
+  c->thr_lo = -THR_UNBOUNDED;
+  c->thr_hi = THR_UNBOUNDED;
+}
+
+void controller_consts_default(controller_consts_t *k)
+{
+  k->cry_bpm = CRY_REGIME_BPM;
+  k->cry_level = CRY_REGIME_LEVEL;
+  k->jump_bpm = PANIC_JUMP_BPM;
+  k->hb_delay_ms = HEARTBEAT_DELAY;
+  k->cry_delay_ms = CRYING_DELAY;
+  k->conv_delay_ms = CONVERGENCE_DELAY;
+}
+
+void controller_start(controller_t *c)
+{
+  controller_hooks_t hooks = c->hooks;
+  int thrBPM = c->thresholdBPM;
+  int thrCRY = c->thresholdCRY;
+  controller_consts_t consts = c->consts;
+  const controller_policy_t *policy = c->policy;
+  controller_mpc_t *mpc = c->mpc;
+
+  controller_init(c, &hooks);
+  c->thresholdBPM = thrBPM;
+  c->thresholdCRY = thrCRY;
+  c->consts = consts;
+  c->policy = policy;
+  c->mpc = mpc;
+  if (mpc)
+    mpc->started = 0; // the belief starts over on the first step
+  c->prevA = c->curA;
+  c->prevF = c->curF;
+  c->algo_start_ms = c->hooks.now_ms(c->hooks.ctx);
+}
+
+// Map logical cell (A,F) -> motor. The actual amplitude/frequency percentages are the hook's business.
+void controller_command_cell(controller_t *c, int aIndex, int fIndex)
+{
+  if (aIndex < 0)
+    aIndex = 0;
+  if (aIndex > 4)
+    aIndex = 4;
+  if (fIndex < 0)
+    fIndex = 0;
+  if (fIndex > 4)
+    fIndex = 4;
+
+  c->curA = aIndex;
+  c->curF = fIndex;
+
+  c->hooks.command_cell(c->hooks.ctx, aIndex, fIndex);
+  // ---- CALM detection (A1F1 == indices 0,0) ----
+  // We only count calm if we are NOT in panic mode (panic currently forces A1F1).
+  if (!c->calm_reached && !c->panic_mode && c->algo_start_ms >= 0.0 && c->curA == 0 && c->curF == 0)
+  {
+    c->calm_reached = 1;
+    c->calm_elapsed_ms = (int)(c->hooks.now_ms(c->hooks.ctx) - c->algo_start_ms);
+    ctrl_log(c, "[A] CALM reached in %d ms\n", c->calm_elapsed_ms);
+  }
+}
+
+// Run controller step on the intended cadence (4s or 10s)
+int controller_step_period_ms(const controller_t *c)
+{
+  if (c->mpc || c->policy)
+    return c->wait_ms;
+  if (c->hit_wall)
+    return c->consts.conv_delay_ms;
+  if (c->is_crying_activated)
+    return c->consts.cry_delay_ms;
+  return c->consts.hb_delay_ms;
+}
+
+// improvement tests (from sim)
+// the comparison also narrows [thr_lo, thr_hi] to the thresholds that would have given the same answer
+static int bpm_dropped(controller_t *c, int ref, int bpm_now)
+{
+  if (ref <= 0)
+    return 0;
+  int drop = ref - bpm_now;
+  if (drop >= c->thresholdBPM)
+  {
+    if (drop < c->thr_hi)
+      c->thr_hi = drop;
+    return 1;
+  }
+  if (drop + 1 > c->thr_lo)
+    c->thr_lo = drop + 1;
+  return 0;
+}
+
+static int cry_dropped(controller_t *c, int ref, int cry_now)
+{
+  if (cry_now <= c->thresholdCRY)
+    return 1;
+  if (ref > 0 && (ref - cry_now >= c->thresholdCRY))
+    return 1;
+  return 0;
+}
+
+static int heartbeat_improved(controller_t *c, int bpm_now)
+{
+  return bpm_dropped(c, c->lastBPM, bpm_now);
+}
+
+static int crying_improved(controller_t *c, int cry_now)
+{
+  return cry_dropped(c, c->lastCRY, cry_now);
+}
+
+// register anchor cell
+static void register_anchor(controller_t *c, int a, int f)
+{
+  if (a < 0 || a > 4 || f < 0 || f > 4)
+    return;
+
+  if (c->anchorMatrix[a][f] == 0)
+  {
+    c->anchorLevel++;
+    c->anchorMatrix[a][f] = 10 - c->anchorLevel;
+    ctrl_log(c, "[A] set A%d F%d as anchor L%d\n",
+             a + 1, f + 1, c->anchorLevel);
+  }
+}
+
+// POLICY MODE
+// probe the neighbour of the anchor in direction dir (POLICY_LEFT / POLICY_UP)
+static void policy_probe(controller_t *c, int dir, int probe, int crying)
+{
+  int a = c->anchorA_mem, f = c->anchorF_mem;
+  c->lastMoveDir = dir;
+  c->probe = probe;
+  if (dir == POLICY_LEFT)
+  {
+    c->triedLeftFromAnchor = 1;
+    ctrl_log(c, "[P] probe LEFT from A%d F%d\n", a + 1, f + 1);
+    controller_command_cell(c, a, f - 1);
+  }
+  else
+  {
+    c->triedUpFromAnchor = 1;
+    ctrl_log(c, "[P] probe UP from A%d F%d\n", a + 1, f + 1);
+    controller_command_cell(c, a - 1, f);
+  }
+  c->wait_ms = c->policy->wait_ms[crying];
+}
+
+static void policy_step(controller_t *c, int bpm_now, int cry_now)
+{
+  const controller_policy_t *p = c->policy;
+  int crying = (bpm_now < c->consts.cry_bpm && cry_now < c->consts.cry_level); // same regime switch as the hand-written rules
+  c->is_crying_activated = crying;
+
+  if (c->anchorA_mem < 0)
+  {
+    // first call: where we stand is the first anchor
+    c->anchorA_mem = c->curA;
+    c->anchorF_mem = c->curF;
+    register_anchor(c, c->curA, c->curF);
+  }
+  int a = c->anchorA_mem, f = c->anchorF_mem;
+
+  if (c->probe)
+  {
+    int improved = crying ? cry_dropped(c, c->refCRY, cry_now) : bpm_dropped(c, c->refBPM, bpm_now);
+    int other = (c->lastMoveDir == POLICY_LEFT) ? POLICY_UP : POLICY_LEFT;
+    int other_ok = (other == POLICY_LEFT) ? (f > 0 && !c->triedLeftFromAnchor) : (a > 0 && !c->triedUpFromAnchor);
+
+    if (improved)
+    {
+      // the probe becomes the next anchor, carry on from there right away
+      c->anchorA_mem = a = c->curA;
+      c->anchorF_mem = f = c->curF;
+      c->triedLeftFromAnchor = 0;
+      c->triedUpFromAnchor = 0;
+      c->probe = 0;
+      ctrl_log(c, "[P] IMPROVED -> anchor A%d F%d\n", a + 1, f + 1);
+      register_anchor(c, a, f);
+    }
+    else if (c->probe == 1 && other_ok && p->on_fail[a][f] == POLICY_DIAG)
+    {
+      // the anchor vitals are still the reference
+      policy_probe(c, other, 2, crying);
+      return;
+    }
+    else
+    {
+      if (!other_ok)
+      {
+        // both neighbours looked no better: one of them was misjudged, start over on this anchor
+        c->triedLeftFromAnchor = 0;
+        c->triedUpFromAnchor = 0;
+      }
+      ctrl_log(c, "[P] NO IMPROVEMENT -> A%d F%d\n", a + 1, f + 1);
+      controller_command_cell(c, a, f);
+      c->probe = 0;
+      c->lastMoveDir = 0;
+      c->wait_ms = p->wait_ms[crying];
+      return;
+    }
+  }
+
+  // on the anchor: pick the neighbour to probe
+  if (a == 0 && f == 0)
+  {
+    ctrl_log(c, "[P] BABY CALM holding A1 F1\n");
+    c->wait_ms = p->wait_ms[crying];
+    return;
+  }
+
+  int dir;
+  if (a == 0)
+    dir = POLICY_LEFT; // top wall
+  else if (f == 0)
+    dir = POLICY_UP; // left wall
+  else if (c->triedLeftFromAnchor)
+    dir = POLICY_UP;
+  else if (c->triedUpFromAnchor)
+    dir = POLICY_LEFT;
+  else
+    dir = p->first_dir[a][f];
+
+  c->refBPM = bpm_now;
+  c->refCRY = cry_now;
+  policy_probe(c, dir, (c->triedLeftFromAnchor || c->triedUpFromAnchor) ? 2 : 1, crying);
+}
+
+// MPC MODE
+// the belief's plant model is the simulator's (sim/sim.c): a move clamps S into the new cell's band, or panics
+// when the bands do not even touch, and S lands on Sopt of the new K one settle time later. every order sees the
+// same moves, so they all change S at the same moments and share one history clock
+#define MPC_SIGMA_BPM 5.0f // spread of a BPM change around the model's, the bands are only roughly known
+#define MPC_SIGMA_CRY 8.0f
+#define MPC_Z2_CAP 16.0f   // one odd reading costs an order at most this much
+#define MPC_LOGW_FLOOR -30.0f
+#define MPC_TELL 2.0f      // sigmas two predictions of a change must be apart for the vitals to tell them apart
+#define MPC_MARGIN_S 0.5f  // wait this much past the moment a change shows
+
+enum
+{
+  MPC_LEFT,
+  MPC_UP,
+  MPC_BACK,
+  MPC_HOLD,
+  MPC_CANDIDATES
+};
+
+// xorshift32, seeded on the first step so the same vitals always plan the same
+static uint32_t mpc_rand(controller_mpc_t *m)
+{
+  uint32_t x = m->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return m->rng = x;
+}
+
+// e^x for x <= 0 as (1 + x/1024)^1024, the node links without libm
+static float mpc_exp(float x)
+{
+  if (x < -60.0f)
+    return 0.0f;
+  float y = 1.0f + x / 1024.0f;
+  for (int i = 0; i < 10; i++)
+    y *= y;
+  return y;
+}
+
+static float mpc_cry_of(float S)
+{
+  float c = MPC_CRY_BASE + MPC_CRY_PER_S * S;
+  return c < 0.0f ? 0.0f : (c > 100.0f ? 100.0f : c);
+}
+
+// K of every cell for one LEFT/UP order (bit i set = step i goes UP), filled in like scenario_build() does
+static void mpc_build_k(controller_mpc_t *m, int h, unsigned path)
+{
+  int k[5][5] = {{0}};
+  int a = 4, f = 4;
+  k[4][4] = 9;
+  m->on_path[h] = 1u << 24;
+  for (int i = 0; i < 8; i++)
+  {
+    if (path >> i & 1u)
+      a--;
+    else
+      f--;
+    k[a][f] = 8 - i;
+    m->on_path[h] |= 1u << (a * 5 + f);
+  }
+  for (a = 4; a >= 0; a--)
+    for (f = 4; f >= 0; f--)
+      if (k[a][f] == 0 && f < 4 && k[a][f + 1] > 1)
+        k[a][f] = k[a][f + 1];
+  for (a = 4; a >= 0; a--)
+    for (f = 4; f >= 0; f--)
+      if (k[a][f] == 0 && a < 4 && k[a + 1][f] > 1)
+        k[a][f] = k[a + 1][f];
+  for (int c = 0; c < 25; c++)
+    m->K[h][c] = (uint8_t)(k[c / 5][c % 5] ? k[c / 5][c % 5] : 1);
+}
+
+// Sopt evenly from s9 down to MPC_SOPT1, bands of half-width half[k] (NULL = the middle of the draw), and the
+// upper edge stretched to the next Sopt like the cradle does
+static void mpc_set_bands(mpc_bands_t *b, float s9, const uint8_t *half)
+{
+  for (int k = 1; k <= 9; k++)
+  {
+    float w = half ? half[k] : 0.5f * (MPC_HALF_MIN + MPC_HALF_MAX);
+    b->sopt[k] = MPC_SOPT1 + (s9 - MPC_SOPT1) * (k - 1) / 8.0f;
+    b->lo[k] = b->sopt[k] - w < 0.0f ? 0.0f : b->sopt[k] - w;
+    b->hi[k] = b->sopt[k] + w > 100.0f ? 100.0f : b->sopt[k] + w;
+  }
+  for (int k = 2; k <= 9; k++)
+    if (b->hi[k - 1] < b->sopt[k])
+      b->hi[k - 1] = b->sopt[k];
+}
+
+static void mpc_plant_advance(mpc_plant_t *p, const mpc_bands_t *b, float t)
+{
+  if (p->converge_at >= 0.0f && p->converge_at <= t)
+  {
+    p->S = b->sopt[p->k];
+    p->converge_at = -1.0f;
+  }
+  p->t = t;
+}
+
+// sim_move_kind() and move_to_cell() on the model
+static void mpc_plant_move(mpc_plant_t *p, const mpc_bands_t *b, const uint8_t *K, int a, int f, float conv_s)
+{
+  int k = K[a * 5 + f], old = p->k;
+  int softer = (a < p->a || f < p->f), harder = (a > p->a || f > p->f);
+  int inside = (p->S >= b->lo[k] && p->S <= b->hi[k]);
+  int apart = (b->hi[old] < b->lo[k] || b->lo[old] > b->hi[k]);
+  p->a = (uint8_t)a;
+  p->f = (uint8_t)f;
+  p->k = (uint8_t)k;
+  if (!inside && apart && softer != harder)
+  {
+    p->S = b->sopt[9];
+    p->converge_at = -1.0f;
+    p->panicked = 1;
+    return;
+  }
+  if (p->S < b->lo[k])
+    p->S = b->lo[k];
+  if (p->S > b->hi[k])
+    p->S = b->hi[k];
+  p->converge_at = p->t + conv_s;
+}
+
+static void mpc_record(controller_mpc_t *m, float t)
+{
+  int i = m->hist_n++ % MPC_HIST;
+  m->hist_t[i] = t;
+  for (int h = 0; h < MPC_PATHS; h++)
+    m->hist_s[h][i] = m->plant[h].S;
+}
+
+// history slot holding S at time t: the newest change at or before t (the oldest one kept if t is older still)
+static int mpc_slot(const controller_mpc_t *m, float t)
+{
+  int n = m->hist_n < MPC_HIST ? m->hist_n : MPC_HIST;
+  int i = 0;
+  for (int j = 1; j <= n; j++)
+  {
+    i = (m->hist_n - j) % MPC_HIST;
+    if (m->hist_t[i] <= t)
+      break;
+  }
+  return i;
+}
+
+// land the convergences due by t on every order
+static void mpc_advance(controller_mpc_t *m, float t)
+{
+  for (;;)
+  {
+    float due = -1.0f;
+    for (int h = 0; h < MPC_PATHS; h++)
+    {
+      float ca = m->plant[h].converge_at;
+      if (ca >= 0.0f && ca <= t && (due < 0.0f || ca < due))
+        due = ca;
+    }
+    if (due < 0.0f)
+      break;
+    for (int h = 0; h < MPC_PATHS; h++)
+      if (m->plant[h].converge_at == due)
+        mpc_plant_advance(&m->plant[h], &m->bands, due);
+    mpc_record(m, due);
+  }
+  for (int h = 0; h < MPC_PATHS; h++)
+    m->plant[h].t = t;
+}
+
+static void mpc_start(controller_mpc_t *m, int bpm, float t, int a, int f)
+{
+  // the heartbeat still shows the stress from before the session, Sopt of K9
+  float s9 = bpm > 0 ? (bpm - MPC_BPM_BASE) / MPC_BPM_PER_S : 85.0f;
+  if (s9 < MPC_SOPT1 + 8.0f)
+    s9 = MPC_SOPT1 + 8.0f;
+  if (s9 > 100.0f)
+    s9 = 100.0f;
+  m->started = 1;
+  m->rng = 0x9E3779B9u;
+  mpc_set_bands(&m->bands, s9, NULL);
+  int h = 0;
+  for (unsigned path = 0; path < 256; path++)
+  {
+    if (__builtin_popcount(path) != 4)
+      continue;
+    mpc_build_k(m, h, path);
+    m->logw[h] = 0.0f;
+    m->plant[h] = (mpc_plant_t){t, s9, -1.0f, (uint8_t)a, (uint8_t)f, m->K[h][a * 5 + f], 0};
+    h++;
+  }
+  m->hist_n = 0;
+  mpc_record(m, t - 1000.0f);
+  m->obs_n = 0;
+  m->last_update = t;
+}
+
+// reweight the orders by how well each predicts what the vitals did over the last window. changes, not levels:
+// the true Sopt are only roughly where the model puts them, but a step between K levels is 7 or more either way
+static void mpc_observe(controller_mpc_t *m, int bpm, int cry, float t, float tau)
+{
+  int i = m->obs_n++ % MPC_OBS;
+  m->obs_t[i] = t;
+  m->obs_bpm[i] = (int16_t)bpm;
+  m->obs_cry[i] = (int16_t)cry;
+
+  int n = m->obs_n < MPC_OBS ? m->obs_n : MPC_OBS, j = -1;
+  float w_s = MPC_WINDOW_MS / 1000.0f;
+  for (int back = 2; back <= n; back++)
+  {
+    int k = (m->obs_n - back) % MPC_OBS;
+    if (m->obs_t[k] <= t - w_s)
+    {
+      j = k;
+      break;
+    }
+  }
+  if (j < 0)
+    return;
+
+  // overlapping windows see the same change several times, each step only counts for its share
+  float frac = (t - m->last_update) / w_s;
+  if (frac > 1.0f)
+    frac = 1.0f;
+  m->last_update = t;
+
+  float tj = m->obs_t[j];
+  int hb_now = mpc_slot(m, t - tau), hb_then = mpc_slot(m, tj - tau);
+  int cr_now = mpc_slot(m, t), cr_then = mpc_slot(m, tj);
+  float d_bpm = (float)(bpm - m->obs_bpm[j]), d_cry = (float)(cry - m->obs_cry[j]);
+  float best = -1e30f;
+  for (int h = 0; h < MPC_PATHS; h++)
+  {
+    float eb = (d_bpm - MPC_BPM_PER_S * (m->hist_s[h][hb_now] - m->hist_s[h][hb_then])) / MPC_SIGMA_BPM;
+    float ec = (d_cry - (mpc_cry_of(m->hist_s[h][cr_now]) - mpc_cry_of(m->hist_s[h][cr_then]))) / MPC_SIGMA_CRY;
+    float z2 = eb * eb + ec * ec;
+    m->logw[h] -= 0.5f * frac * (z2 < MPC_Z2_CAP ? z2 : MPC_Z2_CAP);
+    if (m->logw[h] > best)
+      best = m->logw[h];
+  }
+  for (int h = 0; h < MPC_PATHS; h++)
+  {
+    m->logw[h] -= best;
+    if (m->logw[h] < MPC_LOGW_FLOOR)
+      m->logw[h] = MPC_LOGW_FLOOR;
+  }
+}
+
+// spread of what the likely orders predict for one change, in the sensor's units
+static int mpc_disagree(const float *lo_hi, float sigma)
+{
+  return lo_hi[1] - lo_hi[0] > MPC_TELL * sigma;
+}
+
+static void mpc_spread(float *lo_hi, float d)
+{
+  if (d < lo_hi[0])
+    lo_hi[0] = d;
+  if (d > lo_hi[1])
+    lo_hi[1] = d;
+}
+
+// the next moment the vitals can tell the likely orders apart: a convergence still to land (the crying node sees
+// it at once, the heartbeat TAU later) or a change less than TAU ago. < 0 if nothing is coming
+static float mpc_next_info(const controller_mpc_t *m, const float *w, float t, float tau)
+{
+  float next = -1.0f;
+  float cry[2] = {1e9f, -1e9f}, hb[2] = {1e9f, -1e9f}, due = -1.0f;
+  for (int h = 0; h < MPC_PATHS; h++)
+  {
+    if (w[h] < 0.01f)
+      continue;
+    const mpc_plant_t *p = &m->plant[h];
+    float to = p->converge_at >= 0.0f ? m->bands.sopt[p->k] : p->S;
+    if (p->converge_at >= 0.0f)
+      due = p->converge_at;
+    mpc_spread(cry, mpc_cry_of(to) - mpc_cry_of(p->S));
+    mpc_spread(hb, to - p->S);
+  }
+  if (due >= 0.0f && mpc_disagree(cry, MPC_SIGMA_CRY))
+    next = due;
+  else if (due >= 0.0f && mpc_disagree(hb, MPC_SIGMA_BPM / MPC_BPM_PER_S))
+    next = due + tau;
+
+  int n = m->hist_n < MPC_HIST ? m->hist_n : MPC_HIST;
+  for (int j = 1; j < n; j++)
+  {
+    int i = (m->hist_n - j) % MPC_HIST, prev = (m->hist_n - j - 1) % MPC_HIST;
+    float shows = m->hist_t[i] + tau;
+    if (shows <= t)
+      break;
+    float d[2] = {1e9f, -1e9f};
+    for (int h = 0; h < MPC_PATHS; h++)
+      if (w[h] >= 0.01f)
+        mpc_spread(d, m->hist_s[h][i] - m->hist_s[h][prev]);
+    if (mpc_disagree(d, MPC_SIGMA_BPM / MPC_BPM_PER_S) && (next < 0.0f || shows < next))
+      next = shows;
+  }
+  return next;
+}
+
+// what a rollout's agent starts out knowing: what the belief is sure of, and where it leans
+typedef struct
+{
+  uint32_t known_on, known_off; // cells the belief is sure are on / off the path
+  int anchor;                   // newest cell known to be on the path, where a failed probe goes back to
+  float t_know;                 // when the current cell's verdict shows if we stay
+  float left[25];               // P(the path goes LEFT from a cell | the cell is on it)
+  float tau, conv;
+} mpc_ctx_t;
+
+// one move from cell c towards the harder cell to, through the softer of the two ways by K
+static int mpc_toward(int c, int to, const uint8_t *K)
+{
+  int a = c / 5, f = c % 5;
+  int right = (f < to % 5) ? c + 1 : -1, down = (a < to / 5) ? c + 5 : -1;
+  if (right >= 0 && down >= 0)
+    return K[down] < K[right] ? down : right;
+  if (right >= 0 || down >= 0)
+    return right >= 0 ? right : down;
+  return (f > to % 5) ? c - 1 : c - 5;
+}
+
+// the move from c to cell (-1 = none) brings it nearer to cell to
+static int mpc_closer(int cell, int c, int to)
+{
+  if (cell < 0)
+    return 0;
+  return abs(cell / 5 - to / 5) + abs(cell % 5 - to % 5) < abs(c / 5 - to / 5) + abs(c % 5 - to % 5);
+}
+
+// move a fork to a cell. returns when the agent learns whether that cell is on the path: once S settles, seen
+// at once by the crying node if a level down shows there, else by the heartbeat TAU later. now if it knew already
+static float mpc_agent_move(mpc_plant_t *p, const mpc_bands_t *b, const uint8_t *K, int cell, uint32_t known,
+                            const mpc_ctx_t *x)
+{
+  float down = b->sopt[p->k > 1 ? p->k - 1 : 1];
+  int quick = mpc_cry_of(p->S) - mpc_cry_of(down) > MPC_TELL * MPC_SIGMA_CRY;
+  mpc_plant_move(p, b, K, cell / 5, cell % 5, x->conv);
+  if (known >> cell & 1u)
+    return p->t;
+  return p->converge_at + (quick ? 0.0f : x->tau) + MPC_MARGIN_S;
+}
+
+// fork order h's plant, play the first action (a cell, or -1 = hold for hold_s), then let an agent that only
+// learns the order through the vitals walk it home: probe, wait for the verdict, go on or go back to the anchor.
+// the order's truth only decides what the verdicts say. seconds until A1F1 is commanded, MPC_PANIC_S more if
+// the baby panics on the way
+static float mpc_rollout(const controller_mpc_t *m, int h, const mpc_bands_t *b, const mpc_ctx_t *x, int cell,
+                         float hold_s)
+{
+  mpc_plant_t p = m->plant[h];
+  uint32_t on = m->on_path[h], known = x->known_on | x->known_off;
+  int anchor = x->anchor, c = p.a * 5 + p.f;
+  int back = (x->known_off >> c & 1u) && mpc_closer(cell, c, anchor); // still on the way back to the anchor
+  float t0 = p.t, dt = MPC_STEP_MS / 1000.0f, t_know = x->t_know;
+  if (cell < 0)
+    mpc_plant_advance(&p, b, t0 + hold_s);
+  else
+    t_know = mpc_agent_move(&p, b, m->K[h], cell, known, x); // leaving early loses the verdict of the cell left
+
+  for (int n = 0; n < 64 && !p.panicked; n++)
+  {
+    int next;
+    c = p.a * 5 + p.f;
+    if (c == 0)
+      return p.t - t0;
+    if (back && c == anchor)
+      back = 0;
+    if (!back && !(known >> c & 1u))
+    {
+      if (t_know > p.t)
+        mpc_plant_advance(&p, b, t_know);
+      known |= 1u << c;
+    }
+    if (!back && (on >> c & 1u))
+    {
+      anchor = c;
+      int l = (c % 5) ? c - 1 : -1, u = (c >= 5) ? c - 5 : -1;
+      if (l < 0 || u < 0)
+        next = (l >= 0) ? l : u;
+      else if (known >> l & 1u)
+        next = (on >> l & 1u) ? l : u;
+      else if (known >> u & 1u)
+        next = (on >> u & 1u) ? u : l;
+      else
+        next = (x->left[c] >= 0.5f) ? l : u;
+    }
+    else
+    {
+      // off the path: walk back to the anchor without judging the cells on the way
+      back = 1;
+      next = mpc_toward(c, anchor, m->K[h]);
+    }
+    mpc_plant_advance(&p, b, p.t + dt);
+    t_know = mpc_agent_move(&p, b, m->K[h], next, known, x);
+  }
+  if (!p.panicked && p.a == 0 && p.f == 0)
+    return p.t - t0;
+  return p.t - t0 + MPC_PANIC_S;
+}
+
+static void mpc_step(controller_t *c, int bpm_now, int cry_now)
+{
+  static const char *names[MPC_CANDIDATES] = {"LEFT", "UP", "BACK", "HOLD"};
+  controller_mpc_t *m = c->mpc;
+  float t = (float)((c->hooks.now_ms(c->hooks.ctx) - c->algo_start_ms) / 1000.0);
+  float tau = c->consts.hb_delay_ms / 1000.0f, conv = c->consts.conv_delay_ms / 1000.0f;
+  c->is_crying_activated = (bpm_now < c->consts.cry_bpm && cry_now < c->consts.cry_level);
+  c->lastMoveDir = 0;
+  c->wait_ms = MPC_STEP_MS;
+
+  if (!m->started)
+    mpc_start(m, bpm_now, t, c->curA, c->curF);
+  mpc_advance(m, t);
+  mpc_observe(m, bpm_now, cry_now, t, tau);
+
+  float w[MPC_PATHS], total = 0.0f, p_on[25] = {0}, p_left[25] = {0}, k_sum[25] = {0};
+  int cur = c->curA * 5 + c->curF;
+  for (int h = 0; h < MPC_PATHS; h++)
+  {
+    w[h] = mpc_exp(m->logw[h]);
+    total += w[h];
+  }
+  for (int h = 0; h < MPC_PATHS; h++)
+  {
+    w[h] /= total;
+    for (int i = 0; i < 25; i++)
+    {
+      k_sum[i] += w[h] * m->K[h][i];
+      if (m->on_path[h] >> i & 1u)
+      {
+        p_on[i] += w[h];
+        if (i % 5 && (m->on_path[h] >> (i - 1) & 1u))
+          p_left[i] += w[h];
+      }
+    }
+  }
+
+  // what the rollouts' agent knows going in
+  float info = mpc_next_info(m, w, t, tau);
+  mpc_ctx_t x = {0, 0, 0, t, {0}, tau, conv};
+  uint8_t k_mean[25];
+  for (int i = 0; i < 25; i++)
+  {
+    k_mean[i] = (uint8_t)(k_sum[i] + 0.5f);
+    if (p_on[i] > 0.95f)
+      x.known_on |= 1u << i;
+    else if (p_on[i] < 0.05f)
+      x.known_off |= 1u << i;
+    x.left[i] = p_on[i] > 0.0f ? p_left[i] / p_on[i] : 0.5f;
+  }
+  if (x.known_on >> cur & 1u)
+  {
+    register_anchor(c, c->curA, c->curF);
+    c->anchorA_mem = c->curA;
+    c->anchorF_mem = c->curF;
+  }
+  else if (!(x.known_off >> cur & 1u) && info > t)
+    x.t_know = info;
+  x.anchor = c->anchorA_mem * 5 + c->anchorF_mem;
+
+  if (cur == 0)
+  {
+    ctrl_log(c, "[M] BABY CALM holding A1 F1\n");
+    return;
+  }
+
+  // candidates: the two softer neighbours, a step back towards the anchor (re-probing from there is a clean
+  // experiment), and waiting for the next telling reading. never into a cell known to be off the path unless on the
+  // way back, and never back off a cell before its verdict is in: stepping away cancels the settle that would tell
+  int target[MPC_CANDIDATES] = {-1, -1, -1, -1};
+  if (c->curF > 0)
+    target[MPC_LEFT] = cur - 1;
+  if (c->curA > 0)
+    target[MPC_UP] = cur - 5;
+  if (((x.known_off >> cur & 1u) || (!(x.known_on >> cur & 1u) && info <= t)) && x.anchor != cur)
+    target[MPC_BACK] = mpc_toward(cur, x.anchor, k_mean);
+  for (int i = MPC_LEFT; i <= MPC_UP; i++)
+    if (target[i] >= 0 && (x.known_off >> target[i] & 1u))
+      target[i] = -1;
+  float hold_s = info > t ? info - t + MPC_MARGIN_S : 0.0f;
+  if (hold_s > 0.0f && hold_s < MPC_STEP_MS / 1000.0f)
+    hold_s = MPC_STEP_MS / 1000.0f;
+
+  // the same sampled order and bands for every candidate, so they differ by the move and not by the draw
+  float cost[MPC_CANDIDATES] = {0};
+  for (int r = 0; r < MPC_ROLLOUTS; r++)
+  {
+    float u = (mpc_rand(m) >> 8) / 16777216.0f, acc = 0.0f;
+    int h = 0;
+    for (; h < MPC_PATHS - 1; h++)
+    {
+      acc += w[h];
+      if (u < acc)
+        break;
+    }
+    uint8_t half[10];
+    for (int k = 1; k <= 9; k++)
+      half[k] = (uint8_t)(MPC_HALF_MIN + mpc_rand(m) % (MPC_HALF_MAX - MPC_HALF_MIN + 1));
+    mpc_bands_t b;
+    mpc_set_bands(&b, m->bands.sopt[9], half);
+
+    for (int i = 0; i < MPC_CANDIDATES; i++)
+    {
+      if (i == MPC_HOLD && hold_s > 0.0f)
+        cost[i] += mpc_rollout(m, h, &b, &x, -1, hold_s);
+      else if (i != MPC_HOLD && target[i] >= 0)
+        cost[i] += mpc_rollout(m, h, &b, &x, target[i], 0.0f);
+    }
+  }
+
+  int best = -1;
+  for (int i = 0; i < MPC_CANDIDATES; i++)
+  {
+    int ok = (i == MPC_HOLD) ? hold_s > 0.0f : target[i] >= 0;
+    if (ok && (best < 0 || cost[i] < cost[best]))
+      best = i;
+  }
+  if (best < 0)
+    return; // nowhere to go and nothing to wait for, cannot happen off A1F1
+  ctrl_log(c, "[M] %s from A%d F%d, %.0f s to calm expected (on path %.2f)\n", names[best], c->curA + 1,
+           c->curF + 1, cost[best] / MPC_ROLLOUTS, p_on[cur]);
+
+  if (best == MPC_HOLD)
+  {
+    c->wait_ms = (int)(hold_s * 1000.0f);
+    return;
+  }
+  int to = target[best];
+  c->prevA = c->curA;
+  c->prevF = c->curF;
+  c->lastMoveDir = (best == MPC_LEFT) ? POLICY_LEFT : (best == MPC_UP) ? POLICY_UP : 0;
+  controller_command_cell(c, to / 5, to % 5);
+  for (int h = 0; h < MPC_PATHS; h++)
+    mpc_plant_move(&m->plant[h], &m->bands, m->K[h], to / 5, to % 5, conv);
+  mpc_record(m, t);
+}
+
+// One controller step for
+// This function is called every control cycle with the latest BPM and CRY and decides what to command on the motor grid.
+// Yes this is extensively documented so that everyone can understand. Yes including me.
+// bpm_now is the current heartbeat in BPM, cry_now is the current crying level (%) both are measured by the submodules, hopefully.
+void controller_step(controller_t *c, int bpm_now, int cry_now)
+{
+  c->hit_wall = 0; // Detector flag for (AxF1 or A1Fx so we can be smart and reduce the delay to just the convergence time)
+
+  // PANIC DETECTION USING VITALS
+  // In this part we look only at BPM and CRY and decide whether the baby is in a panic state and we must enter panic_mode.
+  // This matters because if we are in panic mode we need to go to K9 to start again. Currently the motors stop for testing purposes
+
+  int big_jump = 0; // This variable will be set to 1 if the BPM suddenly jumps up a lot compared to the previous BPM
+
+  if (c->lastBPM > 0)                        // We only check for a BPM jump if we have a valid previous BPM
+    big_jump = (bpm_now - c->lastBPM >= c->consts.jump_bpm); // Here we compute the difference between current BPM and last BPM, and set big_jump to 1 if the increase is 30 BPM (jump_bpm) or more.
+
+  if (!c->panic_mode) // We only re-check panic conditions if we are not already in panic mode; once in panic, we stay there until its reseted somehow (not implement rk).
+  {
+    if (big_jump) // If any of our panic flags are true, panic.
+    {
+      c->panic_mode = 1; // We now enter panic mode, meaning that the rest of this function will follow the panic-mode path instead of the normal algorithm.
+
+      ctrl_log(c, "[A] PANIC(BPM=%d, CRY=%d)\n", bpm_now, cry_now); // We log a message so we can see exactly when and with what values the panic was triggered.
+    }
+  }
+
+  // PANIC MODE: FREEZE MOTORS (Currently)
+  // When panic_mode is active, we stop exploring the (A, F) grid and keep the cradle in a fixed safe motor state.
+
+  if (c->panic_mode)
+  {
+    controller_command_cell(c, 0, 0); // We command the cell at indices (A=0, F=0)
+
+    c->lastBPM = bpm_now; // We still update lastBPM to the current BPM so history and logs remain up to date even during panic.
+    c->lastCRY = cry_now; // We also update lastCRY to the current crying level for the same reason.
+    return;                 // We leave the function early because, in panic mode, we do not want to run the normal inverse-model algorithm anymore.
+  }
+
+  // MPC MODE: plan with the plant model instead
+  if (c->mpc)
+  {
+    mpc_step(c, bpm_now, cry_now);
+    c->lastBPM = bpm_now;
+    c->lastCRY = cry_now;
+    return;
+  }
+
+  // POLICY MODE: the offline table decides instead of the rules below
+  if (c->policy)
+  {
+    policy_step(c, bpm_now, cry_now);
+    c->lastBPM = bpm_now;
+    c->lastCRY = cry_now;
+    return;
+  }
+
+  // NORMAL MODE: CHECK WHETHER THE LAST MOVE HELPED OR NOT
+  // Since we are not in panic, we now look at whether the last motor command improved the baby’s state.
+
+  int improved = 0; // This will be set to 1 if the helper functions say that the situation actually got better after the last move.
+  int same = 0;     // This will be set to 1 if the situation is considered stable
+
+  if (bpm_now < c->consts.cry_bpm && cry_now < c->consts.cry_level) // If the current BPM is below 150 (cry_bpm), we stop using heart rate as its delayed and focus more on crying as an indicator of stress.
+  {
+    c->is_crying_activated = 1;             // We record that in this regime we are using crying as the primary signal to measure improvement.
+    improved = crying_improved(c, cry_now); // We call crying_improved with the current CRY value. returns 1 if crying suggests improvement.
+  }
+  else // If BPM is 150 or higher, the heart rate is used since crying is always %100 here
+  {
+    c->is_crying_activated = 0;                // We record that, in this regime, we are using BPM as the primary indicator of improvement.
+    improved = heartbeat_improved(c, bpm_now); // We call heartbeat_improved with the current BPM value. returns 1 if BPM suggests improvement
+  }
+
+  if (c->lastBPM > 0) // We  attempt a “stability” check (if we have a valid previous BPM value otherwise we cannot compare)
+  {
+    int bpm_delta = abs(bpm_now - c->lastBPM);                           // We calculate the absolute value of the difference between current BPM and last BPM to see how much it changed.
+    int cry_delta = (c->lastCRY >= 0) ? abs(cry_now - c->lastCRY) : 0; // For CRY, we do a similar absolute difference if we have a valid previous value; otherwise we treat it as zero change.
+
+    if (!c->is_crying_activated) // If we are currently in BPM-driven mode (using BPM to decide improvement),
+    {
+      if (bpm_delta <= 3) // then we consider the state “stable” if BPM changed by at most 3 beats since the last step.
+      {
+        ctrl_log(c, "[A] HB stable Del(BPM)=%d\n", bpm_delta);
+        if (c->lastMoveDir == 1) // If the last move we made on the grid was a LEFT move (direction 1),
+          same = 1;           // we set same to 1, meaning we have a “stable after LEFT” pattern that we will react to with a special move i call reverse diagonal later.
+      }
+    }
+    else // If we are in crying-driven mode (using CRY to decide improvement),
+    {
+      if (cry_delta == 0) // we treat the situation as stable only if crying did not change at all (difference equals zero).
+      {
+        ctrl_log(c, "[A] CRY stable ΔCRY=%d\n", cry_delta); // We log that the crying level is stable and show the CRY difference (which is zero here).
+        if (c->lastMoveDir == 1)                              // Again, this only matters if the last move direction was LEFT,
+          same = 1;                                        // so we set same to 1 in that case to remember the “stable after LEFT” condition.
+      }
+    }
+  }
+
+  // ANCHOR SYNC WHEN IDLE (lastMoveDir == 0)
+  // Anchors are positions on the grid that we know are in the solution path
+  // when idle we make sure our stored anchor matches our current position.
+
+  if (c->lastMoveDir == 0) // If lastMoveDir is 0, it means we are not in the middle of a move and are sitting on some anchor position.
+  {
+    if (c->anchorA_mem != c->curA || c->anchorF_mem != c->curF) // If the anchor stored in memory does not match our current (curA, curF) on the grid,
+    {
+      c->anchorA_mem = c->curA;      // we update the stored anchor amplitude index to the current A index.
+      c->anchorF_mem = c->curF;      // we also update the stored anchor frequency index to the current F index.
+      c->triedLeftFromAnchor = 0; // We reset the flag indicating whether we have tried going LEFT from this anchor, so it becomes allowed again.
+      c->triedUpFromAnchor = 0;   // We also reset the flag indicating whether we have tried going UP from this anchor.
+
+      register_anchor(c, c->anchorA_mem, c->anchorF_mem); // We call register_anchor to tell the rest of the system that (curA, curF) is now our chosen anchor cell.
+      // this will later be used to follow a predetermined path to solution if a panic jump is caused to save time
+    }
+  }
+
+  // FIRST MOVE FROM AN ANCHOR (when lastMoveDir == 0)
+  // From an anchor, the algorithm chooses which neighbour to explore first (LEFT or UP).
+
+  if (c->lastMoveDir == 0) // We are in the idle state, so now we decide the first exploration step from this anchor.
+  {
+    c->prevA = c->curA; // We store the current amplitude index as prevA, so we can return here later if needed.
+    c->prevF = c->curF; // We also store the current frequency index as prevF for the same reason.
+    if (!c->triedLeftFromAnchor && c->curF == 0)
+    {
+      c->hit_wall = 1; // wanted to try LEFT but wall
+      controller_command_cell(c, c->curA - 1, c->curF);
+      ctrl_log(c, "[A] Hit left wall\n");
+    }
+    else if (!c->triedUpFromAnchor && c->curA == 0)
+    {
+      c->hit_wall = 1; // wanted to try UP but wall
+      controller_command_cell(c, c->curA, c->curF - 1);
+      ctrl_log(c, "[A] Hit upper wall\n");
+    }
+    // just to be sure we still check vitals after we hit a wall instead of just going down.
+
+    else if (!c->triedLeftFromAnchor && c->curF > 0) // If we have not already tried going LEFT from this anchor and we are not at the left border of the grid (F > 0),
+    {
+      c->lastMoveDir = 1;         // We set lastMoveDir to 1 to remember that we are now making a LEFT move.
+      c->triedLeftFromAnchor = 1; // We also mark that from this anchor, LEFT has now been attempted, so we do not retry it immediately later.
+
+      ctrl_log(c, "[A] TRY-> LEFT from A%d F%d\n", c->curA + 1, c->curF + 1);
+
+      controller_command_cell(c, c->curA, c->curF - 1); // We send the actual motor command to move to the cell with the same A index and F index decreased by one (one step LEFT on the grid).
+
+      c->lastBPM = bpm_now; // After issuing the command, we record the current BPM so that next time we can compare and see if there was improvement.
+      c->lastCRY = cry_now; // We also record the current CRY for the same comparison on the next step.
+      return;                 // We return immediately, because we want to wait and see how this LEFT move changes the baby’s vitals before doing anything else.
+    }
+    else if (!c->triedUpFromAnchor && c->curA > 0) // If LEFT is not available or already tried, but we have not tried UP and we are not at the top row (A > 0),
+    {
+      c->lastMoveDir = 2;       // We set lastMoveDir to 2 to indicate that our next move is an UP move.
+      c->triedUpFromAnchor = 1; // We mark that from this anchor, UP has been attempted, to avoid repeating it unnecessarily.
+
+      ctrl_log(c, "[A] Blocked-> UP from A%d F%d\n", c->curA + 1, c->curF + 1); // We log that our TRY move from this anchor is UP, and note that LEFT was already tried or blocked.
+
+      controller_command_cell(c, c->curA - 1, c->curF); // We send the motor command to move to the neighbour above, which has A index decreased by one and the same F index.
+
+      c->lastBPM = bpm_now; // We store the BPM we saw before this UP move so that we can check later if it improved things.
+      c->lastCRY = cry_now; // We also store the CRY level for the same reason.
+      return;                 // We return here, again to wait for the effect of this UP move on the vitals.
+    }
+    else if (c->curA + 1 == 1 && c->curF + 1 == 1) // If neither LEFT nor UP is available (or both have already been tried from this anchor),
+    {
+      ctrl_log(c, "[A] BABY CALM holding A%d F%d\n", c->curA + 1, c->curF + 1);
+
+      c->lastBPM = bpm_now; // Even though we are not moving, we still update the last BPM value to what we just measured.
+      c->lastCRY = cry_now; // And we also update the last CRY value.
+      return;                 // We exit the function while staying at this anchor, just monitoring the baby’s state.
+    }
+    else // If neither LEFT nor UP is available (or both have already been tried from this anchor),
+    {
+      ctrl_log(c, "[A] Fatal Error! holding A%d F%d\n", c->curA + 1, c->curF + 1);
+
+      c->lastBPM = bpm_now; // Even though we are not moving, we still update the last BPM value to what we just measured.
+      c->lastCRY = cry_now; // And we also update the last CRY value.
+      return;                 // We exit the function while staying at this anchor, just monitoring the baby’s state.
+    }
+  }
+
+  // WE HAVE A LAST MOVE (lastMoveDir != 0) // If we reach here, it means we are returning after having commanded a move in the previous step.
+
+  if (improved) // If the helper functions said that the last move improved the situation,
+  {
+    int anchorA = c->curA; // We now treat the current A index (where we ended up) as a new anchor amplitude index.
+    int anchorF = c->curF; // We also treat the current F index as a new anchor frequency index.
+
+    ctrl_log(c, "[A] IMPROVED -> anchor A%d F%d\n", anchorA + 1, anchorF + 1);
+
+    register_anchor(c, anchorA, anchorF); // We tell the anchor-management logic that this cell (anchorA, anchorF) should be added or updated as an anchor on the path.
+
+    if (c->anchorA_mem != anchorA || c->anchorF_mem != anchorF) // If our remembered anchor position does not yet match this new anchor,
+    {
+      c->anchorA_mem = anchorA;   // we store the new anchor amplitude index in anchorA_mem.
+      c->anchorF_mem = anchorF;   // and the new anchor frequency index in anchorF_mem.
+      c->triedLeftFromAnchor = 0; // We reset the “tried left” flag, because this is a fresh anchor and we can try LEFT from it again.
+      c->triedUpFromAnchor = 0;   // We also reset the “tried up” flag for the same reason.
+    }
+
+    c->prevA = anchorA; // We also store this anchor as prevA so that, if future moves fail, we can backtrack to it.
+    c->prevF = anchorF; // And we store it as prevF for backtracking in frequency.
+
+    if (anchorF > 0) // If we are not at the left border, we can try going further LEFT from this new anchor.
+    {
+      c->lastMoveDir = 1;         // We set the last move direction to LEFT again, as we are planning a follow-up LEFT move.
+      c->triedLeftFromAnchor = 1; // We mark that LEFT has been tried from this anchor so we do not keep repeating it forever.
+
+      ctrl_log(c, "[A] IMPROVED-> LEFT from A%d F%d\n", anchorA + 1, anchorF + 1); // We log that, because the last move was good, we are going to continue exploring by moving LEFT from this new anchor.
+
+      controller_command_cell(c, anchorA, anchorF - 1); // We command the motor module to move to the cell one step LEFT of the current anchor position.
+      // we can shorten delays if borders are hit since there is only going to remain one path to solution so we wouldnt need to wait for the whole heartbeat delay and just the convergence delay. I just dont think this will happen.
+    }
+    else if (anchorA > 0) // Otherwise, if LEFT is impossible but we can still move UP (not at top boundary),
+    {
+      c->lastMoveDir = 2; // We set the next move direction to UP.
+      // Note: we do not mark triedUpFromAnchor here, but we could if we want symmetric behaviour.
+
+      ctrl_log(c, "[A] IMPROVED-> try UP from A%d F%d\n", anchorA + 1, anchorF + 1); // We log that we improved and now we will try moving UP from this anchor instead.
+
+      controller_command_cell(c, anchorA - 1, anchorF); // We command a move to the cell directly above this anchor (one step lower in A index).
+    }
+
+    c->lastBPM = bpm_now; // After planning the next move, we store the current BPM so we can judge the effect in the next step.
+    c->lastCRY = cry_now; // And we also store the current crying level for the same purpose.
+    return;                 // We exit here since the next decision will be made after we see new vitals.
+  }
+  else // If improved is 0, it means the last move did not make things better (it might be the same or worse).
+  {
+    // HANDLE NO-IMPROVEMENT (SAME OR WORSE) // We now decide whether to try a special reverse-diagonal move or just backtrack.
+
+    if (same && c->lastMoveDir == 1) // If the state is considered “stable” and the last move direction was LEFT (dir=1),
+    {
+      int anchorA = c->prevA; // we use prevA as the anchor A index from which we came before that LEFT move.
+      int anchorF = c->prevF; // and prevF as the anchor F index from before that LEFT move.
+
+      if (anchorA > 0) // If we can still move UP from that previous anchor (i.e., we are not at the top row),
+      {
+        ctrl_log(c, "[A] SAME-> R.D from A%d F%d\n", anchorA + 1, anchorF + 1); // We log that we detected the “same after left” pattern and will now try a reverse diagonal step from that anchor.
+
+        c->lastMoveDir = 2;       // We set lastMoveDir to 2 because the reverse diagonal involves an UP move from the previous anchor.
+        c->triedUpFromAnchor = 1; // We mark that, from this anchor, we are now trying UP so we do not keep repeating it unnecessarily.
+
+        c->prevA = c->curA; // We store the current A index as prevA so that if this reverse diagonal is bad, we can backtrack back here.
+        c->prevF = c->curF; // We also store the current F index as prevF for symmetrical backtracking.
+
+        controller_command_cell(c, anchorA - 1, anchorF); // We execute the reverse diagonal by commanding the cell that is one step UP from the previous anchor.
+
+        c->lastBPM = bpm_now; // We update lastBPM to remember the BPM at the moment we made this reverse diagonal decision.
+        c->lastCRY = cry_now; // And we also update lastCRY to remember the CRY level at this moment.
+        return;                 // We return so that on the next call we can see if this reverse diagonal move improved things.
+      }
+    }
+
+    int anchorA = c->prevA; // If the special case above does not apply or is impossible, we prepare to backtrack to the previous anchor’s A index.
+    int anchorF = c->prevF; // And we prepare to backtrack to the previous anchor’s F index.
+
+    if (anchorA != c->curA || anchorF != c->curF) // If we are not already at that previous anchor cell,
+    {
+      ctrl_log(c, "[A] NO IMPROVEMENT -> A%d F%d\n", anchorA + 1, anchorF + 1); // We log that there was no improvement and that we are backtracking to that anchor, including the direction we came from.
+
+      controller_command_cell(c, anchorA, anchorF); // We send the command to move the motor state back exactly to the previous anchor cell on the grid.
+    }
+
+    c->curA = anchorA; // We update our current amplitude index to the anchor amplitude index we backtracked to.
+    c->curF = anchorF; // We update our current frequency index to the anchor frequency index we backtracked to.
+
+    c->lastMoveDir = 0; // We reset lastMoveDir to 0, indicating that we are now idle at an anchor and ready for the next “first move” decision.
+
+    c->lastBPM = bpm_now; // We store the current BPM as the last BPM for the next control step comparison.
+    c->lastCRY = cry_now; // We store the current crying level as the last CRY for the next comparison as well.
+    return;                 // We exit the function; the next call will start again from an anchor in idle state.
+  }
+}
@@ -0,0 +1,181 @@
+// controller.h — decision algorithm (walk over the A/F grid from A5F5 towards A1F1)
+// Plain C, no libpynq: main.c runs it on the PYNQ and the simulator (sim/) links the very same file on a PC
+// and drives it on a virtual clock. All state lives in a controller_t and the outside world is only reached
+// through the hooks (motor command, log line, clock), so nothing here knows whether it is on the cradle or not.
+
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdint.h>
+
+// real-world reaction delays = how long to wait between two controller steps
+#define HEARTBEAT_DELAY 10000 // ~10 s heartbeat delay (TAU)
+#define CRYING_DELAY 4000     // ~4 s crying / stress delay
+#define CONVERGENCE_DELAY 4000
+
+// regime switch and panic detection
+#define CRY_REGIME_BPM 150  // crying drives the decisions below this BPM ...
+#define CRY_REGIME_LEVEL 52 // ... and below this crying level (%)
+#define PANIC_JUMP_BPM 30   // a BPM rise this big from one step to the next is a panic
+
+#define THR_UNBOUNDED 10000 // thr_lo/thr_hi before any comparison narrowed them
+
+// POLICY MODE
+// Instead of the hand-written rules, controller_step() can follow a table computed offline by
+// sim/policy_solver.c (decision/policy_table.h holds the current one). It walks anchor to anchor: probe a
+// softer neighbour, let it settle, keep it if the vitals dropped, otherwise try the other neighbour.
+#define POLICY_LEFT 1 // probe (A, F-1)
+#define POLICY_UP 2   // probe (A-1, F)
+#define POLICY_BACK 0 // first probe failed: return to the anchor, then probe the other neighbour from there
+#define POLICY_DIAG 1 // first probe failed: go straight from the failed probe to the other neighbour
+
+typedef struct
+{
+  uint8_t first_dir[5][5]; // per anchor cell: POLICY_LEFT or POLICY_UP (walls override)
+  uint8_t on_fail[5][5];   // per anchor cell: POLICY_BACK or POLICY_DIAG
+  uint16_t wait_ms[2];     // settle time before judging a probe: [0] HB driven, [1] CRY driven
+} controller_policy_t;
+
+// MPC MODE
+// Plans every step instead of following a fixed exploration order. The K matrix is one of the 70 LEFT/UP orders
+// the cradle can walk from K9 to K1 (see scenario_build() in sim/sim.c), so the belief is a weight per order,
+// each with a small plant model that sees the same moves as the real one. The vitals reweight them by how well
+// each explains what changed. Then the model is forked (a struct copy, nothing allocated) for sampled orders and
+// band widths, LEFT, UP, backtrack and hold are played forward, and the cheapest in expected time-to-calm plus
+// panic cost is taken.
+#define MPC_PATHS 70       // LEFT/UP orders, 8 choose 4
+#define MPC_HIST 32        // S changes kept per order, enough to reach TAU back at one move a second
+#define MPC_OBS 16         // vitals kept for the likelihood window
+#define MPC_ROLLOUTS 48    // per candidate move, the same sampled orders for every candidate
+#define MPC_STEP_MS 1000   // step period after a move, and the move spacing inside a rollout
+#define MPC_WINDOW_MS 4000 // the likelihood compares what changed over this long
+#define MPC_PANIC_S 300    // a predicted panic costs this many seconds
+
+// the plant model (sim/sysid fits the mappings from recorded sessions). TAU is HEARTBEAT_DELAY, the settle time
+// CONVERGENCE_DELAY
+#define MPC_BPM_BASE 60.0f
+#define MPC_BPM_PER_S 1.8f
+#define MPC_CRY_BASE -25.0f
+#define MPC_CRY_PER_S 2.5f
+#define MPC_SOPT1 12.5f // prior mean of Sopt at K1, the start level pins K9
+#define MPC_HALF_MIN 6  // band half-widths the rollouts draw from
+#define MPC_HALF_MAX 12
+
+typedef struct
+{
+  float t;           // seconds since controller_start()
+  float S;
+  float converge_at; // when S lands on Sopt, < 0 if nothing is settling
+  uint8_t a, f, k;
+  uint8_t panicked;
+} mpc_plant_t;
+
+typedef struct
+{
+  float sopt[10], lo[10], hi[10]; // by K, [0] unused
+} mpc_bands_t;
+
+// the belief, ~13 KB. the caller owns it (a static on the PYNQ) so nothing is allocated while running
+typedef struct
+{
+  int started;
+  uint32_t rng;
+  mpc_bands_t bands;                  // nominal: Sopt evenly from the start level down to MPC_SOPT1
+  uint8_t K[MPC_PATHS][25];           // K of cell a*5+f per order
+  uint32_t on_path[MPC_PATHS];        // bit a*5+f: the cell is on the order's path
+  float logw[MPC_PATHS];
+  mpc_plant_t plant[MPC_PATHS];
+  float hist_t[MPC_HIST];             // every order changes S at the same moments (moves, convergences)
+  float hist_s[MPC_PATHS][MPC_HIST];
+  int hist_n;
+  float obs_t[MPC_OBS];
+  int16_t obs_bpm[MPC_OBS], obs_cry[MPC_OBS];
+  int obs_n;
+  float last_update;
+} controller_mpc_t;
+
+// the hand-picked constants above as the controller uses them. controller_init() loads the #defines and
+// controller_start() keeps whatever was set since, so sim/tune.c can search them without a rebuild
+typedef struct
+{
+  int cry_bpm;       // CRY_REGIME_BPM
+  int cry_level;     // CRY_REGIME_LEVEL
+  int jump_bpm;      // PANIC_JUMP_BPM
+  int hb_delay_ms;   // HEARTBEAT_DELAY
+  int cry_delay_ms;  // CRYING_DELAY
+  int conv_delay_ms; // CONVERGENCE_DELAY
+} controller_consts_t;
+
+typedef struct
+{
+  void (*command_cell)(void *ctx, int aIndex, int fIndex); // drive the cradle to cell (A,F), indices 0..4
+  void (*log)(void *ctx, const char *msg);                 // one log line, may be NULL
+  double (*now_ms)(void *ctx);                             // monotonic time in ms (real or virtual)
+  void *ctx;
+} controller_hooks_t;
+
+typedef struct
+{
+  // A/F grid (0-4). Start at A5 F5
+  int curA;
+  int curF;
+
+  int is_crying_activated;
+  int lastBPM;
+  int lastCRY;
+  int thresholdBPM;
+  int thresholdCRY;
+  controller_consts_t consts;
+
+  int prevA;
+  int prevF;
+
+  int anchorA_mem, anchorF_mem;
+  int triedLeftFromAnchor;
+  int triedUpFromAnchor;
+
+  // 0 = none/initial, 1 = LEFT, 2 = UP
+  int lastMoveDir;
+
+  int hit_wall; // 1 if we attempted a direction but boundary blocked this cycle
+
+  // anchor map discovered so far (0 = unknown)
+  int anchorMatrix[5][5];
+  int anchorLevel;
+
+  int panic_mode;
+
+  // timing
+  double algo_start_ms; // < 0 until controller_start()
+  int calm_reached;
+  int calm_elapsed_ms;
+
+  // policy mode (NULL = hand-written rules)
+  const controller_policy_t *policy;
+  int probe;          // 0 = sitting on the anchor, 1 = first neighbour probed, 2 = second one
+  int refBPM, refCRY; // vitals on the anchor when the probe went out
+  int wait_ms;        // next step period
+
+  // MPC mode when set (takes over from policy and rules), the belief lives there
+  controller_mpc_t *mpc;
+
+  // thresholdBPM values for which every BPM comparison so far came out the same (the sim caches on it)
+  int thr_lo, thr_hi;
+
+  controller_hooks_t hooks;
+} controller_t;
+
+// default thresholds and constants, not started yet
+void controller_init(controller_t *c, const controller_hooks_t *hooks);
+void controller_consts_default(controller_consts_t *k);
+// forget everything learned, back to A5 F5 and start the calm clock (thresholds, constants, policy and the MPC
+// storage are kept)
+void controller_start(controller_t *c);
+// command a cell (clamped to the grid) and check for CALM
+void controller_command_cell(controller_t *c, int aIndex, int fIndex);
+// one control cycle with the latest BPM and CRY
+void controller_step(controller_t *c, int bpm_now, int cry_now);
+// how long to wait before the next controller_step()
+int controller_step_period_ms(const controller_t *c);
+
+#endif
@@ -1,5 +1,5 @@
 // master.c — MASTER / Decision module
-// Ring UART frames: [DST][SRC][LEN][PAYLOAD...]
+// Ring UART frames: [SYNC][DST][SRC][LEN][PAYLOAD...][CRC8], see ring/ring_frame.h
 
 #include <libpynq.h>
 #include <stdint.h>
@@ -12,6 +12,10 @@
 #include <stdarg.h> // for log_printf
 #include <unistd.h>
 
+#include "controller.h"
+#include "policy_table.h"
+#include "../ring/ring_link.h"
+
 #define UART_CH UART0
 #define MSTR 0
 #define HRTBT 1
@@ -21,12 +25,33 @@
 #define TIMEOUT 20 // in ms
 #define MAX_PAY 5  // max payload length
 
-// *** NEW: real-world reaction delays to match the simulator ***
-#define HEARTBEAT_DELAY 10000 // ~10 s heartbeat delay (TAU)
-#define CRYING_DELAY 4000     // ~2 s crying / stress delay
-#define CONVERGENCE_DELAY 4000
-
-#define VITALS_POLL_MS 100 // request HB/CRY every 100ms
+// real-world reaction delays (HEARTBEAT_DELAY, CRYING_DELAY, CONVERGENCE_DELAY) live in controller.h
+
+// 1 = follow the offline-solved table (policy_table.h, regenerate with sim/policy_solver), 0 = hand-written rules.
+// Off until the table holds up off the model it was solved on: it calms every sim session at TAU 10-12 s, but
+// none at TAU 8 s or with --continuous, and about 30% with --sensor real (its settle waits are fitted to the
+// sim's exact timing, 4 s even where the BPM trails by TAU)
+#define CONTROLLER_USE_POLICY 0
+// 1 = plan every step against a belief over the K matrix instead (controller.h, MPC MODE), wins over the table
+#define CONTROLLER_USE_MPC 0
+
+#define VITALS_POLL_MS 100 // collect HB/CRY every 100ms
+
+// 1 = HB and CRY push their readings on their own (subscribed at VITALS_PUBLISH_MS), the ring thread keeps the
+// newest of each and the loop reads that, so no vitals request ever waits in the control loop; 0 = a collect
+// frame every VITALS_POLL_MS. Either runs between the slices of the loop's wait too (wait_msec()). The
+// subscription is re-sent every VITALS_SUBSCRIBE_MS, so a node that restarted picks it up; a node drops one not
+// renewed for 3 s (SUB_LAPSE_MS in heartbeat/ and crying/main.c), so a master that restarts without streaming
+// isn't pushed to forever. Off until it has run on the hardware ring; only sim --ring has exercised it so far
+#define VITALS_STREAM 0
+#define VITALS_PUBLISH_MS 200 // the crying node's p2p window, it can't have anything newer sooner
+#define VITALS_SUBSCRIBE_MS 1000
+
+// 1 = append every vitals poll and cell command of the live controller to SESSION_LOG_PATH, the input of
+// sim/sysid.c (fits the plant the simulator assumes). lines: "S t" session start, "V t bpm cry" one poll
+// (-1 = no reply), "M t a f" cell command (indices 0..4). t in ms on the monotonic clock
+#define RECORD_SESSION 0
+#define SESSION_LOG_PATH "session.log"
 
 // global variables for submodules (live readings)
 static uint8_t last_bpm = 0;
@@ -36,6 +61,16 @@ static uint8_t last_cry = 0;
 static uint8_t g_amp = 0;
 static uint8_t g_freq = 0;
 
+// latest reading of each sensor node: a polled reply or the collect frame through receive_message(), a published
+// reading from the ring thread's latest values (vitals_take_latest()). n counts the readings, so a reader can
+// tell a new one
+typedef struct
+{
+  int bpm, cry; // -1 until the first one
+  uint32_t bpm_n, cry_n;
+} vitals_cache_t;
+static vitals_cache_t g_vitals = {-1, -1, 0, 0};
+
 // global message variables that are decoded
 static uint8_t g_src = 0;
 static uint8_t g_len = 0;
@@ -179,36 +214,14 @@ static void log_printf(const char *fmt, ...)
 
 // UART helpers
 
-// timeouted read of a single byte
-static int timeouted_byte(int ms)
-{
-  int waited = 0;
-  while (waited < ms)
-  {
-    if (uart_has_data(UART_CH))
-      return (int)uart_recv(UART_CH);
-    sleep_msec(1);
-    waited += 1;
-  }
-  return -1;
-}
+// the ring's receive thread and its queue of frames for us (ring/ring_link.h). The master forwards nothing:
+// a frame for anyone else reaching it went all the way round without a taker and is dropped there
+static ring_link_t g_link;
 
-// convenience
-static int receive_byte(void)
-{
-  return timeouted_byte(TIMEOUT);
-}
-
-// [DST][SRC][LEN][PAYLOAD]
+// [SYNC][DST][SRC][LEN][PAYLOAD][CRC8]
 void send_message_raw(uint8_t dst, uint8_t src, const uint8_t payload[], uint8_t len)
 {
-  uart_send(UART_CH, dst);
-  uart_send(UART_CH, src);
-  uart_send(UART_CH, len);
-  for (int i = 0; i < len; i++)
-  {
-    uart_send(UART_CH, payload[i]);
-  }
+  ring_link_send(&g_link, dst, src, payload, len);
 }
 
 // helper macro to infer payload length from array
@@ -216,51 +229,40 @@ void send_message_raw(uint8_t dst, uint8_t src, const uint8_t payload[], uint8_t
   send_message_raw(dst, src, payload, (uint8_t)sizeof(payload))
 
 // receive a message into globals g_src, g_len, g_payload
-// receive_message
-// UPDATED: Now non-blocking. Returns -1 immediately if no data.
+// Non-blocking: takes the next complete frame the ring thread queued for us, returns its payload length, -1 if
+// there is none yet.
 static int receive_message(void)
 {
-  if (!uart_has_data(UART_CH))
-    return -1;
-
-  int b = receive_byte(); // DST
-  if (b < 0)
-    return -1;
-  uint8_t dst = (uint8_t)b;
-
-  b = receive_byte(); // SRC
-  if (b < 0)
-    return -1;
-  uint8_t src = (uint8_t)b;
-
-  b = receive_byte(); // LEN
-  if (b < 0)
+  ring_frame_t f;
+  if (!ring_link_pop(&g_link, &f))
     return -1;
-  uint8_t len = (uint8_t)b;
-
-  // If not for me, drain payload so framing stays aligned.
-  if (dst != MSTR)
+  uint8_t len = f.len > MAX_PAY ? MAX_PAY : f.len;
+  memcpy(g_payload, f.pay, len);
+  g_src = f.src;
+  g_len = len;
+  if (g_src == HRTBT && g_len >= 2 && g_payload[0] == 'H')
   {
-    for (int i = 0; i < len; i++)
-    {
-      (void)receive_byte(); // ignore; if timeout happens, we just desync less badly than leaving bytes behind
-    }
-    return 0;
+    g_vitals.bpm = g_payload[1];
+    g_vitals.bpm_n++;
   }
-
-  if (len > MAX_PAY)
-    len = MAX_PAY;
-
-  for (int i = 0; i < len; i++)
+  else if (g_src == CRY && g_len >= 2 && g_payload[0] == 'C')
   {
-    b = receive_byte();
-    if (b < 0)
-      return -3;
-    g_payload[i] = (uint8_t)b;
+    g_vitals.cry = g_payload[1];
+    g_vitals.cry_n++;
+  }
+  else if (g_src == MSTR && g_len >= RING_COLLECT_LEN && g_payload[0] == RING_COLLECT)
+  {
+    if (g_payload[RING_COLLECT_HB] != RING_NO_READING)
+    {
+      g_vitals.bpm = g_payload[RING_COLLECT_HB];
+      g_vitals.bpm_n++;
+    }
+    if (g_payload[RING_COLLECT_CRY] != RING_NO_READING)
+    {
+      g_vitals.cry = g_payload[RING_COLLECT_CRY];
+      g_vitals.cry_n++;
+    }
   }
-
-  g_src = src;
-  g_len = len;
   return (int)g_len;
 }
 
@@ -317,38 +319,37 @@ static int boot_ping(uint8_t dst)
 //   return -1; // timeout
 // }
 
-// request heartbeat value
-static int request_heartbeat(void)
+// one vitals collect frame round the ring (ring/ring_frame.h): HB and CRY fill their slots on the way through,
+// so both readings come back from the same pass. *hb / *cry are -1 for a slot nobody filled or when the frame
+// didn't come back within TIMEOUT
+static void request_vitals(int *hb, int *cry)
 {
-  uint8_t payload[] = {'H'};
-  send_message(HRTBT, MSTR, payload);
+  uint8_t payload[] = {RING_COLLECT, RING_NO_READING, RING_NO_READING};
+  send_message(MSTR, MSTR, payload);
+  *hb = -1;
+  *cry = -1;
   int waited = 0;
   while (waited < TIMEOUT)
   {
     int r = receive_message();
-    if (r > 0 && g_src == HRTBT && g_len >= 2 && g_payload[0] == 'H')
-      return g_payload[1];
+    if (r > 0 && g_src == MSTR && g_len >= RING_COLLECT_LEN && g_payload[0] == RING_COLLECT)
+    {
+      if (g_payload[RING_COLLECT_HB] != RING_NO_READING)
+        *hb = g_payload[RING_COLLECT_HB];
+      if (g_payload[RING_COLLECT_CRY] != RING_NO_READING)
+        *cry = g_payload[RING_COLLECT_CRY];
+      return;
+    }
     sleep_msec(1);
     waited += 1;
   }
-  return -1;
 }
 
-// request crying value
-static int request_crying(void)
+// ask a sensor node to publish its reading every period_ms (10 ms steps, 0 = stop)
+static void subscribe_vitals(uint8_t dst, int period_ms)
 {
-  uint8_t payload[] = {'C'};
-  send_message(CRY, MSTR, payload);
-  int waited = 0;
-  while (waited < TIMEOUT)
-  {
-    int r = receive_message();
-    if (r > 0 && g_src == CRY && g_len >= 2 && g_payload[0] == 'C')
-      return g_payload[1];
-    sleep_msec(1);
-    waited += 1;
-  }
-  return -1;
+  uint8_t payload[] = {'S', (uint8_t)(period_ms / 10)};
+  send_message(dst, MSTR, payload);
 }
 
 // send motor command (amp%, freq%)
@@ -377,40 +378,10 @@ static void command_motor(uint8_t amp, uint8_t freq)
 //   send_message(MTR, MSTR, pl);
 // }
 
-// Controller state + logic
-
-// A/F grid (0-4). Start at A5 F5
-static int curA = 4;
-static int curF = 4;
-
-static int is_crying_activated = 0;
-static int ctrl_lastBPM = -1;
-static int ctrl_lastCRY = -1;
-static int thresholdBPM = 10;
-static int thresholdCRY = 1;
-
-static int prevA = -1;
-static int prevF = -1;
-
-static int anchorA_mem = -1, anchorF_mem = -1;
-static int triedLeftFromAnchor = 0;
-static int triedUpFromAnchor = 0;
+// Controller state + logic (controller.c)
 
-// 0 = none/initial, 1 = LEFT, 2 = UP
-static int lastMoveDir = 0;
-
-static int hit_wall = 0; // 1 if we attempted a direction but boundary blocked this cycle
-
-// anchor map discovered so far (0 = unknown)
-static int anchorMatrix[5][5] = {0};
-static int anchorLevel = 0;
-
-static int panic_mode = 0;
-
-// timing
-static double g_algo_start_ms = 0.0;
-static int g_calm_reached = 0;
-static int g_calm_elapsed_ms = 0;
+static controller_t g_ctrl;
+static controller_mpc_t g_mpc; // only used with CONTROLLER_USE_MPC
 
 // monotonic time in milliseconds
 static double now_msec(void)
@@ -436,327 +407,138 @@ static void fmt_mmss(int ms, char out[8])
   out[5] = '\0';
 }
 
-// Map logical cell (A,F) -> actual motor amplitude/frequency percentages.
-static void controller_command_cell(int aIndex, int fIndex)
-{
-  if (aIndex < 0)
-    aIndex = 0;
-  if (aIndex > 4)
-    aIndex = 4;
-  if (fIndex < 0)
-    fIndex = 0;
-  if (fIndex > 4)
-    fIndex = 4;
+// session recording (RECORD_SESSION), NULL while off
+static FILE *g_rec = NULL;
 
-  static const uint8_t amp_levels[5] = {20, 40, 60, 80, 100};
-  static const uint8_t freq_levels[5] = {20, 35, 50, 65, 70};
-
-  uint8_t amp = amp_levels[aIndex];
-  uint8_t freq = freq_levels[fIndex];
-
-  curA = aIndex;
-  curF = fIndex;
-
-  command_motor(amp, freq);
-  // ---- CALM detection (A1F1 == indices 0,0) ----
-  // We only count calm if we are NOT in panic mode (panic currently forces A1F1).
-  if (!g_calm_reached && !panic_mode && g_algo_start_ms > 0.0 && curA == 0 && curF == 0)
+static void rec_start(void)
+{
+  if (!RECORD_SESSION)
+    return;
+  g_rec = fopen(SESSION_LOG_PATH, "a");
+  if (!g_rec)
   {
-    g_calm_reached = 1;
-    g_calm_elapsed_ms = (int)(now_msec() - g_algo_start_ms);
-    log_printf("[A] CALM reached in %d ms\n", g_calm_elapsed_ms);
+    perror("session log");
+    return;
   }
+  setvbuf(g_rec, NULL, _IOLBF, 0); // a restart exec()s without flushing
+  fprintf(g_rec, "S %.0f\n", now_msec());
 }
 
-// improvement tests (from sim)
-static int heartbeat_improved(int bpm_now)
+static void rec_line(char kind, int x, int y)
 {
-  if (ctrl_lastBPM <= 0)
-    return 0;
-  if (ctrl_lastBPM - bpm_now >= thresholdBPM)
-    return 1;
-  return 0;
+  if (g_rec)
+    fprintf(g_rec, "%c %.0f %d %d\n", kind, now_msec(), x, y);
 }
 
-static int crying_improved(int cry_now)
+// controller hooks: the controller only knows grid cells, the percentages are ours
+static void ctrl_command_cell(void *ctx, int aIndex, int fIndex)
 {
-  if (cry_now <= thresholdCRY)
-    return 1;
-  if (ctrl_lastCRY > 0 && (ctrl_lastCRY - cry_now >= thresholdCRY))
-    return 1;
-  return 0;
+  (void)ctx;
+  static const uint8_t amp_levels[5] = {20, 40, 60, 80, 100};
+  static const uint8_t freq_levels[5] = {20, 35, 50, 65, 70};
+
+  command_motor(amp_levels[aIndex], freq_levels[fIndex]);
+  rec_line('M', aIndex, fIndex);
 }
 
-// register anchor cell
-static void register_anchor(int a, int f)
+static void ctrl_log(void *ctx, const char *msg)
 {
-  if (a < 0 || a > 4 || f < 0 || f > 4)
-    return;
-
-  if (anchorMatrix[a][f] == 0)
-  {
-    anchorLevel++;
-    anchorMatrix[a][f] = 10 - anchorLevel;
-    log_printf("[A] set A%d F%d as anchor L%d\n",
-               a + 1, f + 1, anchorLevel);
-  }
+  (void)ctx;
+  log_printf("%s", msg);
 }
 
-// One controller step for
-// This function is called every control cycle with the latest BPM and CRY and decides what to command on the motor grid.
-// Yes this is extensively documented so that everyone can understand. Yes including me.
-// bpm_now is the current heartbeat in BPM, cry_now is the current crying level (%) both are measured by the submodules, hopefully.
-static void controller_step(int bpm_now, int cry_now)
+static double ctrl_now_ms(void *ctx)
 {
-  hit_wall = 0; // Detector flag for (AxF1 or A1Fx so we can be smart and reduce the delay to just the convergence time)
-
-  // PANIC DETECTION USING VITALS
-  // In this part we look only at BPM and CRY and decide whether the baby is in a panic state and we must enter panic_mode.
-  // This matters because if we are in panic mode we need to go to K9 to start again. Currently the motors stop for testing purposes
-
-  int big_jump = 0; // This variable will be set to 1 if the BPM suddenly jumps up a lot compared to the previous BPM
+  (void)ctx;
+  return now_msec();
+}
 
-  if (ctrl_lastBPM > 0)                        // We only check for a BPM jump if we have a valid previous BPM
-    big_jump = (bpm_now - ctrl_lastBPM >= 30); // Here we compute the difference between current BPM and last BPM, and set big_jump to 1 if the increase is 30 BPM or more.
+// VITALS_STREAM: the ring thread keeps the nodes' publications as latest values (ring_link_keep_latest()) instead
+// of queueing them, so none is lost or goes stale behind the queue while the loop sleeps
+static int g_keep_hb = -1, g_keep_cry = -1;
+static uint32_t g_seen_hb = 0, g_seen_cry = 0;
 
-  if (!panic_mode) // We only re-check panic conditions if we are not already in panic mode; once in panic, we stay there until its reseted somehow (not implement rk).
+static void vitals_take_latest(void)
+{
+  int v;
+  uint32_t n;
+  if (g_keep_hb >= 0 && ring_link_latest(&g_link, g_keep_hb, &v, &n, NULL) && n != g_seen_hb)
   {
-    if (big_jump) // If any of our panic flags are true, panic.
-    {
-      panic_mode = 1; // We now enter panic mode, meaning that the rest of this function will follow the panic-mode path instead of the normal algorithm.
-
-      log_printf("[A] PANIC(BPM=%d, CRY=%d)\n", bpm_now, cry_now); // We log a message so we can see exactly when and with what values the panic was triggered.
-    }
+    g_seen_hb = n;
+    g_vitals.bpm = v;
+    g_vitals.bpm_n++;
   }
-
-  // PANIC MODE: FREEZE MOTORS (Currently)
-  // When panic_mode is active, we stop exploring the (A, F) grid and keep the cradle in a fixed safe motor state.
-
-  if (panic_mode)
+  if (g_keep_cry >= 0 && ring_link_latest(&g_link, g_keep_cry, &v, &n, NULL) && n != g_seen_cry)
   {
-    controller_command_cell(0, 0); // We command the cell at indices (A=0, F=0)
-
-    ctrl_lastBPM = bpm_now; // We still update ctrl_lastBPM to the current BPM so history and logs remain up to date even during panic.
-    ctrl_lastCRY = cry_now; // We also update ctrl_lastCRY to the current crying level for the same reason.
-    return;                 // We leave the function early because, in panic mode, we do not want to run the normal inverse-model algorithm anymore.
+    g_seen_cry = n;
+    g_vitals.cry = v;
+    g_vitals.cry_n++;
   }
+}
 
-  // NORMAL MODE: CHECK WHETHER THE LAST MOVE HELPED OR NOT
-  // Since we are not in panic, we now look at whether the last motor command improved the baby’s state.
-
-  int improved = 0; // This will be set to 1 if the helper functions say that the situation actually got better after the last move.
-  int same = 0;     // This will be set to 1 if the situation is considered stable
-
-  if (bpm_now < 150 && cry_now < 52) // If the current BPM is below 150, we stop using heart rate as its delayed and focus more on crying as an indicator of stress.
-  {
-    is_crying_activated = 1;             // We record that in this regime we are using crying as the primary signal to measure improvement.
-    improved = crying_improved(cry_now); // We call crying_improved with the current CRY value. returns 1 if crying suggests improvement.
-  }
-  else // If BPM is 150 or higher, the heart rate is used since crying is always %100 here
-  {
-    is_crying_activated = 0;                // We record that, in this regime, we are using BPM as the primary indicator of improvement.
-    improved = heartbeat_improved(bpm_now); // We call heartbeat_improved with the current BPM value. returns 1 if BPM suggests improvement
-  }
+// (1) of the main loop: keep the vitals (last_bpm / last_cry) and the session log current. also runs between the
+// slices of wait_msec(), so they stay VITALS_POLL_MS fresh however long the controller's step period is
+static uint32_t g_last_poll_ms = 0;
+static uint32_t g_last_sub_ms = 0; // VITALS_STREAM only, like the two below
+static int g_subscribed = 0;
+static uint32_t g_rec_bpm_n = 0, g_rec_cry_n = 0;
 
-  if (ctrl_lastBPM > 0) // We  attempt a “stability” check (if we have a valid previous BPM value otherwise we cannot compare)
+static void vitals_service(uint32_t now)
+{
+  if (VITALS_STREAM)
   {
-    int bpm_delta = abs(bpm_now - ctrl_lastBPM);                           // We calculate the absolute value of the difference between current BPM and last BPM to see how much it changed.
-    int cry_delta = (ctrl_lastCRY >= 0) ? abs(cry_now - ctrl_lastCRY) : 0; // For CRY, we do a similar absolute difference if we have a valid previous value; otherwise we treat it as zero change.
-
-    if (!is_crying_activated) // If we are currently in BPM-driven mode (using BPM to decide improvement),
+    // Keep the subscription alive and take the newest of what the nodes published
+    if (!g_subscribed || (uint32_t)(now - g_last_sub_ms) >= VITALS_SUBSCRIBE_MS)
     {
-      if (bpm_delta <= 3) // then we consider the state “stable” if BPM changed by at most 3 beats since the last step.
-      {
-        log_printf("[A] HB stable Del(BPM)=%d\n", bpm_delta);
-        if (lastMoveDir == 1) // If the last move we made on the grid was a LEFT move (direction 1),
-          same = 1;           // we set same to 1, meaning we have a “stable after LEFT” pattern that we will react to with a special move i call reverse diagonal later.
-      }
+      g_last_sub_ms = now;
+      g_subscribed = 1;
+      subscribe_vitals(HRTBT, VITALS_PUBLISH_MS);
+      subscribe_vitals(CRY, VITALS_PUBLISH_MS);
     }
-    else // If we are in crying-driven mode (using CRY to decide improvement),
+    while (receive_message() >= 0)
+      ; // anything else for us (a late reply) off the queue; receive_message() files readings into g_vitals
+    vitals_take_latest();
+    if (g_vitals.bpm >= 0)
+      last_bpm = (uint8_t)g_vitals.bpm;
+    if (g_vitals.cry >= 0)
+      last_cry = (uint8_t)g_vitals.cry;
+
+    // session log keeps one V line per VITALS_POLL_MS, -1 where nothing new came in since the last one
+    if ((uint32_t)(now - g_last_poll_ms) >= VITALS_POLL_MS)
     {
-      if (cry_delta == 0) // we treat the situation as stable only if crying did not change at all (difference equals zero).
-      {
-        log_printf("[A] CRY stable ΔCRY=%d\n", cry_delta); // We log that the crying level is stable and show the CRY difference (which is zero here).
-        if (lastMoveDir == 1)                              // Again, this only matters if the last move direction was LEFT,
-          same = 1;                                        // so we set same to 1 in that case to remember the “stable after LEFT” condition.
-      }
+      g_last_poll_ms = now;
+      rec_line('V', g_vitals.bpm_n != g_rec_bpm_n ? g_vitals.bpm : -1,
+               g_vitals.cry_n != g_rec_cry_n ? g_vitals.cry : -1);
+      g_rec_bpm_n = g_vitals.bpm_n;
+      g_rec_cry_n = g_vitals.cry_n;
     }
   }
-
-  // ANCHOR SYNC WHEN IDLE (lastMoveDir == 0)
-  // Anchors are positions on the grid that we know are in the solution path
-  // when idle we make sure our stored anchor matches our current position.
-
-  if (lastMoveDir == 0) // If lastMoveDir is 0, it means we are not in the middle of a move and are sitting on some anchor position.
+  // Poll vitals frequently
+  else if ((uint32_t)(now - g_last_poll_ms) >= VITALS_POLL_MS)
   {
-    if (anchorA_mem != curA || anchorF_mem != curF) // If the anchor stored in memory does not match our current (curA, curF) on the grid,
-    {
-      anchorA_mem = curA;      // we update the stored anchor amplitude index to the current A index.
-      anchorF_mem = curF;      // we also update the stored anchor frequency index to the current F index.
-      triedLeftFromAnchor = 0; // We reset the flag indicating whether we have tried going LEFT from this anchor, so it becomes allowed again.
-      triedUpFromAnchor = 0;   // We also reset the flag indicating whether we have tried going UP from this anchor.
-
-      register_anchor(anchorA_mem, anchorF_mem); // We call register_anchor to tell the rest of the system that (curA, curF) is now our chosen anchor cell.
-      // this will later be used to follow a predetermined path to solution if a panic jump is caused to save time
-    }
+    g_last_poll_ms = now;
+
+    int vhb, vcr;
+    request_vitals(&vhb, &vcr);
+    if (vhb >= 0)
+      last_bpm = (uint8_t)vhb;
+    if (vcr >= 0)
+      last_cry = (uint8_t)vcr;
+    rec_line('V', vhb, vcr);
   }
+}
 
-  // FIRST MOVE FROM AN ANCHOR (when lastMoveDir == 0)
-  // From an anchor, the algorithm chooses which neighbour to explore first (LEFT or UP).
-
-  if (lastMoveDir == 0) // We are in the idle state, so now we decide the first exploration step from this anchor.
-  {
-    prevA = curA; // We store the current amplitude index as prevA, so we can return here later if needed.
-    prevF = curF; // We also store the current frequency index as prevF for the same reason.
-    if (!triedLeftFromAnchor && curF == 0)
-    {
-      hit_wall = 1; // wanted to try LEFT but wall
-      controller_command_cell(curA - 1, curF);
-      log_printf("[A] Hit left wall\n");
-    }
-    else if (!triedUpFromAnchor && curA == 0)
-    {
-      hit_wall = 1; // wanted to try UP but wall
-      controller_command_cell(curA, curF - 1);
-      log_printf("[A] Hit upper wall\n");
-    }
-    // just to be sure we still check vitals after we hit a wall instead of just going down.
-
-    else if (!triedLeftFromAnchor && curF > 0) // If we have not already tried going LEFT from this anchor and we are not at the left border of the grid (F > 0),
-    {
-      lastMoveDir = 1;         // We set lastMoveDir to 1 to remember that we are now making a LEFT move.
-      triedLeftFromAnchor = 1; // We also mark that from this anchor, LEFT has now been attempted, so we do not retry it immediately later.
-
-      log_printf("[A] TRY-> LEFT from A%d F%d\n", curA + 1, curF + 1);
-
-      controller_command_cell(curA, curF - 1); // We send the actual motor command to move to the cell with the same A index and F index decreased by one (one step LEFT on the grid).
-
-      ctrl_lastBPM = bpm_now; // After issuing the command, we record the current BPM so that next time we can compare and see if there was improvement.
-      ctrl_lastCRY = cry_now; // We also record the current CRY for the same comparison on the next step.
-      return;                 // We return immediately, because we want to wait and see how this LEFT move changes the baby’s vitals before doing anything else.
-    }
-    else if (!triedUpFromAnchor && curA > 0) // If LEFT is not available or already tried, but we have not tried UP and we are not at the top row (A > 0),
-    {
-      lastMoveDir = 2;       // We set lastMoveDir to 2 to indicate that our next move is an UP move.
-      triedUpFromAnchor = 1; // We mark that from this anchor, UP has been attempted, to avoid repeating it unnecessarily.
-
-      log_printf("[A] Blocked-> UP from A%d F%d\n", curA + 1, curF + 1); // We log that our TRY move from this anchor is UP, and note that LEFT was already tried or blocked.
-
-      controller_command_cell(curA - 1, curF); // We send the motor command to move to the neighbour above, which has A index decreased by one and the same F index.
-
-      ctrl_lastBPM = bpm_now; // We store the BPM we saw before this UP move so that we can check later if it improved things.
-      ctrl_lastCRY = cry_now; // We also store the CRY level for the same reason.
-      return;                 // We return here, again to wait for the effect of this UP move on the vitals.
-    }
-    else if (curA + 1 == 1 && curF + 1 == 1) // If neither LEFT nor UP is available (or both have already been tried from this anchor),
-    {
-      log_printf("[A] BABY CALM holding A%d F%d\n", curA + 1, curF + 1);
-
-      ctrl_lastBPM = bpm_now; // Even though we are not moving, we still update the last BPM value to what we just measured.
-      ctrl_lastCRY = cry_now; // And we also update the last CRY value.
-      return;                 // We exit the function while staying at this anchor, just monitoring the baby’s state.
-    }
-    else // If neither LEFT nor UP is available (or both have already been tried from this anchor),
-    {
-      log_printf("[A] Fatal Error! holding A%d F%d\n", curA + 1, curF + 1);
-
-      ctrl_lastBPM = bpm_now; // Even though we are not moving, we still update the last BPM value to what we just measured.
-      ctrl_lastCRY = cry_now; // And we also update the last CRY value.
-      return;                 // We exit the function while staying at this anchor, just monitoring the baby’s state.
-    }
-  }
-
-  // WE HAVE A LAST MOVE (lastMoveDir != 0) // If we reach here, it means we are returning after having commanded a move in the previous step.
-
-  if (improved) // If the helper functions said that the last move improved the situation,
+// sleep ms, in slices of at most VITALS_POLL_MS with vitals_service() after each
+static void wait_msec(int ms)
+{
+  double end = now_msec() + ms;
+  for (;;)
   {
-    int anchorA = curA; // We now treat the current A index (where we ended up) as a new anchor amplitude index.
-    int anchorF = curF; // We also treat the current F index as a new anchor frequency index.
-
-    log_printf("[A] IMPROVED -> anchor A%d F%d\n", anchorA + 1, anchorF + 1);
-
-    register_anchor(anchorA, anchorF); // We tell the anchor-management logic that this cell (anchorA, anchorF) should be added or updated as an anchor on the path.
-
-    if (anchorA_mem != anchorA || anchorF_mem != anchorF) // If our remembered anchor position does not yet match this new anchor,
-    {
-      anchorA_mem = anchorA;   // we store the new anchor amplitude index in anchorA_mem.
-      anchorF_mem = anchorF;   // and the new anchor frequency index in anchorF_mem.
-      triedLeftFromAnchor = 0; // We reset the “tried left” flag, because this is a fresh anchor and we can try LEFT from it again.
-      triedUpFromAnchor = 0;   // We also reset the “tried up” flag for the same reason.
-    }
-
-    prevA = anchorA; // We also store this anchor as prevA so that, if future moves fail, we can backtrack to it.
-    prevF = anchorF; // And we store it as prevF for backtracking in frequency.
-
-    if (anchorF > 0) // If we are not at the left border, we can try going further LEFT from this new anchor.
-    {
-      lastMoveDir = 1;         // We set the last move direction to LEFT again, as we are planning a follow-up LEFT move.
-      triedLeftFromAnchor = 1; // We mark that LEFT has been tried from this anchor so we do not keep repeating it forever.
-
-      log_printf("[A] IMPROVED-> LEFT from A%d F%d\n", anchorA + 1, anchorF + 1); // We log that, because the last move was good, we are going to continue exploring by moving LEFT from this new anchor.
-
-      controller_command_cell(anchorA, anchorF - 1); // We command the motor module to move to the cell one step LEFT of the current anchor position.
-      // we can shorten delays if borders are hit since there is only going to remain one path to solution so we wouldnt need to wait for the whole heartbeat delay and just the convergence delay. I just dont think this will happen.
-    }
-    else if (anchorA > 0) // Otherwise, if LEFT is impossible but we can still move UP (not at top boundary),
-    {
-      lastMoveDir = 2; // We set the next move direction to UP.
-      // Note: we do not mark triedUpFromAnchor here, but we could if we want symmetric behaviour.
-
-      log_printf("[A] IMPROVED-> try UP from A%d F%d\n", anchorA + 1, anchorF + 1); // We log that we improved and now we will try moving UP from this anchor instead.
-
-      controller_command_cell(anchorA - 1, anchorF); // We command a move to the cell directly above this anchor (one step lower in A index).
-    }
-
-    ctrl_lastBPM = bpm_now; // After planning the next move, we store the current BPM so we can judge the effect in the next step.
-    ctrl_lastCRY = cry_now; // And we also store the current crying level for the same purpose.
-    return;                 // We exit here since the next decision will be made after we see new vitals.
-  }
-  else // If improved is 0, it means the last move did not make things better (it might be the same or worse).
-  {
-    // HANDLE NO-IMPROVEMENT (SAME OR WORSE) // We now decide whether to try a special reverse-diagonal move or just backtrack.
-
-    if (same && lastMoveDir == 1) // If the state is considered “stable” and the last move direction was LEFT (dir=1),
-    {
-      int anchorA = prevA; // we use prevA as the anchor A index from which we came before that LEFT move.
-      int anchorF = prevF; // and prevF as the anchor F index from before that LEFT move.
-
-      if (anchorA > 0) // If we can still move UP from that previous anchor (i.e., we are not at the top row),
-      {
-        log_printf("[A] SAME-> R.D from A%d F%d\n", anchorA + 1, anchorF + 1); // We log that we detected the “same after left” pattern and will now try a reverse diagonal step from that anchor.
-
-        lastMoveDir = 2;       // We set lastMoveDir to 2 because the reverse diagonal involves an UP move from the previous anchor.
-        triedUpFromAnchor = 1; // We mark that, from this anchor, we are now trying UP so we do not keep repeating it unnecessarily.
-
-        prevA = curA; // We store the current A index as prevA so that if this reverse diagonal is bad, we can backtrack back here.
-        prevF = curF; // We also store the current F index as prevF for symmetrical backtracking.
-
-        controller_command_cell(anchorA - 1, anchorF); // We execute the reverse diagonal by commanding the cell that is one step UP from the previous anchor.
-
-        ctrl_lastBPM = bpm_now; // We update ctrl_lastBPM to remember the BPM at the moment we made this reverse diagonal decision.
-        ctrl_lastCRY = cry_now; // And we also update ctrl_lastCRY to remember the CRY level at this moment.
-        return;                 // We return so that on the next call we can see if this reverse diagonal move improved things.
-      }
-    }
-
-    int anchorA = prevA; // If the special case above does not apply or is impossible, we prepare to backtrack to the previous anchor’s A index.
-    int anchorF = prevF; // And we prepare to backtrack to the previous anchor’s F index.
-
-    if (anchorA != curA || anchorF != curF) // If we are not already at that previous anchor cell,
-    {
-      log_printf("[A] NO IMPROVEMENT -> A%d F%d\n", anchorA + 1, anchorF + 1); // We log that there was no improvement and that we are backtracking to that anchor, including the direction we came from.
-
-      controller_command_cell(anchorA, anchorF); // We send the command to move the motor state back exactly to the previous anchor cell on the grid.
-    }
-
-    curA = anchorA; // We update our current amplitude index to the anchor amplitude index we backtracked to.
-    curF = anchorF; // We update our current frequency index to the anchor frequency index we backtracked to.
-
-    lastMoveDir = 0; // We reset lastMoveDir to 0, indicating that we are now idle at an anchor and ready for the next “first move” decision.
-
-    ctrl_lastBPM = bpm_now; // We store the current BPM as the last BPM for the next control step comparison.
-    ctrl_lastCRY = cry_now; // We store the current crying level as the last CRY for the next comparison as well.
-    return;                 // We exit the function; the next call will start again from an anchor in idle state.
+    int left = (int)(end - now_msec() + 0.5);
+    if (left <= 0)
+      return;
+    sleep_msec(left < VITALS_POLL_MS ? left : VITALS_POLL_MS);
+    vitals_service((uint32_t)now_msec());
   }
 }
 
@@ -775,6 +557,8 @@ static void handle_sigint(int sig __attribute__((unused)))
   display_destroy(&g_disp);
   switches_destroy();
   buttons_destroy();
+  ring_link_stop(&g_link);
+  ring_link_report(&g_link);
   pynq_destroy();
   exit(0);
 }
@@ -806,9 +590,23 @@ int main(void)
   uart_reset_fifos(UART_CH);
   switchbox_set_pin(IO_AR0, SWB_UART0_RX);
   switchbox_set_pin(IO_AR1, SWB_UART0_TX);
+  // the ring thread reads UART0 from here on, so only once its pins are routed
+  if (ring_link_start(&g_link, UART_CH, MSTR, 0) != 0)
+  {
+    printf("ring thread failed to start\n");
+    pynq_destroy();
+    return EXIT_FAILURE;
+  }
   switches_init();
   buttons_init();
 
+  controller_hooks_t hooks = {ctrl_command_cell, ctrl_log, ctrl_now_ms, NULL};
+  controller_init(&g_ctrl, &hooks);
+  if (CONTROLLER_USE_POLICY)
+    g_ctrl.policy = &policy_table;
+  if (CONTROLLER_USE_MPC)
+    g_ctrl.mpc = &g_mpc;
+
   // display + font
   display_init(&g_disp);
   display_set_flip(&g_disp, true, true);
@@ -966,28 +764,10 @@ int main(void)
     g_log_enabled = 1;
 
     // Ensure controller starts from known state (A5 F5)
-    curA = 4;
-    curF = 4;
-    prevA = curA;
-    prevF = curF;
-    lastMoveDir = 0;
-    is_crying_activated = 0;
-    ctrl_lastBPM = -1;
-    ctrl_lastCRY = -1;
-    anchorA_mem = -1;
-    anchorF_mem = -1;
-    triedLeftFromAnchor = 0;
-    triedUpFromAnchor = 0;
-    memset(anchorMatrix, 0, sizeof(anchorMatrix)); // idek wtf this is but hopefully we arent using the anchor matrix
-    anchorLevel = 0;
-    panic_mode = 0;
+    controller_start(&g_ctrl);
 
     // Put motor to start cell so the output line is meaningful immediately
-    controller_command_cell(curA, curF);
-
-    g_algo_start_ms = now_msec();
-    g_calm_reached = 0;
-    g_calm_elapsed_ms = 0;
+    controller_command_cell(&g_ctrl, g_ctrl.curA, g_ctrl.curF);
 
     // Run demo until switch 0 is turned off
     int cry_flag = 0;
@@ -1009,14 +789,14 @@ int main(void)
       if (b3)
         demo_cry = (uint8_t)clampi((int)demo_cry + 10, 0, 100);
 
-      if (demo_bpm < 150 && !cry_flag)
+      if (demo_bpm < CRY_REGIME_BPM && !cry_flag)
       {
-        demo_cry = 52;
+        demo_cry = CRY_REGIME_LEVEL;
         cry_flag = 1;
       }
 
       // --- Run real decision logic with injected vitals ---
-      controller_step((int)demo_bpm, (int)demo_cry);
+      controller_step(&g_ctrl, (int)demo_bpm, (int)demo_cry);
 
       // --- Draw HUD lines (clear then redraw fixed positions) ---
       clear_text_line(&g_disp, y_demo_bpm, g_fh, RGB_BLACK);
@@ -1042,19 +822,19 @@ int main(void)
       strcat(buf, "%");
       draw_text(&g_disp, g_fx, x, y_demo_cry, buf, RGB_WHITE);
 
-      // Regime line (uses your global is_crying_activated)
-      if (is_crying_activated)
+      // Regime line (uses g_ctrl.is_crying_activated)
+      if (g_ctrl.is_crying_activated)
         strcpy(buf, "[MODE] CRY driven"); // shorter delay
       else
         strcpy(buf, "[MODE] HB driven");
       draw_text(&g_disp, g_fx, x, y_demo_mode, buf, RGB_YELLOW);
 
-      // Controller output cell (curA/curF are your controller state)
+      // Controller output cell (g_ctrl.curA/curF are the controller state)
       strcpy(buf, "[CTRL] Decided Cell: A");
-      itoa_u((unsigned)(curA + 1), num);
+      itoa_u((unsigned)(g_ctrl.curA + 1), num);
       strcat(buf, num);
       strcat(buf, " F");
-      itoa_u((unsigned)(curF + 1), num);
+      itoa_u((unsigned)(g_ctrl.curF + 1), num);
       strcat(buf, num);
       draw_text(&g_disp, g_fx, x, y_demo_cell, buf, RGB_CYAN);
 
@@ -1070,32 +850,18 @@ int main(void)
 
       // Panic indicator
       strcpy(buf, "[PANIC] ");
-      strcat(buf, panic_mode ? "TRIGGERED" : "NOT TRIGGERED");
-      draw_text(&g_disp, g_fx, x, y_demo_panic, buf, panic_mode ? RGB_RED : RGB_GREEN);
-      int elapsed_ms = g_calm_reached ? g_calm_elapsed_ms : (int)(now_msec() - g_algo_start_ms);
+      strcat(buf, g_ctrl.panic_mode ? "TRIGGERED" : "NOT TRIGGERED");
+      draw_text(&g_disp, g_fx, x, y_demo_panic, buf, g_ctrl.panic_mode ? RGB_RED : RGB_GREEN);
+      int elapsed_ms = g_ctrl.calm_reached ? g_ctrl.calm_elapsed_ms : (int)(now_msec() - g_ctrl.algo_start_ms);
       char tbuf[8];
       fmt_mmss(elapsed_ms, tbuf);
 
       strcpy(buf, "[TIME] ");
       strcat(buf, tbuf);
-      strcat(buf, g_calm_reached ? " (CALM)" : "");
-      draw_text(&g_disp, g_fx, x, y_demo_time, buf, g_calm_reached ? RGB_GREEN : RGB_WHITE);
-
-      int delay_ms_s;
-      if (hit_wall)
-      {
-        delay_ms_s = CONVERGENCE_DELAY;
-      }
-      else if (is_crying_activated)
-      {
-        delay_ms_s = CRYING_DELAY;
-      }
-      else
-      {
-        delay_ms_s = HEARTBEAT_DELAY;
-      }
+      strcat(buf, g_ctrl.calm_reached ? " (CALM)" : "");
+      draw_text(&g_disp, g_fx, x, y_demo_time, buf, g_ctrl.calm_reached ? RGB_GREEN : RGB_WHITE);
 
-      sleep_msec(delay_ms_s);
+      sleep_msec(controller_step_period_ms(&g_ctrl));
     }
 
     // Exit demo mode cleanly
@@ -1103,6 +869,7 @@ int main(void)
     display_destroy(&g_disp);
     switches_destroy();
     buttons_destroy();
+    ring_link_stop(&g_link);
     pynq_destroy();
     return EXIT_SUCCESS;
   }
@@ -1152,16 +919,12 @@ if (get_switch_state(1) == 1)
   while (get_switch_state(1) == 1)
   {
     // Only request if that module responded to ping (keeps demo clean)
-    if (hb_ok)
-    {
-      int vhb = request_heartbeat();
-      if (vhb >= 0) last_bpm = (uint8_t)vhb;
-    }
-
-    if (cry_ok)
+    if (hb_ok || cry_ok)
     {
-      int vcr = request_crying();
-      if (vcr >= 0) last_cry = (uint8_t)vcr;
+      int vhb, vcr;
+      request_vitals(&vhb, &vcr);
+      if (hb_ok && vhb >= 0) last_bpm = (uint8_t)vhb;
+      if (cry_ok && vcr >= 0) last_cry = (uint8_t)vcr;
     }
 
     int b0 = get_button_state(0);
@@ -1279,14 +1042,8 @@ if (get_switch_state(1) == 1)
   y += g_fh;
 
   // init controller start cell = A5 F5
-  curA = 4;
-  curF = 4;
-  prevA = curA;
-  prevF = curF;
-  lastMoveDir = 0;
-  g_algo_start_ms = now_msec();
-  g_calm_reached = 0;
-  g_calm_elapsed_ms = 0;
+  controller_start(&g_ctrl);
+  rec_start();
 
   // init on-screen log area *below* HUD, stay inside screen
   g_log_x = x;
@@ -1301,7 +1058,12 @@ if (get_switch_state(1) == 1)
   g_log_y = g_log_y_start;
   g_log_enabled = 1;
 
-  uint32_t last_poll_ms = 0;
+  if (VITALS_STREAM)
+  {
+    g_keep_hb = ring_link_keep_latest(&g_link, HRTBT, 'H');
+    g_keep_cry = ring_link_keep_latest(&g_link, CRY, 'C');
+  }
+
   uint32_t last_step_ms = 0;
   // Main control loop
   while (1)
@@ -1312,34 +1074,17 @@ if (get_switch_state(1) == 1)
     if (get_button_state(3))
       restart_program();
 
-    // (1) Poll vitals frequently
-    if ((uint32_t)(now - last_poll_ms) >= VITALS_POLL_MS)
-    {
-      last_poll_ms = now;
-
-      int vhb = request_heartbeat();
-      if (vhb >= 0)
-        last_bpm = (uint8_t)vhb;
-
-      int vcr = request_crying();
-      if (vcr >= 0)
-        last_cry = (uint8_t)vcr;
-    }
+    // (1) Vitals
+    vitals_service(now);
 
     // (2) Run controller step on your intended cadence (4s or 10s)
-    int step_period_ms;
-    if (hit_wall)
-      step_period_ms = CONVERGENCE_DELAY;
-    else if (is_crying_activated)
-      step_period_ms = CRYING_DELAY;
-    else
-      step_period_ms = HEARTBEAT_DELAY;
+    int step_period_ms = controller_step_period_ms(&g_ctrl);
 
     if ((uint32_t)(now - last_step_ms) >= (uint32_t)step_period_ms)
     {
       last_step_ms = now;
       if (mtr_ok)
-        controller_step((int)last_bpm, (int)last_cry);
+        controller_step(&g_ctrl, (int)last_bpm, (int)last_cry);
     }
 
     // 3) HUD update and clear
@@ -1367,7 +1112,7 @@ if (get_switch_state(1) == 1)
     draw_text(&g_disp, g_fx, x, y_live_cry, buf, RGB_WHITE);
 
     // MODE (uses is_crying_activated)
-    if (is_crying_activated)
+    if (g_ctrl.is_crying_activated)
       strcpy(buf, "[MODE] CRY driven");
     else
       strcpy(buf, "[MODE] HB driven");
@@ -1375,10 +1120,10 @@ if (get_switch_state(1) == 1)
 
     // CELL (curA/curF)
     strcpy(buf, "[CTRL] Decided Cell: A");
-    itoa_u((unsigned)(curA + 1), num);
+    itoa_u((unsigned)(g_ctrl.curA + 1), num);
     strcat(buf, num);
     strcat(buf, " F");
-    itoa_u((unsigned)(curF + 1), num);
+    itoa_u((unsigned)(g_ctrl.curF + 1), num);
     strcat(buf, num);
     draw_text(&g_disp, g_fx, x, y_live_cell, buf, RGB_CYAN);
 
@@ -1394,43 +1139,30 @@ if (get_switch_state(1) == 1)
 
     // PANIC
     strcpy(buf, "[PANIC] ");
-    strcat(buf, panic_mode ? "TRIGGERED" : "NOT TRIGGERED");
-    draw_text(&g_disp, g_fx, x, y_live_panic, buf, panic_mode ? RGB_RED : RGB_GREEN);
+    strcat(buf, g_ctrl.panic_mode ? "TRIGGERED" : "NOT TRIGGERED");
+    draw_text(&g_disp, g_fx, x, y_live_panic, buf, g_ctrl.panic_mode ? RGB_RED : RGB_GREEN);
 
     // TIME (and CALM marker)
-    int elapsed_ms = g_calm_reached ? g_calm_elapsed_ms : (int)(now_msec() - g_algo_start_ms);
+    int elapsed_ms = g_ctrl.calm_reached ? g_ctrl.calm_elapsed_ms : (int)(now_msec() - g_ctrl.algo_start_ms);
     char tbuf[8];
     fmt_mmss(elapsed_ms, tbuf);
 
     strcpy(buf, "[TIME] ");
     strcat(buf, tbuf);
-    strcat(buf, g_calm_reached ? " (CALM)" : "");
-    draw_text(&g_disp, g_fx, x, y_live_time, buf, g_calm_reached ? RGB_GREEN : RGB_WHITE);
+    strcat(buf, g_ctrl.calm_reached ? " (CALM)" : "");
+    draw_text(&g_disp, g_fx, x, y_live_time, buf, g_ctrl.calm_reached ? RGB_GREEN : RGB_WHITE);
 
     // Real-life reaction delay:
     // If crying-based regime: short delay (4 s)
     // If heartbeat-based regime: long delay (10 s) to respect TAU
-    int delay_ms;
-    if (hit_wall)
-    {
-      delay_ms = CONVERGENCE_DELAY;
-    }
-    else if (is_crying_activated)
-    {
-      delay_ms = CRYING_DELAY;
-    }
-    else
-    {
-      delay_ms = HEARTBEAT_DELAY;
-    }
-
-    sleep_msec(delay_ms);
+    wait_msec(controller_step_period_ms(&g_ctrl));
   }
 
   // unreachable, but for completeness
   display_destroy(&g_disp);
   switches_destroy();
   buttons_destroy();
+  ring_link_stop(&g_link);
   pynq_destroy();
   return EXIT_SUCCESS;
 }
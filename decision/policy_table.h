@@ -0,0 +1,30 @@
+// policy_table.h — generated by sim/policy_solver.c, do not edit by hand
+// plant: TAU=10.00 s, convergence 4.00 s, thresholdBPM=10
+// train: 4000 sessions from seed 1, test: 20000 sessions from seed 1000001
+// test: policy calm 100.0% mean time-to-calm 104.0 s, hand-written rules calm 12.8% mean 111.1 s
+
+#ifndef POLICY_TABLE_H
+#define POLICY_TABLE_H
+
+#include "controller.h"
+
+// first_dir: 1 = LEFT, 2 = UP. on_fail: 0 = back to anchor, 1 = diagonal to the other neighbour
+static const controller_policy_t policy_table = {
+    .first_dir = {
+        {1, 1, 1, 1, 1}, // A1
+        {1, 2, 2, 2, 2}, // A2
+        {1, 1, 1, 2, 1}, // A3
+        {1, 1, 1, 1, 1}, // A4
+        {1, 2, 1, 1, 1}, // A5
+    },
+    .on_fail = {
+        {0, 0, 0, 0, 0}, // A1
+        {0, 1, 0, 1, 1}, // A2
+        {0, 1, 1, 1, 1}, // A3
+        {0, 1, 1, 1, 1}, // A4
+        {0, 1, 1, 1, 1}, // A5
+    },
+    .wait_ms = {4000, 4000},
+};
+
+#endif
@@ -9,6 +9,8 @@
 #include <stdlib.h> // for exit()
 #include <unistd.h>
 
+#include "../ring/ring_link.h"
+
 #define UART_CH UART0
 
 #define MSTR 0
@@ -16,13 +18,16 @@
 #define CRY 2
 #define MTR 3
 
-#define TIMEOUT 20
 #define MAX_PAY 5 // need this so the variable is global
 
 // GPIO pin where the photodiode+op-amp output is connected.
 // (We mainly use ADC0 for analog reading now, this pin init is harmless.)
 #define HB_PIN IO_AR2
 
+// a subscription ('S') the master has not renewed for this long is dropped; it renews every second, so a master
+// that restarted without streaming (or died) stops the 'H' pushes after three missed renewals
+#define SUB_LAPSE_MS 3000
+
 // --- Global display so Ctrl+C handler can access it ---
 static display_t disp;
 
@@ -103,39 +108,14 @@ static void draw_line(display_t *d, FontxFile *fx, int x, int y, const char *s,
 
 // --------------------- UART helpers ---------------------
 
-static int timeouted_byte(int ms)
-{
-    /* waits up to ms for one UART byte, returns byte or -1 on timeout */
-    int waited = 0;
-    while (waited < ms)
-    {
-        if (uart_has_data(UART_CH))
-        {
-            return (int)uart_recv(UART_CH);
-        }
-        sleep_msec(1);
-        waited += 1;
-    }
-    return -1;
-}
+// the ring's receive/forward thread and its queue of frames for us (ring/ring_link.h)
+static ring_link_t g_link;
 
-// convenience wrapper: TIMEOUT ms per byte
-static int receive_byte(void)
-{
-    return timeouted_byte(TIMEOUT);
-}
-
-// [DST][SRC][LEN][PAYLOAD]
+// [SYNC][DST][SRC][LEN][PAYLOAD][CRC8] (ring/ring_frame.h)
 void send_message(uint8_t dst, uint8_t src, const uint8_t payload[], uint8_t len)
 {
     /* sends one ring message over UART */
-    uart_send(UART_CH, dst);
-    uart_send(UART_CH, src);
-    uart_send(UART_CH, len);
-    for (int i = 0; i < len; i++)
-    {
-        uart_send(UART_CH, payload[i]);
-    }
+    ring_link_send(&g_link, dst, src, payload, len);
 }
 
 /* helper macro: C has no overloading */
@@ -147,62 +127,18 @@ static uint8_t g_len = 0;
 static uint8_t g_payload[MAX_PAY];
 
 // receive_message
-// UPDATED: Now non-blocking. Returns -1 immediately if no data.
+// Non-blocking: takes the next complete frame for us that the ring thread queued (frames for other nodes were
+// already forwarded there). Returns its payload length, -1 if there is none.
 static int receive_message(void)
 {
-    // 1. Check if ANY data is available. If not, return immediately.
-    //    This prevents the 20ms blocking delay every loop.
-    if (!uart_has_data(UART_CH))
+    ring_frame_t f;
+    if (!ring_link_pop(&g_link, &f))
     {
         return -1;
     }
-
-    // 2. Data is confirmed, so we can now safely use the timeout function
-    //    to read the full frame without stalling the main loop unnecessarily.
-    int b = receive_byte(); // Read DST
-    if (b < 0)
-        return -1;
-    uint8_t dst = (uint8_t)b;
-
-    b = receive_byte(); // Read SRC
-    if (b < 0)
-        return -1;
-    uint8_t src = (uint8_t)b;
-
-    b = receive_byte(); // Read LEN
-    if (b < 0)
-        return -1;
-    uint8_t len = (uint8_t)b;
-
-    // --- Forwarding Logic ---
-    if (dst != HRTBT)
-    {
-        uart_send(UART_CH, dst);
-        uart_send(UART_CH, src);
-        uart_send(UART_CH, len);
-        for (int i = 0; i < len; i++)
-        {
-            int pb = receive_byte();
-            if (pb < 0)
-                return -2;
-            uart_send(UART_CH, (uint8_t)pb);
-        }
-        return 0;
-    }
-
-    // --- Receive Logic (For Me) ---
-    if (len > MAX_PAY)
-        len = MAX_PAY; // Safety clamp
-
-    for (int i = 0; i < len; i++)
-    {
-        b = receive_byte();
-        if (b < 0)
-            return -3;
-        g_payload[i] = (uint8_t)b;
-    }
-
-    g_src = src;
+    uint8_t len = f.len > MAX_PAY ? MAX_PAY : f.len; // Safety clamp
+    memcpy(g_payload, f.pay, len);
+    g_src = f.src;
     g_len = len;
     return g_len;
 }
@@ -372,6 +308,8 @@ static void handle_sigint(int sig __attribute__((unused)))
   displayFillScreen(&disp, RGB_BLACK);
   printf("\nExited\n");
   display_destroy(&disp);
+  ring_link_stop(&g_link);
+  ring_link_report(&g_link);
   pynq_destroy();
   exit(0);
 }
@@ -406,6 +344,13 @@ int main(void)
     // UART pins
     switchbox_set_pin(IO_AR0, SWB_UART0_RX);
     switchbox_set_pin(IO_AR1, SWB_UART0_TX);
+    // the ring thread reads UART0 from here on, so only once its pins are routed
+    if (ring_link_start(&g_link, UART_CH, HRTBT, 1) != 0)
+    {
+        printf("ring thread failed to start\n");
+        pynq_destroy();
+        return 1;
+    }
 
     // GPIO for heartbeat sensor (not strictly needed if you use only ADC0)
     gpio_init();
@@ -440,6 +385,9 @@ int main(void)
     // ---- state ----
     uint8_t bpm_button = 0; // BPM chosen with buttons (fake)
     uint32_t rand_tick = 0; // for 'R' command
+    int pub_ms = 0;         // publish period the master subscribed to ('S'), 0 = only answer polls
+    uint32_t sub_ms = 0;    // when the subscription was last renewed
+    uint32_t last_pub_ms = 0;
 
     // edge-trigger memory for buttons
     int prev_b0 = 0, prev_b1 = 0;
@@ -448,6 +396,7 @@ int main(void)
     {
         // current time in ms from monotonic clock
         double t_ms = now_msec();
+        uint32_t now = (uint32_t)(uint64_t)t_ms; // for intervals that must survive wrapping
 
         // --- button-based fake BPM (edge detected) ---
         int b0 = get_button_state(0);
@@ -494,6 +443,9 @@ int main(void)
             bpm_effective = bpm_button;
         }
 
+        // what the master's collect frame picks up as it passes (ring thread)
+        ring_link_fill(&g_link, RING_COLLECT_HB, clampi(bpm_effective, 0, 254));
+
         // clamp for display, but allow 0 to mean "no BPM yet"
         int bpm_display = clampi(bpm_effective, 0, 250);
 
@@ -550,10 +502,26 @@ int main(void)
                     uint8_t rsp[] = {'H', (uint8_t)clampi(bpm_effective, 0, 255)};
                     send_message(MSTR, HRTBT, rsp);
                 }
+                else if (cmd == 'S' && g_len >= 2)
+                {
+                    // subscription: push 'H' every payload[1] * 10 ms from now on (0 stops it)
+                    pub_ms = g_payload[1] * 10;
+                    sub_ms = now;
+                }
                 // else: ignore unknown
             }
         }
 
+        // --- streaming: publish the BPM at the subscribed rate, until the master stops renewing ---
+        if (pub_ms > 0 && (uint32_t)(now - sub_ms) >= SUB_LAPSE_MS)
+            pub_ms = 0;
+        if (pub_ms > 0 && (uint32_t)(now - last_pub_ms) >= (uint32_t)pub_ms)
+        {
+            last_pub_ms = now;
+            uint8_t pub[] = {'H', (uint8_t)clampi(bpm_effective, 0, 255)};
+            send_message(MSTR, HRTBT, pub);
+        }
+
         // loop rate ~50 Hz
         sleep_msec(20);
     }
@@ -561,6 +529,7 @@ int main(void)
     // not reached, but kept for completeness
     display_destroy(&disp);
     gpio_destroy();
+    ring_link_stop(&g_link);
     pynq_destroy();
     adc_destroy();
     uart_reset_fifos(UART_CH);
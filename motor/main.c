@@ -1,5 +1,5 @@
 // motor.c  — Address 3 (MOTOR)
-// Ring frame: [DST][SRC][LEN][PAYLOAD...]
+// Ring frame: [SYNC][DST][SRC][LEN][PAYLOAD...][CRC8] (ring/ring_frame.h)
 // Motor receives values meant for it.
 // It forwards frames that are NOT for it.
 
@@ -14,12 +14,13 @@
 #include <buttons.h> // <-- adjust include if needed
 #include <unistd.h>
 
+#include "../ring/ring_link.h"
+
 #define UART_CH UART0
 #define MSTR 0
 #define HRTBT 1
 #define CRY 2
 #define MTR 3 // this module
-#define TIMEOUT 20
 #define MAX_PAY 8
 
 // Logical channels for safety checks (no HW meaning here)
@@ -139,94 +140,32 @@ static void draw_frame_for_line(display_t *d, int x, int y, int fh, uint16_t col
 }
 
 // --- UART helpers ---
-static int timeouted_byte(int ms)
-{
-  int waited = 0;
-  while (waited < ms)
-  {
-    if (uart_has_data(UART_CH))
-    {
-      return (int)uart_recv(UART_CH);
-    }
-    sleep_msec(1);
-    waited += 1;
-  }
-  return -1;
-}
-
-static int receive_byte(void) { return timeouted_byte(TIMEOUT); }
+// the ring's receive/forward thread and its queue of frames for us (ring/ring_link.h)
+static ring_link_t g_link;
 
 // --- parsed frame globals (filled by receive_message) ---
 static uint8_t g_src = 0;
 static uint8_t g_len = 0;
 static uint8_t g_payload[MAX_PAY];
 
-// UPDATED: Now non-blocking. Returns -1 immediately if no data.
+// Non-blocking: takes the next complete frame for us that the ring thread queued (frames for other nodes were
+// already forwarded there). Returns its payload length, -1 if there is none.
 static int receive_message(void)
 {
-  if (!uart_has_data(UART_CH))
-  {
-    return -1;
-  }
-
-  int b = receive_byte(); // DST
-  if (b < 0)
-    return -1;
-  uint8_t dst = (uint8_t)b;
-
-  b = receive_byte(); // SRC
-  if (b < 0)
-    return -1;
-  uint8_t src = (uint8_t)b;
-
-  b = receive_byte(); // LEN
-  if (b < 0)
+  ring_frame_t f;
+  if (!ring_link_pop(&g_link, &f))
     return -1;
-  uint8_t len = (uint8_t)b;
-
-  // Forward if not for me
-  if (dst != MTR)
-  {
-    uart_send(UART_CH, dst);
-    uart_send(UART_CH, src);
-    uart_send(UART_CH, len);
-    for (int i = 0; i < len; i++)
-    {
-      int pb = receive_byte();
-      if (pb < 0)
-        return -2;
-      uart_send(UART_CH, (uint8_t)pb);
-    }
-    return 0;
-  }
-
-  // Receive for me
-  if (len > MAX_PAY)
-    len = MAX_PAY;
-
-  for (int i = 0; i < len; i++)
-  {
-    b = receive_byte();
-    if (b < 0)
-      return -3;
-    g_payload[i] = (uint8_t)b;
-  }
-
-  g_src = src;
+  uint8_t len = f.len > MAX_PAY ? MAX_PAY : f.len;
+  memcpy(g_payload, f.pay, len);
+  g_src = f.src;
   g_len = len;
-  return g_len;
+  return (int)g_len;
 }
 
-// [DST][SRC][LEN][PAYLOAD]
+// [SYNC][DST][SRC][LEN][PAYLOAD][CRC8]
 static void send_message_impl(uint8_t dst, uint8_t src, const uint8_t payload[], uint8_t len)
 {
-  uart_send(UART_CH, dst);
-  uart_send(UART_CH, src);
-  uart_send(UART_CH, len);
-  for (int i = 0; i < len; i++)
-  {
-    uart_send(UART_CH, payload[i]);
-  }
+  ring_link_send(&g_link, dst, src, payload, len);
 }
 
 #define send_message(dst, src, payload) \
@@ -330,6 +269,8 @@ static void handle_sigint(int sig __attribute__((unused)))
   displayFillScreen(&disp, RGB_BLACK);
   printf("\nExited\n");
   display_destroy(&disp);
+  ring_link_stop(&g_link);
+  ring_link_report(&g_link);
   pynq_destroy();
   exit(0);
 }
@@ -363,6 +304,13 @@ int main(void)
   // UART pins (do NOT reuse these for PWM)
   switchbox_set_pin(IO_AR0, SWB_UART0_RX);
   switchbox_set_pin(IO_AR1, SWB_UART0_TX);
+  // the ring thread reads UART0 from here on, so only once its pins are routed
+  if (ring_link_start(&g_link, UART_CH, MTR, 1) != 0)
+  {
+    printf("ring thread failed to start\n");
+    pynq_destroy();
+    return 1;
+  }
 
   // PWM outputs – map to cradle driver pins
   switchbox_set_pin(AMP_PWM_PIN, AMP_PWM_CFG);
@@ -511,6 +459,7 @@ int main(void)
   pwm_destroy(AMP_PWM);
   pwm_destroy(FREQ_PWM);
   display_destroy(&disp);
+  ring_link_stop(&g_link);
   pynq_destroy();
   return 0;
 }
@@ -0,0 +1,173 @@
+// ring_frame.h — v2 frames of the UART ring, shared by all four nodes and the simulator's ring (sim/ring.c)
+// Header only, so every node's Makefile keeps compiling just its own directory.
+//
+//   [SYNC 0xA5][DST][SRC][LEN][PAYLOAD x LEN][CRC-8 over DST..PAYLOAD]
+//
+// v1 frames ([DST][SRC][LEN][PAYLOAD]) trusted the first byte they saw as DST: one lost or flipped byte and
+// every later frame was misparsed, while the nodes waited out a 20 ms timeout per missing byte. Here the
+// receiver is a state machine fed one byte at a time that never waits for anything. A frame only counts once
+// its header is plausible (known addresses, LEN <= RING_MAX_PAY) and its CRC matches. When a candidate fails,
+// the receiver drops bytes up to the next SYNC after the failed one and re-checks what it already holds, so
+// a glitch costs the frame it hit and nothing after it. Each byte is checked at most RING_MAX_FRAME times.
+//
+//   ring_rx_t rx;                       ring_rx_init(&rx);
+//   ring_rx_push(&rx, byte);            then drain: while (ring_rx_pop(&rx, &f)) handle(&f);
+//
+// One frame may have SRC == DST: the master's vitals collect frame, [0][0][3]['V'][hb][cry]. The master sends
+// it to itself with both slots RING_NO_READING; it goes once round the ring and each sensor node writes its
+// reading into its slot on the way through (ring_link.h). Both readings come back in one pass instead of two
+// request/reply round trips.
+
+#ifndef RING_FRAME_H
+#define RING_FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define RING_SYNC 0xA5
+#define RING_NODES 4    // addresses 0 (decision) .. 3 (motor)
+#define RING_MAX_PAY 8  // longer LEN is taken for a corrupted header
+#define RING_OVERHEAD 5 // SYNC, DST, SRC, LEN, CRC
+#define RING_MAX_FRAME (RING_OVERHEAD + RING_MAX_PAY)
+
+#define RING_COLLECT 'V'       // payload[0] of the vitals collect frame
+#define RING_COLLECT_HB 1      // payload slot the heartbeat node fills, BPM 0..254
+#define RING_COLLECT_CRY 2     // payload slot the crying node fills, 0..100 %
+#define RING_COLLECT_LEN 3
+#define RING_NO_READING 0xFF   // a slot nobody filled
+
+typedef struct
+{
+    uint8_t dst, src, len;
+    uint8_t pay[RING_MAX_PAY];
+    uint8_t raw[RING_MAX_FRAME]; // the frame as it came in, CRC included, for forwarding it unchanged
+    uint8_t raw_n;
+} ring_frame_t;
+
+typedef struct
+{
+    uint8_t buf[RING_MAX_FRAME]; // the candidate frame, buf[0] is a SYNC whenever n > 0
+    uint8_t n;
+    uint32_t frames;  // good frames out
+    uint32_t bad;     // candidates that failed the header or CRC check
+    uint32_t skipped; // bytes dropped while looking for the next SYNC
+} ring_rx_t;
+
+// CRC-8, polynomial x^8 + x^2 + x + 1 (0x07), init 0. catches every 1- and 2-bit error in a frame this short
+static inline uint8_t ring_crc8(const uint8_t *p, int n)
+{
+    uint8_t crc = 0;
+    for (int i = 0; i < n; i++)
+    {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++)
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+    return crc;
+}
+
+// a frame into out (RING_MAX_FRAME bytes), returns its length. len is clamped to RING_MAX_PAY
+static inline int ring_encode(uint8_t *out, uint8_t dst, uint8_t src, const uint8_t *pay, uint8_t len)
+{
+    if (len > RING_MAX_PAY)
+        len = RING_MAX_PAY;
+    out[0] = RING_SYNC;
+    out[1] = dst;
+    out[2] = src;
+    out[3] = len;
+    memcpy(out + 4, pay, len);
+    out[4 + len] = ring_crc8(out + 1, 3 + len);
+    return RING_OVERHEAD + len;
+}
+
+// what XOR-ing d into a byte changes the CRC by, when tail bytes (d's included) follow up to the CRC. The CRC
+// is linear (init 0, no final XOR), so a node can change one byte of a frame it is passing on by XOR-ing this
+// into the CRC that comes in: a frame that arrived corrupted still leaves with a CRC that doesn't match
+static inline uint8_t ring_crc8_delta(uint8_t d, int tail)
+{
+    uint8_t z[RING_MAX_FRAME] = {0};
+    z[0] = d;
+    return ring_crc8(z, tail);
+}
+
+static inline void ring_rx_init(ring_rx_t *rx)
+{
+    memset(rx, 0, sizeof *rx);
+}
+
+// one received byte. bytes outside a candidate frame are dropped right away unless they are a SYNC
+static inline void ring_rx_push(ring_rx_t *rx, uint8_t b)
+{
+    if (rx->n == 0 && b != RING_SYNC)
+    {
+        rx->skipped++;
+        return;
+    }
+    if (rx->n < RING_MAX_FRAME) // ring_rx_pop() keeps n below this, the check only guards a missed pop
+        rx->buf[rx->n++] = b;
+}
+
+// 1 = buf starts with a complete good frame, 0 = too short to tell yet, -1 = it cannot be a frame
+static inline int ring_rx_check(const ring_rx_t *rx)
+{
+    const uint8_t *b = rx->buf;
+    if (rx->n >= 2 && b[1] >= RING_NODES)
+        return -1;
+    if (rx->n >= 3 && (b[2] >= RING_NODES || (b[2] == b[1] && b[1] != 0))) // 0 -> 0 is the collect frame
+        return -1;
+    if (rx->n >= 4 && b[3] > RING_MAX_PAY)
+        return -1;
+    if (rx->n < 4 || rx->n < RING_OVERHEAD + b[3])
+        return 0;
+    return ring_crc8(b + 1, 3 + b[3]) == b[4 + b[3]] ? 1 : -1;
+}
+
+// drop the first k buffered bytes
+static inline void ring_rx_drop(ring_rx_t *rx, int k)
+{
+    memmove(rx->buf, rx->buf + k, (size_t)(rx->n - k));
+    rx->n = (uint8_t)(rx->n - k);
+}
+
+// one step of ring_rx_pop(): 1 = *f got the frame at the front, -1 = the candidate at the front failed and was
+// dropped up to the next SYNC, 0 = nothing to decide until more bytes come in
+static inline int ring_rx_step(ring_rx_t *rx, ring_frame_t *f)
+{
+    if (rx->n == 0)
+        return 0;
+    int st = ring_rx_check(rx);
+    if (st == 0)
+        return 0;
+    if (st > 0)
+    {
+        int n = RING_OVERHEAD + rx->buf[3];
+        f->dst = rx->buf[1];
+        f->src = rx->buf[2];
+        f->len = rx->buf[3];
+        memcpy(f->pay, rx->buf + 4, f->len);
+        memcpy(f->raw, rx->buf, (size_t)n);
+        f->raw_n = (uint8_t)n;
+        ring_rx_drop(rx, n);
+        rx->frames++;
+        return 1;
+    }
+    // resync: the next SYNC past the failed one starts the new candidate
+    int k = 1;
+    while (k < rx->n && rx->buf[k] != RING_SYNC)
+        k++;
+    rx->bad++;
+    rx->skipped += (uint32_t)k;
+    ring_rx_drop(rx, k);
+    return -1;
+}
+
+// the next good frame out of what was pushed, 1 if *f got one. call until it returns 0 after every push
+static inline int ring_rx_pop(ring_rx_t *rx, ring_frame_t *f)
+{
+    int st;
+    while ((st = ring_rx_step(rx, f)) < 0)
+        ;
+    return st;
+}
+
+#endif
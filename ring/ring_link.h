@@ -0,0 +1,320 @@
+// ring_link.h — a node's end of the UART ring, run by its own receive/forward thread
+// Header only, like ring_frame.h; needs libpynq.h included first and -pthread.
+//
+// Before this every node read the UART from its main loop, between display redraws, ADC sampling and a 20 ms
+// sleep, so a frame for the next node sat in the FIFO for as long as that loop iteration took. Now one thread
+// per node does nothing but drain the UART into the ring_frame.h receiver:
+//   - frames for another node are cut through: once the byte after SYNC names another node, what has come in
+//     so far goes back out and every later byte of the frame follows the moment it arrives. The hop costs a
+//     couple of byte-times instead of the whole frame. Forwarding can't wait for the CRC, so a corrupted frame
+//     is passed on as it is and the next receiver drops it. When SRC turns out to be us (our own frame back
+//     round) the stream stops after SYNC and DST; 0xA5 is no valid address, so the next node drops those two
+//     bytes as soon as the following SYNC arrives
+//   - the master's vitals collect frame (ring_frame.h) is cut through like any other, except that a sensor node
+//     writes its latest reading (ring_link_fill()) into its slot as the slot byte passes and XORs the matching
+//     ring_crc8_delta() into the CRC byte on its way out
+//   - frames for this node are copied whole into a lock-free single-producer/single-consumer byte queue, except
+//     readings the app asked to keep as latest values (ring_link_keep_latest()): a [tag][value] frame from that
+//     source overwrites the last one in place. A full queue drops the newest frame, which is the wrong one to
+//     lose for a stream of readings, and a reading is only fresh if something takes it off the queue in time;
+//     a latest value is as fresh as the last frame that came in, however long the app sleeps
+// The app loop pops complete frames off that queue and never touches uart_recv() again. Only whole frames are
+// ever published, so the app never sees half of one. Sends from both threads share one mutex, so a forwarded
+// frame can never interleave with one the app is sending.
+//
+//   static ring_link_t g_link;
+//   ring_link_start(&g_link, UART0, MY_ADDR, 1);   after uart_init(); 0 on success
+//   ring_link_send(&g_link, dst, src, pay, len);   instead of uart_send()
+//   while (ring_link_pop(&g_link, &f)) ...         from the app loop, never blocks
+//   i = ring_link_keep_latest(&g_link, src, tag);  then ring_link_latest(&g_link, i, ...) whenever it likes
+//   ring_link_stop(&g_link);                       before pynq_destroy(), then ring_link_report() if you like
+
+#ifndef RING_LINK_H
+#define RING_LINK_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ring_frame.h"
+
+#define RING_LINK_QBYTES 256 // power of two; room for 19 full-size frames the app has not picked up yet
+#define RING_LINK_IDLE_US 200 // poll period while the UART is quiet, about 2 bytes' time at 115200 baud
+#define RING_LINK_LATEST 4    // readings kept as latest values
+
+typedef struct
+{
+    int uart;
+    uint8_t me;
+    int forward; // 0 on the master: a foreign frame reaching it has been all the way round
+    pthread_t thread;
+    pthread_mutex_t tx;
+    atomic_int stop;
+    int running;
+
+    ring_rx_t rx;    // receive thread only, like the two below
+    int cut;         // bytes at rx.buf[0] already sent on, -1 = the candidate there is not to be sent on
+    uint64_t t_sync; // when that candidate's SYNC came in, us
+    uint8_t crc_fix; // ring_crc8_delta() of what we changed in that candidate, XOR-ed into its CRC on the way out
+
+    // our slot in the collect frame (0 = none) and the reading to put there, -1 = none yet; set by the app
+    atomic_int slot, slot_val;
+
+    // latest values: src/tag set by the app before it publishes n_latest, v by the receive thread only. v packs
+    // the arrival time in ms (32 bits), the count of readings so far (16) and the value (16) into one atomic
+    struct
+    {
+        uint8_t src, tag;
+        _Atomic uint64_t v;
+    } latest[RING_LINK_LATEST];
+    atomic_int n_latest;
+
+    // SPSC queue of raw frames for us, head moved by the receive thread only, tail by the app only
+    uint8_t q[RING_LINK_QBYTES];
+    _Atomic uint32_t head, tail;
+
+    // counters, written by the receive thread, fine to read racily for a HUD
+    _Atomic uint32_t forwarded, dropped; // dropped = frames for us that found the queue full
+    // per-hop latency of cut-through frames: SYNC in to SYNC + DST out, us
+    _Atomic uint32_t hop_n, hop_max_us;
+    _Atomic uint64_t hop_sum_us;
+} ring_link_t;
+
+static inline uint64_t ring_link_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static inline void ring_link_send_raw(ring_link_t *l, const uint8_t *p, int n)
+{
+    pthread_mutex_lock(&l->tx);
+    for (int i = 0; i < n; i++)
+        uart_send(l->uart, p[i]);
+    pthread_mutex_unlock(&l->tx);
+}
+
+static inline void ring_link_send(ring_link_t *l, uint8_t dst, uint8_t src, const uint8_t *pay, uint8_t len)
+{
+    uint8_t f[RING_MAX_FRAME];
+    ring_link_send_raw(l, f, ring_encode(f, dst, src, pay, len));
+}
+
+// receive thread: publish one frame for us, all of it or none
+static inline void ring_link_enqueue(ring_link_t *l, const ring_frame_t *f)
+{
+    uint32_t head = atomic_load_explicit(&l->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&l->tail, memory_order_acquire);
+    if (RING_LINK_QBYTES - (head - tail) < f->raw_n)
+    {
+        atomic_fetch_add_explicit(&l->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    for (int i = 0; i < f->raw_n; i++)
+        l->q[(head + (uint32_t)i) & (RING_LINK_QBYTES - 1)] = f->raw[i];
+    atomic_store_explicit(&l->head, head + f->raw_n, memory_order_release);
+}
+
+// app thread: keep [tag][value] frames from src as a latest value instead of queueing them. returns the index
+// for ring_link_latest(), -1 when all RING_LINK_LATEST are taken
+static inline int ring_link_keep_latest(ring_link_t *l, uint8_t src, uint8_t tag)
+{
+    int i = atomic_load_explicit(&l->n_latest, memory_order_relaxed);
+    if (i >= RING_LINK_LATEST)
+        return -1;
+    l->latest[i].src = src;
+    l->latest[i].tag = tag;
+    atomic_store_explicit(&l->n_latest, i + 1, memory_order_release);
+    return i;
+}
+
+// app thread: latest value i, 1 if one came in yet. *n counts the readings (mod 65536), so a caller can tell a
+// new one; *t_ms is ring_link_now_us() / 1000 when it arrived. n and t_ms may be NULL
+static inline int ring_link_latest(ring_link_t *l, int i, int *val, uint32_t *n, uint32_t *t_ms)
+{
+    uint64_t v = atomic_load_explicit(&l->latest[i].v, memory_order_relaxed);
+    if (!(v & 0xFFFF0000u))
+        return 0; // no reading yet: the count is never 0 after one, it starts at 1 and skips 0 on wrapping
+    *val = (int)(v & 0xFFFFu);
+    if (n)
+        *n = (uint32_t)(v >> 16) & 0xFFFFu;
+    if (t_ms)
+        *t_ms = (uint32_t)(v >> 32);
+    return 1;
+}
+
+// receive thread: a frame for us, into its latest value if it has one, else onto the queue
+static inline void ring_link_deliver(ring_link_t *l, const ring_frame_t *f)
+{
+    int n = atomic_load_explicit(&l->n_latest, memory_order_acquire);
+    for (int i = 0; i < n && f->len >= 2; i++)
+    {
+        if (l->latest[i].src != f->src || l->latest[i].tag != f->pay[0])
+            continue;
+        uint64_t old = atomic_load_explicit(&l->latest[i].v, memory_order_relaxed);
+        uint32_t cnt = ((uint32_t)(old >> 16) + 1) & 0xFFFFu;
+        if (cnt == 0)
+            cnt = 1;
+        uint64_t t_ms = (uint32_t)(ring_link_now_us() / 1000u);
+        atomic_store_explicit(&l->latest[i].v, t_ms << 32 | (uint64_t)cnt << 16 | f->pay[1], memory_order_relaxed);
+        return;
+    }
+    ring_link_enqueue(l, f);
+}
+
+// app thread: the reading this node puts into the collect frame from now on
+static inline void ring_link_fill(ring_link_t *l, int slot, int val)
+{
+    atomic_store_explicit(&l->slot_val, val, memory_order_relaxed);
+    atomic_store_explicit(&l->slot, slot, memory_order_relaxed);
+}
+
+// receive thread: rx.buf[from..to) is about to go out as out[]; fill our slot if it is a collect frame
+static inline void ring_link_patch(ring_link_t *l, uint8_t *out, int from, int to)
+{
+    const uint8_t *b = l->rx.buf;
+    int slot = atomic_load_explicit(&l->slot, memory_order_relaxed);
+    if (slot <= 0 || to < 5 || b[1] != 0 || b[2] != 0 || b[4] != RING_COLLECT || slot >= b[3])
+        return;
+    int pos = 4 + slot, crc_pos = 4 + b[3];
+    int val = atomic_load_explicit(&l->slot_val, memory_order_relaxed);
+    if (pos >= from && pos < to && val >= 0)
+    {
+        uint8_t v = (uint8_t)(val < RING_NO_READING ? val : RING_NO_READING - 1);
+        l->crc_fix = ring_crc8_delta((uint8_t)(b[pos] ^ v), crc_pos - pos);
+        out[pos - from] = v;
+    }
+    if (crc_pos >= from && crc_pos < to)
+        out[crc_pos - from] ^= l->crc_fix;
+}
+
+// receive thread: send on whatever of a foreign candidate came in since the last call
+static inline void ring_link_cut(ring_link_t *l)
+{
+    ring_rx_t *rx = &l->rx;
+    if (l->cut < 0 || rx->n < 2)
+        return;
+    if (l->cut == 0 && (!l->forward || rx->buf[1] >= RING_NODES || rx->buf[1] == l->me))
+        return;
+    // ours coming back, or (cut > 0: it started inside bytes that went out with a candidate that failed) for us
+    if ((rx->n >= 3 && rx->buf[2] == l->me) || (l->cut > 0 && rx->buf[1] == l->me))
+    {
+        l->cut = -1;
+        return;
+    }
+    if (rx->n == l->cut)
+        return;
+    uint8_t out[RING_MAX_FRAME];
+    memcpy(out, rx->buf + l->cut, (size_t)(rx->n - l->cut));
+    ring_link_patch(l, out, l->cut, rx->n);
+    ring_link_send_raw(l, out, rx->n - l->cut);
+    if (l->cut == 0)
+    {
+        uint32_t us = (uint32_t)(ring_link_now_us() - l->t_sync);
+        atomic_fetch_add_explicit(&l->hop_n, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&l->hop_sum_us, us, memory_order_relaxed);
+        if (us > atomic_load_explicit(&l->hop_max_us, memory_order_relaxed))
+            atomic_store_explicit(&l->hop_max_us, us, memory_order_relaxed);
+    }
+    l->cut = rx->n;
+}
+
+static inline void *ring_link_main(void *arg)
+{
+    ring_link_t *l = arg;
+    // signals (Ctrl+C) go to the app thread, whose handler stops this one
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+    ring_frame_t f;
+    while (!atomic_load_explicit(&l->stop, memory_order_relaxed))
+    {
+        if (!uart_has_data(l->uart))
+        {
+            usleep(RING_LINK_IDLE_US);
+            continue;
+        }
+        ring_rx_push(&l->rx, uart_recv(l->uart));
+        if (l->rx.n == 1)
+            l->t_sync = ring_link_now_us();
+        for (;;)
+        {
+            ring_link_cut(l);
+            int n = l->rx.n;
+            int st = ring_rx_step(&l->rx, &f);
+            if (st == 0)
+                break;
+            // the front candidate is done with, good or bad; a streamed one has already gone out whole
+            if (st > 0 && l->cut > 0)
+                atomic_fetch_add_explicit(&l->forwarded, 1, memory_order_relaxed);
+            else if (st > 0 && f.dst == l->me)
+                ring_link_deliver(l, &f);
+            // a failed candidate is dropped only up to the next SYNC in it. what is left of it may already be on
+            // the wire and the next node resyncs on those bytes itself, so they must not go out a second time
+            int sent = l->cut - (n - l->rx.n);
+            l->cut = sent > 0 ? sent : 0;
+            l->crc_fix = 0;
+            l->t_sync = ring_link_now_us();
+        }
+    }
+    return NULL;
+}
+
+// app thread: the next complete frame for us, 1 if *f got one
+static inline int ring_link_pop(ring_link_t *l, ring_frame_t *f)
+{
+    uint32_t tail = atomic_load_explicit(&l->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&l->head, memory_order_acquire);
+    if (head == tail)
+        return 0;
+    uint8_t n = (uint8_t)(RING_OVERHEAD + l->q[(tail + 3) & (RING_LINK_QBYTES - 1)]);
+    for (int i = 0; i < n; i++)
+        f->raw[i] = l->q[(tail + (uint32_t)i) & (RING_LINK_QBYTES - 1)];
+    f->raw_n = n;
+    f->dst = f->raw[1];
+    f->src = f->raw[2];
+    f->len = f->raw[3];
+    memcpy(f->pay, f->raw + 4, f->len);
+    atomic_store_explicit(&l->tail, tail + n, memory_order_release);
+    return 1;
+}
+
+static inline int ring_link_start(ring_link_t *l, int uart, uint8_t me, int forward)
+{
+    memset(l, 0, sizeof *l);
+    l->uart = uart;
+    l->me = me;
+    l->forward = forward;
+    atomic_store(&l->slot_val, -1);
+    ring_rx_init(&l->rx);
+    pthread_mutex_init(&l->tx, NULL);
+    if (pthread_create(&l->thread, NULL, ring_link_main, l) != 0)
+        return -1;
+    l->running = 1;
+    return 0;
+}
+
+// one line on how the ring did on this node, for the exit path
+static inline void ring_link_report(ring_link_t *l)
+{
+    uint32_t n = atomic_load(&l->hop_n);
+    printf("ring: %u frames cut through, hop mean %u us max %u us; %u bad frames, %u queue drops\n",
+           (unsigned)atomic_load(&l->forwarded), n ? (unsigned)(atomic_load(&l->hop_sum_us) / n) : 0u,
+           (unsigned)atomic_load(&l->hop_max_us), (unsigned)l->rx.bad, (unsigned)atomic_load(&l->dropped));
+}
+
+static inline void ring_link_stop(ring_link_t *l)
+{
+    if (!l->running)
+        return;
+    atomic_store(&l->stop, 1);
+    pthread_join(l->thread, NULL);
+    l->running = 0;
+}
+
+#endif
@@ -0,0 +1,341 @@
+// adversary.c — search for the worst K matrices the cradle can draw
+// generate_matrix() draws Sopt[1], eight Sopt steps, nine band half-widths and a LEFT/UP path. Random draws
+// almost never land on the nasty combinations (narrow bands next to a steep step right where the controller
+// probes), so instead of sampling we search that space for the scenario that hurts the controller most:
+//   --objective ttc     longest time-to-calm. a scenario that never calms beats any that does
+//   --objective panic   most PANIC JUMP/BLOCKs in move_to_cell(), longer sessions break ties
+// Everything stays inside scenario_sample()'s ranges, so whatever it finds the real draw can produce too.
+// A session is deterministic given its scenario, so a score is one simulation.
+//
+// Search: a steady evolutionary loop (tournament of 3, uniform crossover, 1-3 point mutations, the best
+// ELITE kept) seeded from ordinary draws, then a hill climb over every single-field change of the winner.
+// The same budget of plain random draws is run first so the report says what the search bought.
+// The worst scenarios are printed in the sim --scenario format.
+//
+// usage: adversary [--budget N] [--pop N] [--objective ttc|panic] [--seed N] [--top N] [--rules]
+//                  [--changepoint] [--threshold-bpm N] [--tau S] [--convergence S] [--continuous] [--stress-tau S]
+// build: gcc -O2 -pthread -o adversary adversary.c sim.c batch.c corpus.c trace.c lockstep.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+
+#define OBJ_TTC 0
+#define OBJ_PANIC 1
+
+#define NEVER_CALM 1e6 // score of a session that never calms (ttc objective)
+#define ELITE 4
+#define MAX_TOP 32
+
+typedef struct
+{
+    SimScenario sc;
+    double score;
+    SimResult r;
+} Cand;
+
+static SimParams g_p;
+static int g_obj = OBJ_TTC;
+static long g_evals;
+static SimWorld g_rng; // only its PRNG is used
+
+static Cand g_top[MAX_TOP]; // worst distinct scenarios seen, worst first
+static int g_ntop, g_top_cap = 5;
+
+static int rand_below(int n)
+{
+    return (int)(sim_rand(&g_rng) % (uint32_t)n);
+}
+
+static double score_of(const SimResult *r)
+{
+    if (g_obj == OBJ_PANIC)
+        return r->panics * 1000.0 + r->end_t;
+    return r->calm ? r->calm_t : NEVER_CALM + r->end_t;
+}
+
+static void keep_top(const Cand *c)
+{
+    for (int i = 0; i < g_ntop; i++)
+        if (memcmp(&g_top[i].sc, &c->sc, sizeof c->sc) == 0)
+            return;
+    if (g_ntop == g_top_cap && c->score <= g_top[g_ntop - 1].score)
+        return;
+    int i = (g_ntop < g_top_cap) ? g_ntop++ : g_ntop - 1;
+    while (i > 0 && g_top[i - 1].score < c->score)
+    {
+        g_top[i] = g_top[i - 1];
+        i--;
+    }
+    g_top[i] = *c;
+}
+
+static void evaluate(Cand *c)
+{
+    if (sim_run_scenario(&g_p, &c->sc, 0, 0, &c->r) != 0)
+    {
+        printf("[SYSTEM][ERROR] could not run a session\n");
+        exit(1);
+    }
+    c->score = score_of(&c->r);
+    g_evals++;
+    keep_top(c);
+}
+
+// change one field by one notch (or swap a LEFT and an UP in the path), staying in range
+static void mutate_one(SimScenario *sc)
+{
+    int which = rand_below(18);
+    int d = rand_below(2) ? 1 : -1;
+    if (which == 0)
+    {
+        int v = sc->sopt1 + d;
+        if (v >= SC_SOPT1_MIN && v <= SC_SOPT1_MAX)
+            sc->sopt1 = (uint8_t)v;
+    }
+    else if (which <= 8)
+    {
+        int v = sc->step[which - 1] + d;
+        if (v >= SC_STEP_MIN && v <= SC_STEP_MAX)
+            sc->step[which - 1] = (uint8_t)v;
+    }
+    else if (which <= 16)
+    {
+        int k = rand_below(9);
+        int v = sc->half[k] + d;
+        if (v >= SC_HALF_MIN && v <= SC_HALF_MAX)
+            sc->half[k] = (uint8_t)v;
+    }
+    else
+    {
+        // swap two path steps that differ, keeps four of each
+        int i = rand_below(8), j = rand_below(8);
+        int bi = (sc->path >> i) & 1, bj = (sc->path >> j) & 1;
+        if (bi != bj)
+            sc->path ^= (uint8_t)((1u << i) | (1u << j));
+    }
+}
+
+static void crossover(const SimScenario *a, const SimScenario *b, SimScenario *out)
+{
+    out->sopt1 = rand_below(2) ? a->sopt1 : b->sopt1;
+    for (int i = 0; i < 8; i++)
+        out->step[i] = rand_below(2) ? a->step[i] : b->step[i];
+    for (int i = 0; i < 9; i++)
+        out->half[i] = rand_below(2) ? a->half[i] : b->half[i];
+    out->path = rand_below(2) ? a->path : b->path; // a path only makes sense whole
+}
+
+static int tournament(const Cand *pop, int n)
+{
+    int best = rand_below(n);
+    for (int k = 0; k < 2; k++)
+    {
+        int c = rand_below(n);
+        if (pop[c].score > pop[best].score)
+            best = c;
+    }
+    return best;
+}
+
+static int cmp_cand(const void *a, const void *b)
+{
+    double x = ((const Cand *)a)->score, y = ((const Cand *)b)->score;
+    return (x < y) - (x > y); // worst (highest score) first
+}
+
+// first improvement over all single-notch neighbours until none is worse for the controller
+static void hill_climb(Cand *c, long budget)
+{
+    int improved = 1;
+    while (improved && g_evals < budget)
+    {
+        improved = 0;
+        for (int f = 0; f < 18 + 28 && !improved && g_evals < budget; f++)
+            for (int d = -1; d <= 1 && !improved; d += 2)
+            {
+                Cand n = *c;
+                if (f == 0)
+                    n.sc.sopt1 = (uint8_t)(n.sc.sopt1 + d);
+                else if (f <= 8)
+                    n.sc.step[f - 1] = (uint8_t)(n.sc.step[f - 1] + d);
+                else if (f <= 17)
+                    n.sc.half[f - 9] = (uint8_t)(n.sc.half[f - 9] + d);
+                else
+                {
+                    // the 28 pairs (i, j) of path steps; only one direction needed
+                    if (d > 0)
+                        continue;
+                    int pair = f - 18, i = 0, j;
+                    while (pair >= 7 - i)
+                        pair -= 7 - i++;
+                    j = i + 1 + pair;
+                    if (((n.sc.path >> i) & 1) == ((n.sc.path >> j) & 1))
+                        continue;
+                    n.sc.path ^= (uint8_t)((1u << i) | (1u << j));
+                }
+                if (n.sc.sopt1 < SC_SOPT1_MIN || n.sc.sopt1 > SC_SOPT1_MAX)
+                    continue;
+                if (f >= 1 && f <= 8 && (n.sc.step[f - 1] < SC_STEP_MIN || n.sc.step[f - 1] > SC_STEP_MAX))
+                    continue;
+                if (f >= 9 && f <= 17 && (n.sc.half[f - 9] < SC_HALF_MIN || n.sc.half[f - 9] > SC_HALF_MAX))
+                    continue;
+                evaluate(&n);
+                if (n.score > c->score)
+                {
+                    *c = n;
+                    improved = 1;
+                }
+            }
+    }
+}
+
+static void print_cand(const Cand *c)
+{
+    char buf[SIM_SCENARIO_STR];
+    sim_scenario_format(&c->sc, buf, sizeof buf);
+    if (c->r.calm)
+        printf("  calm after %6.1f s  %2d moves  %d panics   %s\n", c->r.calm_t, c->r.moves, c->r.panics, buf);
+    else
+        printf("  never calm%s       %2d moves  %d panics   %s\n", c->r.ctrl_panic ? " (frozen)" : "         ",
+               c->r.moves, c->r.panics, buf);
+}
+
+int main(int argc, char **argv)
+{
+    sim_params_default(&g_p);
+    g_p.policy = &policy_table; // what decision/main.c runs with CONTROLLER_USE_POLICY = 1
+    long budget = 20000;
+    int pop_n = 64;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--rules") == 0)
+            g_p.policy = NULL;
+        else if (strcmp(a, "--changepoint") == 0)
+            g_p.hist_mode = HIST_CHANGEPOINT;
+        else if (strcmp(a, "--budget") == 0 && v)
+            budget = atol(argv[++i]);
+        else if (strcmp(a, "--pop") == 0 && v)
+            pop_n = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--top") == 0 && v)
+            g_top_cap = atoi(argv[++i]);
+        else if (strcmp(a, "--objective") == 0 && v)
+        {
+            const char *o = argv[++i];
+            if (strcmp(o, "ttc") == 0)
+                g_obj = OBJ_TTC;
+            else if (strcmp(o, "panic") == 0)
+                g_obj = OBJ_PANIC;
+            else
+            {
+                printf("unknown objective %s\n", o);
+                return 1;
+            }
+        }
+        else if (strcmp(a, "--threshold-bpm") == 0 && v)
+            g_p.thresholdBPM = atoi(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            g_p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            g_p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            g_p.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            g_p.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    if (budget < 2 * pop_n || pop_n < ELITE + 2)
+    {
+        printf("need --pop > %d and --budget >= 2 x pop\n", ELITE + 1);
+        return 1;
+    }
+    if (g_top_cap < 1)
+        g_top_cap = 1;
+    if (g_top_cap > MAX_TOP)
+        g_top_cap = MAX_TOP;
+
+    printf("adversary: %s controller, objective %s, budget %ld sessions per search\n",
+           g_p.policy ? "policy" : "rules", g_obj == OBJ_TTC ? "time-to-calm" : "panics", budget);
+
+    // baseline: the same number of ordinary draws (seeds seed..), what plain Monte Carlo would have found
+    Cand worst_random = {.score = -1.0};
+    int random_panicked = 0, random_never = 0;
+    for (long i = 0; i < budget; i++)
+    {
+        Cand c;
+        sim_seed(&g_rng, seed + (uint64_t)i);
+        scenario_sample(&g_rng, &c.sc);
+        evaluate(&c);
+        random_panicked += c.r.panics > 0;
+        random_never += !c.r.calm;
+        if (c.score > worst_random.score)
+            worst_random = c;
+    }
+    printf("\nrandom draws: %ld sessions, %d panicked, %d never calmed. worst:\n", budget, random_panicked,
+           random_never);
+    print_cand(&worst_random);
+
+    // the search gets its own budget and starts from fresh draws
+    g_evals = 0;
+    g_ntop = 0;
+    sim_seed(&g_rng, seed ^ 0x5DEECE66Dull);
+    Cand *pop = calloc((size_t)pop_n, sizeof *pop);
+    if (!pop)
+        return 1;
+    for (int i = 0; i < pop_n; i++)
+    {
+        scenario_sample(&g_rng, &pop[i].sc);
+        evaluate(&pop[i]);
+    }
+
+    long climb_budget = budget / 10; // the tail of the budget polishes the winner
+    int gen = 0;
+    while (g_evals < budget - climb_budget)
+    {
+        qsort(pop, (size_t)pop_n, sizeof *pop, cmp_cand);
+        Cand *next = calloc((size_t)pop_n, sizeof *next);
+        if (!next)
+            return 1;
+        memcpy(next, pop, ELITE * sizeof *pop);
+        for (int i = ELITE; i < pop_n && g_evals < budget - climb_budget; i++)
+        {
+            const Cand *a = &pop[tournament(pop, pop_n)], *b = &pop[tournament(pop, pop_n)];
+            crossover(&a->sc, &b->sc, &next[i].sc);
+            int m = 1 + rand_below(3);
+            for (int k = 0; k < m; k++)
+                mutate_one(&next[i].sc);
+            evaluate(&next[i]);
+        }
+        free(pop);
+        pop = next;
+        gen++;
+    }
+    qsort(pop, (size_t)pop_n, sizeof *pop, cmp_cand);
+    Cand best = pop[0];
+    printf("\nevolution: %d generations, %ld sessions, worst score %.1f\n", gen, g_evals, best.score);
+    hill_climb(&best, budget);
+    printf("hill climb: %ld sessions in total\n", g_evals);
+
+    printf("\nworst scenarios found (rerun one with sim --scenario \"...\"):\n");
+    for (int i = 0; i < g_ntop; i++)
+        print_cand(&g_top[i]);
+    if (g_obj == OBJ_TTC && g_top[0].r.calm)
+        printf("\nworst-case time-to-calm: %.1f s (random draws: %.1f s)\n", g_top[0].r.calm_t,
+               worst_random.r.calm ? worst_random.r.calm_t : 0.0);
+
+    free(pop);
+    return 0;
+}
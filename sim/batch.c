@@ -0,0 +1,263 @@
+// batch.c — Monte Carlo batch runner
+// Spreads n independent sessions (seed, seed+1, ...) over all cores and reports distributions
+// instead of one printf log. Every session gets its own SimWorld, so the threads share nothing but
+// the scheduler and the result array (each thread only writes its own slots).
+//
+// Scheduling is work stealing over index ranges: every worker starts with an equal slice and eats it
+// from the front; a worker that runs dry steals the back half of the fullest other slice. Sessions
+// differ a lot in length (a panic costs many extra steps), so this keeps every core busy until the end
+// without a shared queue that all threads fight over.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sim.h"
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    int next; // next index to run
+    int end;  // one past the last index owned
+} WorkRange;
+
+typedef struct
+{
+    const SimParams *p;
+    uint64_t seed;
+    SimResult *out;
+    WorkRange *ranges;
+    int nworkers;
+} BatchShared;
+
+typedef struct
+{
+    BatchShared *sh;
+    int id;
+} WorkerArg;
+
+// take one index from the front of our own range, -1 when empty
+static int take_own(WorkRange *r)
+{
+    int i = -1;
+    pthread_mutex_lock(&r->lock);
+    if (r->next < r->end)
+        i = r->next++;
+    pthread_mutex_unlock(&r->lock);
+    return i;
+}
+
+// steal the back half of the largest other range into ours. returns 0 if everything is drained.
+static int steal(BatchShared *sh, int self)
+{
+    for (;;)
+    {
+        // pick the victim with the most work left (it may shrink before we lock it again, so re-check below)
+        int victim = -1, best = 0;
+        for (int v = 0; v < sh->nworkers; v++)
+        {
+            if (v == self)
+                continue;
+            pthread_mutex_lock(&sh->ranges[v].lock);
+            int left = sh->ranges[v].end - sh->ranges[v].next;
+            pthread_mutex_unlock(&sh->ranges[v].lock);
+            if (left > best)
+            {
+                best = left;
+                victim = v;
+            }
+        }
+        if (victim < 0)
+            return 0;
+
+        WorkRange *vr = &sh->ranges[victim];
+        int lo = 0, hi = 0;
+        pthread_mutex_lock(&vr->lock);
+        int left = vr->end - vr->next;
+        if (left > 0)
+        {
+            int take = (left + 1) / 2; // at least one
+            hi = vr->end;
+            lo = hi - take;
+            vr->end = lo;
+        }
+        pthread_mutex_unlock(&vr->lock);
+
+        if (hi > lo)
+        {
+            WorkRange *own = &sh->ranges[self];
+            pthread_mutex_lock(&own->lock);
+            own->next = lo;
+            own->end = hi;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+        // someone beat us to it, look again
+    }
+}
+
+static void *batch_worker(void *arg)
+{
+    WorkerArg *wa = arg;
+    BatchShared *sh = wa->sh;
+
+    for (;;)
+    {
+        int i = take_own(&sh->ranges[wa->id]);
+        if (i < 0)
+        {
+            if (!steal(sh, wa->id))
+                break;
+            continue;
+        }
+        if (sim_run_session(sh->p, sh->seed + (uint64_t)i, 0, &sh->out[i]) != 0)
+            sh->out[i].end_t = -1.0; // mark it, checked once all threads are done
+    }
+    return NULL;
+}
+
+// run n sessions with seeds seed..seed+n-1 on `threads` workers (<= 0 means one per core).
+// out must hold n results; out[i] always belongs to seed+i, no matter which thread ran it.
+int sim_batch(const SimParams *p, int n, int threads, uint64_t seed, SimResult *out)
+{
+    if (n <= 0)
+        return 0;
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cores > 0) ? (int)cores : 1;
+    }
+    if (threads > n)
+        threads = n;
+
+    BatchShared sh = {p, seed, out, NULL, threads};
+    sh.ranges = calloc((size_t)threads, sizeof *sh.ranges);
+    pthread_t *tids = calloc((size_t)threads, sizeof *tids);
+    WorkerArg *args = calloc((size_t)threads, sizeof *args);
+    if (!sh.ranges || !tids || !args)
+    {
+        free(sh.ranges);
+        free(tids);
+        free(args);
+        return -1;
+    }
+
+    // equal slices up front, stealing evens out the rest
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_mutex_init(&sh.ranges[t].lock, NULL);
+        sh.ranges[t].next = (int)((long long)n * t / threads);
+        sh.ranges[t].end = (int)((long long)n * (t + 1) / threads);
+    }
+
+    int started = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        args[t].sh = &sh;
+        args[t].id = t;
+        if (pthread_create(&tids[t], NULL, batch_worker, &args[t]) != 0)
+            break;
+        started++;
+    }
+    if (started == 0)
+        batch_worker(&args[0]); // no threads at all: just do it here
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+
+    for (int t = 0; t < threads; t++)
+        pthread_mutex_destroy(&sh.ranges[t].lock);
+    free(sh.ranges);
+    free(tids);
+    free(args);
+
+    for (int i = 0; i < n; i++)
+        if (out[i].end_t < 0.0)
+            return -1;
+    return 0;
+}
+
+// REPORT
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of a sorted array
+static double pct(const double *v, int n, double q)
+{
+    if (n <= 0)
+        return 0.0;
+    int i = (int)(q * (n - 1) + 0.5);
+    return v[i];
+}
+
+double sim_percentile(double *v, int n, double q)
+{
+    qsort(v, (size_t)n, sizeof *v, cmp_double);
+    return pct(v, n, q);
+}
+
+static void print_dist(const char *name, double *v, int n)
+{
+    if (n <= 0)
+    {
+        printf("%-14s n=0\n", name);
+        return;
+    }
+    qsort(v, (size_t)n, sizeof *v, cmp_double);
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        sum += v[i];
+    printf("%-14s n=%-7d mean=%8.2f  min=%7.2f  p10=%7.2f  p50=%7.2f  p90=%7.2f  p95=%7.2f  p99=%7.2f  max=%7.2f\n",
+           name, n, sum / n, v[0], pct(v, n, 0.10), pct(v, n, 0.50), pct(v, n, 0.90),
+           pct(v, n, 0.95), pct(v, n, 0.99), v[n - 1]);
+}
+
+void sim_batch_report(const SimResult *res, int n)
+{
+    double *v = malloc((size_t)(n > 0 ? n : 1) * sizeof *v);
+    if (!v)
+        return;
+
+    int calm = 0;
+    for (int i = 0; i < n; i++)
+        if (res[i].calm)
+            v[calm++] = res[i].calm_t;
+    printf("sessions       %d, calm %d (%.1f%%)\n", n, calm, n ? 100.0 * calm / n : 0.0);
+    print_dist("time-to-calm", v, calm);
+
+    for (int i = 0; i < n; i++)
+        v[i] = res[i].moves;
+    print_dist("moves", v, n);
+
+    int panicked = 0;
+    for (int i = 0; i < n; i++)
+    {
+        v[i] = res[i].panics;
+        if (res[i].panics > 0)
+            panicked++;
+    }
+    print_dist("panics", v, n);
+    printf("%-14s %d sessions (%.2f%%) panicked at least once\n", "", panicked, n ? 100.0 * panicked / n : 0.0);
+
+    int frozen = 0;
+    for (int i = 0; i < n; i++)
+        frozen += res[i].ctrl_panic ? 1 : 0;
+    printf("%-14s %d sessions (%.2f%%) ended in controller panic mode\n", "", frozen, n ? 100.0 * frozen / n : 0.0);
+
+    int finalK[10] = {0};
+    for (int i = 0; i < n; i++)
+        if (res[i].finalK >= 1 && res[i].finalK <= 9)
+            finalK[res[i].finalK]++;
+    printf("final K       ");
+    for (int k = 1; k <= 9; k++)
+        printf(" K%d:%d", k, finalK[k]);
+    printf("\n");
+
+    free(v);
+}
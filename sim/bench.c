@@ -0,0 +1,272 @@
+// bench.c — time-to-calm benchmark
+// Runs a fixed seed corpus (seeds 1..N, the same every time) through the simulator and prints the numbers
+// as key=value lines, one metric per line, so scripts and diffs can read them:
+//   ttc.median / ttc.p95 / ttc.mean   time-to-calm of the sessions that calmed (simulated seconds), nan if none
+//   calm.rate                         fraction of sessions that calmed
+//   moves.median / moves.p95          motor commands per session
+//   panic.rate                        fraction of sessions with at least one plant panic
+//   ctrl_panic.rate                   fraction that ended frozen in controller panic mode
+//   area.median / area.p95            integrated stress (S x seconds) over the session
+// --save FILE stores the result as a baseline, --compare FILE checks against one and exits 1 on a regression
+// (a metric worse than the baseline by more than --tolerance, relative).
+//
+// usage: bench [--sessions N] [--policy] [--threads T] [--lockstep] [--save FILE] [--compare FILE] [--tolerance F]
+//              [--changepoint] [--threshold-bpm N] [--tau S] [--convergence S] [--continuous] [--stress-tau S]
+//              [--sensor ideal|real] [sensor options, see sim.h]
+// build: gcc -O2 -pthread -o bench bench.c sim.c batch.c corpus.c trace.c lockstep.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+
+#define BENCH_SEED 1
+#define MAX_METRICS 16
+
+typedef struct
+{
+    const char *key;
+    double value;
+    int higher_is_better;
+} Metric;
+
+static int g_nm;
+static Metric g_m[MAX_METRICS];
+
+static void add_metric(const char *key, double value, int higher_is_better)
+{
+    if (g_nm < MAX_METRICS)
+        g_m[g_nm++] = (Metric){key, value, higher_is_better};
+}
+
+static void collect(const SimResult *res, int n)
+{
+    double *v = malloc((size_t)n * sizeof *v);
+    if (!v)
+        return;
+
+    int calm = 0;
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        if (res[i].calm)
+        {
+            v[calm++] = res[i].calm_t;
+            sum += res[i].calm_t;
+        }
+    add_metric("calm.rate", (double)calm / n, 1);
+    // nothing calmed: no time-to-calm at all, not a time of 0. compare() counts nan as worse than any number
+    add_metric("ttc.median", calm ? sim_percentile(v, calm, 0.50) : NAN, 0);
+    add_metric("ttc.p95", calm ? sim_percentile(v, calm, 0.95) : NAN, 0);
+    add_metric("ttc.mean", calm ? sum / calm : NAN, 0);
+
+    for (int i = 0; i < n; i++)
+        v[i] = res[i].moves;
+    add_metric("moves.median", sim_percentile(v, n, 0.50), 0);
+    add_metric("moves.p95", sim_percentile(v, n, 0.95), 0);
+
+    int panicked = 0, frozen = 0;
+    for (int i = 0; i < n; i++)
+    {
+        panicked += res[i].panics > 0;
+        frozen += res[i].ctrl_panic != 0;
+    }
+    add_metric("panic.rate", (double)panicked / n, 0);
+    add_metric("ctrl_panic.rate", (double)frozen / n, 0);
+
+    for (int i = 0; i < n; i++)
+        v[i] = res[i].stress_area;
+    add_metric("area.median", sim_percentile(v, n, 0.50), 0);
+    add_metric("area.p95", sim_percentile(v, n, 0.95), 0);
+
+    free(v);
+}
+
+// run settings, printed as bench.* lines so a baseline says what it was measured with
+#define N_SETTINGS 8
+static char g_set[N_SETTINGS][2][160];
+
+static void describe(const char *controller, int n, const SimParams *p)
+{
+    static const char *keys[N_SETTINGS] = {"bench.controller", "bench.sessions", "bench.history",
+                                           "bench.threshold_bpm", "bench.tau", "bench.convergence",
+                                           "bench.stress", "bench.sensor"};
+    for (int i = 0; i < N_SETTINGS; i++)
+        snprintf(g_set[i][0], sizeof g_set[i][0], "%s", keys[i]);
+    snprintf(g_set[0][1], sizeof g_set[0][1], "%s", controller);
+    snprintf(g_set[1][1], sizeof g_set[1][1], "%d", n);
+    snprintf(g_set[2][1], sizeof g_set[2][1], "%s", p->hist_mode == HIST_CHANGEPOINT ? "changepoint" : "dense");
+    snprintf(g_set[3][1], sizeof g_set[3][1], "%d", p->thresholdBPM);
+    snprintf(g_set[4][1], sizeof g_set[4][1], "%.2f", p->TAU);
+    snprintf(g_set[5][1], sizeof g_set[5][1], "%.2f", p->convergence_time);
+    if (p->stress_model == STRESS_EXP)
+        snprintf(g_set[6][1], sizeof g_set[6][1], "exp %.2f", p->stress_tau);
+    else
+        snprintf(g_set[6][1], sizeof g_set[6][1], "instant");
+    sim_sensor_describe(&p->sensor, g_set[7][1], sizeof g_set[7][1]);
+}
+
+static void print_metrics(FILE *f)
+{
+    for (int i = 0; i < N_SETTINGS; i++)
+        fprintf(f, "%s=%s\n", g_set[i][0], g_set[i][1]);
+    for (int i = 0; i < g_nm; i++)
+        fprintf(f, "%s=%.4f\n", g_m[i].key, g_m[i].value);
+}
+
+// compare against a saved baseline. returns the number of regressions
+static int compare(const char *path, double tol)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        printf("[SYSTEM][ERROR] could not read baseline %s\n", path);
+        return -1;
+    }
+
+    int regressions = 0;
+    char line[256];
+    while (fgets(line, sizeof line, f))
+    {
+        char *eq = strchr(line, '=');
+        if (!eq)
+            continue;
+        *eq = '\0';
+        char *val = eq + 1;
+        val[strcspn(val, "\r\n")] = '\0';
+
+        // run settings: comparing different setups is allowed, but say so
+        for (int i = 0; i < N_SETTINGS; i++)
+            if (strcmp(g_set[i][0], line) == 0 && strcmp(g_set[i][1], val) != 0)
+                printf("note: baseline %s=%s, this run %s\n", line, val, g_set[i][1]);
+
+        for (int i = 0; i < g_nm; i++)
+        {
+            if (strcmp(g_m[i].key, line) != 0)
+                continue;
+            double base = atof(val);
+            double cur = g_m[i].value;
+            double worse = g_m[i].higher_is_better ? base - cur : cur - base;
+            double scale = fabs(base) > 1e-9 ? fabs(base) : 1.0;
+            int bad = worse / scale > tol;
+            if (isnan(cur) || isnan(base))
+                bad = isnan(cur) && !isnan(base); // a metric that went missing got worse, one that appeared did not
+            printf("%-16s base %10.4f  now %10.4f  %+7.2f%%%s\n", g_m[i].key, base, cur,
+                   fabs(base) > 1e-9 ? 100.0 * (cur - base) / fabs(base) : 0.0, bad ? "  REGRESSION" : "");
+            regressions += bad;
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    SimParams p;
+    sim_params_default(&p);
+    // the hand-written rules, what decision/main.c ships with (CONTROLLER_USE_POLICY = 0)
+    int n = 10000, threads = 0;
+    double tol = 0.02;
+    const char *save = NULL, *base = NULL;
+    int lockstep = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (sim_sensor_option(&p.sensor, argc, argv, &i))
+            continue;
+        if (strcmp(a, "--policy") == 0)
+            p.policy = &policy_table;
+        else if (strcmp(a, "--rules") == 0)
+            p.policy = NULL;
+        else if (strcmp(a, "--changepoint") == 0)
+            p.hist_mode = HIST_CHANGEPOINT;
+        else if (strcmp(a, "--lockstep") == 0)
+            lockstep = 1;
+        else if (strcmp(a, "--sessions") == 0 && v)
+            n = atoi(argv[++i]);
+        else if (strcmp(a, "--threads") == 0 && v)
+            threads = atoi(argv[++i]);
+        else if (strcmp(a, "--save") == 0 && v)
+            save = argv[++i];
+        else if (strcmp(a, "--compare") == 0 && v)
+            base = argv[++i];
+        else if (strcmp(a, "--tolerance") == 0 && v)
+            tol = atof(argv[++i]);
+        else if (strcmp(a, "--threshold-bpm") == 0 && v)
+            p.thresholdBPM = atoi(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            p.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            p.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    if (n <= 0)
+        return 1;
+    const char *bad = sim_sensor_check(&p.sensor);
+    if (bad)
+    {
+        printf("%s\n", bad);
+        return 1;
+    }
+
+    SimResult *res = calloc((size_t)n, sizeof *res);
+    if (!res)
+        return 1;
+    int rc;
+    if (lockstep)
+    {
+        p.hist_mode = HIST_CHANGEPOINT; // the only history it keeps
+        rc = sim_lockstep_batch(&p, n, threads, BENCH_SEED, res);
+    }
+    else
+        rc = sim_batch(&p, n, threads, BENCH_SEED, res);
+    if (rc != 0)
+    {
+        printf("[SYSTEM][ERROR] some sessions failed to run\n");
+        free(res);
+        return 1;
+    }
+    collect(res, n);
+    free(res);
+
+    describe(p.policy ? "policy" : "rules", n, &p);
+    print_metrics(stdout);
+
+    if (save)
+    {
+        FILE *f = fopen(save, "w");
+        if (!f)
+        {
+            printf("[SYSTEM][ERROR] could not write %s\n", save);
+            return 1;
+        }
+        print_metrics(f);
+        fclose(f);
+    }
+
+    if (base)
+    {
+        printf("\ncompare against %s (tolerance %.1f%%)\n", base, 100.0 * tol);
+        int r = compare(base, tol);
+        if (r != 0)
+        {
+            if (r > 0)
+                printf("%d regression(s)\n", r);
+            return 1;
+        }
+        printf("no regressions\n");
+    }
+    return 0;
+}
@@ -0,0 +1,303 @@
+// corpus.c — exhaustive scenario corpus
+// Instead of sampling, walk every one of the C(8,4) = 70 K-path shapes crossed with a grid of band
+// configurations (Sopt[1] x uniform Sopt step x uniform band half-width), run each scenario once and keep
+// scenarios + results in a compact binary cache.
+//
+// Re-scoring only reruns what can change:
+//  - the cache header carries a fingerprint of every knob except thresholdBPM (plus SIM_CONTROLLER_REV).
+//    a different fingerprint means timing or logic changed, and everything is rerun.
+//  - every result also stores [thr_lo, thr_hi], the thresholdBPM values for which each threshold comparison
+//    in that session comes out the same (see heartbeat_improved). a new threshold inside that range replays
+//    the session decision for decision, so only scenarios whose range does not contain it are rerun.
+//
+// cache layout, little endian:
+//   header  "RYBC" | u16 version | u16 record size | u32 count | u64 fingerprint
+//   record  u8 sopt1 | u8 step[8] | u8 half[9] | u8 path                       (scenario, 19 bytes)
+//           u8 flags (bit0 calm, bit1 ctrl_panic) | u8 finalK | u16 moves | u16 panics
+//           u32 calm_ms | u32 end_ms | u32 visited | i16 thr_lo | i16 thr_hi
+//           u32 stress_area (x10)                                               (result, 26 bytes)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+#define CORPUS_MAGIC "RYBC"
+#define CORPUS_VERSION 4
+#define CORPUS_HDR_SIZE 20
+#define CORPUS_REC_SIZE 45
+
+// band grid
+#define GRID_SOPT1_LO 10
+#define GRID_SOPT1_HI 15
+#define GRID_STEP_LO 7
+#define GRID_STEP_HI 11
+#define GRID_HALF_LO 6
+#define GRID_HALF_HI 12
+#define N_PATHS 70
+
+// little endian helpers
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+static void put_u64(uint8_t *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+static uint64_t get_u64(const uint8_t *p) { return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32); }
+
+// FNV-1a over the knobs that can change an outcome
+static uint64_t fnv(uint64_t h, const void *data, size_t n)
+{
+    const uint8_t *b = data;
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= b[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+uint64_t sim_params_fingerprint(const SimParams *p)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    int32_t rev = SIM_CONTROLLER_REV;
+    int32_t mode = p->hist_mode;
+    int32_t len = p->hist_len;
+    h = fnv(h, &rev, sizeof rev);
+    h = fnv(h, &p->TAU, sizeof p->TAU);
+    h = fnv(h, &p->convergence_time, sizeof p->convergence_time);
+    h = fnv(h, &mode, sizeof mode);
+    h = fnv(h, &len, sizeof len);
+    if (p->policy)
+    {
+        h = fnv(h, p->policy->first_dir, sizeof p->policy->first_dir);
+        h = fnv(h, p->policy->on_fail, sizeof p->policy->on_fail);
+        h = fnv(h, p->policy->wait_ms, sizeof p->policy->wait_ms);
+    }
+    controller_consts_t k;
+    controller_consts_default(&k);
+    if (p->thresholdCRY != 1 || memcmp(&p->consts, &k, sizeof k) != 0) // same for the shipped constants
+    {
+        int32_t thr = p->thresholdCRY;
+        h = fnv(h, &thr, sizeof thr);
+        h = fnv(h, &p->consts, sizeof p->consts);
+    }
+    if (p->mpc)
+    {
+        int32_t mpc = MPC_ROLLOUTS;
+        h = fnv(h, &mpc, sizeof mpc);
+    }
+    if (p->poll_ms > 0)
+    {
+        int32_t poll = p->poll_ms;
+        h = fnv(h, &poll, sizeof poll);
+    }
+    if (p->stress_model != STRESS_INSTANT) // instant-model caches from before the model existed stay valid
+    {
+        int32_t model = p->stress_model;
+        h = fnv(h, &model, sizeof model);
+        h = fnv(h, &p->stress_tau, sizeof p->stress_tau);
+    }
+    if (!sim_sensor_ideal(&p->sensor)) // same for the ideal sensor
+    {
+        const SimSensor *s = &p->sensor;
+        int32_t ints[3] = {s->bpm_beats, s->bpm_step, s->cry_step};
+        double dbls[6] = {s->bpm_jitter, s->cry_gain, s->cry_offset, s->cry_noise, s->cry_lag, s->dropout};
+        h = fnv(h, ints, sizeof ints);
+        h = fnv(h, dbls, sizeof dbls);
+        if (s->bpm_map[1] != 0.0 || s->cry_map[1] != 0.0) // fitted mappings (sysid)
+        {
+            h = fnv(h, s->bpm_map, sizeof s->bpm_map);
+            h = fnv(h, s->cry_map, sizeof s->cry_map);
+        }
+    }
+    return h;
+}
+
+// every scenario of the corpus, band configuration outermost so the 70 paths of one configuration sit together
+static int corpus_enumerate(SimScenario *out)
+{
+    uint8_t paths[N_PATHS];
+    int np = 0;
+    for (int m = 0; m < 256; m++)
+        if (__builtin_popcount(m) == 4)
+            paths[np++] = (uint8_t)m;
+
+    int n = 0;
+    for (int s1 = GRID_SOPT1_LO; s1 <= GRID_SOPT1_HI; s1++)
+        for (int st = GRID_STEP_LO; st <= GRID_STEP_HI; st++)
+            for (int hw = GRID_HALF_LO; hw <= GRID_HALF_HI; hw++)
+                for (int i = 0; i < np; i++)
+                {
+                    if (out)
+                    {
+                        SimScenario *sc = &out[n];
+                        sc->sopt1 = (uint8_t)s1;
+                        memset(sc->step, st, sizeof sc->step);
+                        memset(sc->half, hw, sizeof sc->half);
+                        sc->path = paths[i];
+                    }
+                    n++;
+                }
+    return n;
+}
+
+static void pack_record(uint8_t *r, const SimScenario *sc, const SimResult *res)
+{
+    r[0] = sc->sopt1;
+    memcpy(r + 1, sc->step, 8);
+    memcpy(r + 9, sc->half, 9);
+    r[18] = sc->path;
+    r[19] = (uint8_t)((res->calm ? 1 : 0) | (res->ctrl_panic ? 2 : 0));
+    r[20] = (uint8_t)res->finalK;
+    put_u16(r + 21, (uint16_t)res->moves);
+    put_u16(r + 23, (uint16_t)res->panics);
+    put_u32(r + 25, res->calm ? (uint32_t)(res->calm_t * 1000.0 + 0.5) : 0);
+    put_u32(r + 29, (uint32_t)(res->end_t * 1000.0 + 0.5));
+    put_u32(r + 33, res->visited);
+    put_u16(r + 37, (uint16_t)(int16_t)res->thr_lo);
+    put_u16(r + 39, (uint16_t)(int16_t)res->thr_hi);
+    put_u32(r + 41, (uint32_t)(res->stress_area * 10.0 + 0.5));
+}
+
+static void unpack_record(const uint8_t *r, SimScenario *sc, SimResult *res)
+{
+    sc->sopt1 = r[0];
+    memcpy(sc->step, r + 1, 8);
+    memcpy(sc->half, r + 9, 9);
+    sc->path = r[18];
+    res->calm = r[19] & 1;
+    res->ctrl_panic = (r[19] >> 1) & 1;
+    res->finalK = r[20];
+    res->moves = get_u16(r + 21);
+    res->panics = get_u16(r + 23);
+    res->calm_t = res->calm ? get_u32(r + 25) / 1000.0 : -1.0;
+    res->end_t = get_u32(r + 29) / 1000.0;
+    res->visited = get_u32(r + 33);
+    res->thr_lo = (int16_t)get_u16(r + 37);
+    res->thr_hi = (int16_t)get_u16(r + 39);
+    res->stress_area = get_u32(r + 41) / 10.0;
+}
+
+// load cached results for exactly this corpus into res, marking the usable ones in valid[].
+// returns how many are usable for thresholdBPM = thr (0 if the file is missing or from another corpus).
+static int corpus_load(const char *path, const SimScenario *sc, int n, uint64_t fp, int thr,
+                       SimResult *res, uint8_t *valid)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+
+    int usable = 0;
+    uint8_t hdr[CORPUS_HDR_SIZE];
+    uint8_t rec[CORPUS_REC_SIZE];
+    if (fread(hdr, 1, sizeof hdr, f) != sizeof hdr || memcmp(hdr, CORPUS_MAGIC, 4) != 0 ||
+        get_u16(hdr + 4) != CORPUS_VERSION || get_u16(hdr + 6) != CORPUS_REC_SIZE ||
+        get_u32(hdr + 8) != (uint32_t)n || get_u64(hdr + 12) != fp)
+    {
+        fclose(f);
+        return 0;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        SimScenario got;
+        SimResult r;
+        if (fread(rec, 1, sizeof rec, f) != sizeof rec)
+            break;
+        unpack_record(rec, &got, &r);
+        if (memcmp(&got, &sc[i], sizeof got) != 0)
+            break; // a different corpus, recompute
+        if (thr >= r.thr_lo && thr <= r.thr_hi)
+        {
+            res[i] = r;
+            valid[i] = 1;
+            usable++;
+        }
+    }
+    fclose(f);
+    return usable;
+}
+
+static int corpus_save(const char *path, const SimScenario *sc, const SimResult *res, int n, uint64_t fp)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    uint8_t hdr[CORPUS_HDR_SIZE];
+    memcpy(hdr, CORPUS_MAGIC, 4);
+    put_u16(hdr + 4, CORPUS_VERSION);
+    put_u16(hdr + 6, CORPUS_REC_SIZE);
+    put_u32(hdr + 8, (uint32_t)n);
+    put_u64(hdr + 12, fp);
+    int rc = (fwrite(hdr, 1, sizeof hdr, f) == sizeof hdr) ? 0 : -1;
+
+    uint8_t rec[CORPUS_REC_SIZE];
+    for (int i = 0; i < n && rc == 0; i++)
+    {
+        pack_record(rec, &sc[i], &res[i]);
+        if (fwrite(rec, 1, sizeof rec, f) != sizeof rec)
+            rc = -1;
+    }
+    if (fclose(f) != 0)
+        rc = -1;
+    return rc;
+}
+
+int sim_corpus(const SimParams *p, const char *cache_path)
+{
+    int n = corpus_enumerate(NULL);
+    SimScenario *sc = malloc((size_t)n * sizeof *sc);
+    SimResult *res = calloc((size_t)n, sizeof *res);
+    uint8_t *valid = calloc((size_t)n, 1);
+    if (!sc || !res || !valid)
+    {
+        free(sc);
+        free(res);
+        free(valid);
+        return -1;
+    }
+    corpus_enumerate(sc);
+    uint64_t fp = sim_params_fingerprint(p);
+
+    int reused = cache_path ? corpus_load(cache_path, sc, n, fp, p->thresholdBPM, res, valid) : 0;
+    int simulated = 0, rc = 0;
+
+    for (int i = 0; i < n && rc == 0; i++)
+    {
+        if (valid[i])
+            continue;
+        if (sim_run_scenario(p, &sc[i], (uint64_t)i, 0, &res[i]) != 0)
+            rc = -1;
+        simulated++;
+    }
+    if (rc == 0 && simulated > 0 && cache_path && corpus_save(cache_path, sc, res, n, fp) != 0)
+        printf("[SYSTEM][ERROR] could not write corpus cache %s\n", cache_path);
+
+    if (rc == 0)
+    {
+        printf("corpus: %d scenarios (%d paths x %d band configs), fingerprint %016llx\n",
+               n, N_PATHS, n / N_PATHS, (unsigned long long)fp);
+        printf("reused %d cached results, simulated %d (thresholdBPM=%d outside their replay range)\n",
+               reused, simulated, p->thresholdBPM);
+        sim_batch_report(res, n);
+    }
+
+    free(sc);
+    free(res);
+    free(valid);
+    return rc;
+}
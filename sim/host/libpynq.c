@@ -0,0 +1,307 @@
+// libpynq.c — host stand-in for libpynq (see libpynq.h)
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "libpynq.h"
+
+#define DEFAULT_UART "/tmp/ryb-ring"
+
+static int g_uart_fd = -1;
+static double g_speed = 1.0;
+static int g_virtual = 0;    // clock set by a harness, see libpynq_host_virtual_clock()
+static double g_virtual_ms = 0.0;
+static float (*g_adc_read)(int channel, void *ctx) = NULL;
+static void *g_adc_ctx = NULL;
+static struct timespec g_t0; // real CLOCK_MONOTONIC at the first read, the origin of the scaled clock
+static pthread_once_t g_t0_once = PTHREAD_ONCE_INIT;
+
+static void t0_init(void)
+{
+    syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &g_t0);
+}
+
+void pynq_init(void)
+{
+    const char *s = getenv("LIBPYNQ_SPEED");
+    if (s && atof(s) > 0.0)
+        g_speed = atof(s);
+    pthread_once(&g_t0_once, t0_init); // before any ring thread starts reading the clock
+    setvbuf(stdout, NULL, _IOLBF, 0); // so the log reads live through a pipe
+}
+
+void pynq_destroy(void)
+{
+    uart_destroy(UART0);
+}
+
+// CLOCK_MONOTONIC runs g_speed times faster than the real one, counted from the first read. main.c times
+// everything (poll cadence, controller steps, time-to-calm) with it, so sleeps and clock agree. The ring thread
+// (ring_link_now_us()) reads it too, so the origin is set under pthread_once()
+int clock_gettime(clockid_t clk, struct timespec *ts)
+{
+    if (g_virtual && clk == CLOCK_MONOTONIC)
+    {
+        ts->tv_sec = (time_t)(g_virtual_ms / 1000.0);
+        ts->tv_nsec = (long)((g_virtual_ms - (double)ts->tv_sec * 1000.0) * 1e6);
+        return 0;
+    }
+    if (clk == CLOCK_MONOTONIC && g_speed != 1.0)
+        pthread_once(&g_t0_once, t0_init); // before our own read, so the first one is not behind the origin
+    int rc = (int)syscall(SYS_clock_gettime, clk, ts);
+    if (rc != 0 || clk != CLOCK_MONOTONIC || g_speed == 1.0)
+        return rc;
+    double dt = ((double)(ts->tv_sec - g_t0.tv_sec) + (double)(ts->tv_nsec - g_t0.tv_nsec) / 1e9) * g_speed;
+    double t = (double)g_t0.tv_sec + (double)g_t0.tv_nsec / 1e9 + dt;
+    ts->tv_sec = (time_t)t;
+    ts->tv_nsec = (long)((t - (double)ts->tv_sec) * 1e9);
+    return 0;
+}
+
+void sleep_msec(int msec)
+{
+    if (msec <= 0)
+        return;
+    if (g_virtual)
+    {
+        g_virtual_ms += msec;
+        return;
+    }
+    double s = msec / 1000.0 / g_speed;
+    struct timespec ts = {(time_t)s, (long)((s - (double)(time_t)s) * 1e9)};
+    nanosleep(&ts, NULL);
+}
+
+// uart: only UART0 exists, it is whatever LIBPYNQ_UART points at
+
+void uart_init(const int uart)
+{
+    if (uart != UART0 || g_uart_fd >= 0)
+        return;
+    const char *path = getenv("LIBPYNQ_UART");
+    if (!path)
+        path = DEFAULT_UART;
+    g_uart_fd = open(path, O_RDWR | O_NOCTTY);
+    if (g_uart_fd < 0)
+    {
+        perror(path);
+        fprintf(stderr, "[LIBPYNQ] no UART (start sim --ring first, or set LIBPYNQ_UART)\n");
+        exit(1);
+    }
+    struct termios tio;
+    if (tcgetattr(g_uart_fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(g_uart_fd, TCSANOW, &tio);
+    }
+}
+
+void uart_destroy(const int uart)
+{
+    if (uart != UART0 || g_uart_fd < 0)
+        return;
+    close(g_uart_fd);
+    g_uart_fd = -1;
+}
+
+void uart_reset_fifos(const int uart)
+{
+    if (uart == UART0 && g_uart_fd >= 0)
+        tcflush(g_uart_fd, TCIOFLUSH);
+}
+
+bool uart_has_data(const int uart)
+{
+    if (uart != UART0 || g_uart_fd < 0)
+        return false;
+    struct pollfd pfd = {g_uart_fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+// blocks until a byte is there, like the hardware FIFO read
+uint8_t uart_recv(const int uart)
+{
+    uint8_t b = 0;
+    if (uart != UART0 || g_uart_fd < 0)
+        return 0;
+    for (;;)
+    {
+        ssize_t n = read(g_uart_fd, &b, 1);
+        if (n == 1)
+            return b;
+        if (n < 0 && errno == EINTR)
+            continue;
+        return 0; // the other end is gone
+    }
+}
+
+void uart_send(const int uart, const uint8_t data)
+{
+    if (uart != UART0 || g_uart_fd < 0)
+        return;
+    while (write(g_uart_fd, &data, 1) != 1)
+        if (errno != EINTR && errno != EAGAIN)
+            return; // the other end is gone, the byte is lost like on an unplugged wire
+}
+
+void switchbox_set_pin(const int pin, const int function)
+{
+    (void)pin;
+    (void)function;
+}
+
+// gpio + adc
+
+void gpio_init(void)
+{
+}
+
+void gpio_destroy(void)
+{
+}
+
+void gpio_set_direction(const int pin, const int direction)
+{
+    (void)pin;
+    (void)direction;
+}
+
+void adc_init(void)
+{
+}
+
+void adc_destroy(void)
+{
+}
+
+float adc_read_channel(const int channel)
+{
+    return g_adc_read ? g_adc_read(channel, g_adc_ctx) : 0.0f;
+}
+
+// switches + buttons
+
+void switches_init(void)
+{
+}
+
+void switches_destroy(void)
+{
+}
+
+int get_switch_state(const int switch_num)
+{
+    const char *s = getenv("LIBPYNQ_SWITCHES");
+    if (!s || switch_num < 0 || switch_num >= (int)strlen(s))
+        return 0;
+    return s[switch_num] == '1';
+}
+
+void buttons_init(void)
+{
+}
+
+void buttons_destroy(void)
+{
+}
+
+int get_button_state(const int button)
+{
+    (void)button;
+    return 0;
+}
+
+// display: nothing to draw on
+
+void display_init(display_t *display)
+{
+    memset(display, 0, sizeof *display);
+}
+
+void display_destroy(display_t *display)
+{
+    (void)display;
+}
+
+void display_set_flip(display_t *display, bool xflip, bool yflip)
+{
+    display->flip_x = xflip;
+    display->flip_y = yflip;
+}
+
+void displayFillScreen(display_t *display, uint16_t color)
+{
+    (void)display;
+    (void)color;
+}
+
+void displayDrawFillRect(display_t *display, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+{
+    (void)display;
+    (void)x1;
+    (void)y1;
+    (void)x2;
+    (void)y2;
+    (void)color;
+}
+
+int displayDrawString(display_t *display, FontxFile *fx, uint16_t x, uint16_t y, uint8_t *ascii, uint16_t color)
+{
+    (void)display;
+    (void)y;
+    (void)color;
+    return x + (int)strlen((const char *)ascii) * (fx->w ? fx->w : 8);
+}
+
+void displaySetFontDirection(display_t *display, uint16_t dir)
+{
+    (void)display;
+    (void)dir;
+}
+
+// the board's font is 8x16
+void InitFontx(FontxFile *fx, const char *f0, const char *f1)
+{
+    (void)f0;
+    (void)f1;
+    fx->w = 8;
+    fx->h = 16;
+}
+
+bool GetFontx(FontxFile *fx, uint8_t ascii, uint8_t *pGlyph, uint8_t *pw, uint8_t *ph)
+{
+    (void)ascii;
+    memset(pGlyph, 0, FontxGlyphBufSize);
+    *pw = fx->w;
+    *ph = fx->h;
+    return true;
+}
+
+// host only
+
+void libpynq_host_virtual_clock(double t_ms)
+{
+    g_virtual = 1;
+    g_virtual_ms = t_ms;
+}
+
+double libpynq_host_time_ms(void)
+{
+    return g_virtual_ms;
+}
+
+void libpynq_host_adc_source(float (*read)(int channel, void *ctx), void *ctx)
+{
+    g_adc_read = read;
+    g_adc_ctx = ctx;
+}
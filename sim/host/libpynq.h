@@ -0,0 +1,120 @@
+// libpynq.h — host stand-in for the parts of libpynq the node programs use
+// Lets decision/main.c build and run on a PC, unmodified, against the simulator's ring (sim --ring):
+//   UART0     a serial device, normally the pseudo-terminal sim --ring opens (LIBPYNQ_UART, default
+//             /tmp/ryb-ring), in raw mode
+//   switches  all off unless LIBPYNQ_SWITCHES says otherwise ("01" = switch 0 off, switch 1 on)
+//   buttons   never pressed
+//   display   draws nothing (main.c mirrors its log to stdout anyway)
+//   time      LIBPYNQ_SPEED=X runs the program's clock X times faster: sleep_msec() sleeps 1/X as long and
+//             clock_gettime() (which main.c calls directly) is scaled to match. give sim --ring the same --speed
+//   adc       0 V, unless a harness installs a source (libpynq_host_adc_source)
+//
+// A harness that runs node code on simulated time (sim/wave_bench.c) switches to a virtual clock instead:
+// clock_gettime(CLOCK_MONOTONIC) returns whatever it last set and sleep_msec() just moves that time on.
+//
+// build (from decision/): gcc -O2 -I../sim/host -o decision_host main.c controller.c ../sim/host/libpynq.c
+
+#ifndef LIBPYNQ_HOST_H
+#define LIBPYNQ_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// channels and pins (values only have to be distinct here)
+enum
+{
+    UART0 = 0,
+    UART1 = 1
+};
+enum
+{
+    IO_AR0 = 0,
+    IO_AR1 = 1,
+    IO_AR2 = 2
+};
+enum
+{
+    SWB_GPIO = 0,
+    SWB_UART0_RX = 1,
+    SWB_UART0_TX = 2
+};
+enum
+{
+    ADC0 = 0,
+    ADC1 = 1
+};
+enum
+{
+    GPIO_DIR_INPUT = 0,
+    GPIO_DIR_OUTPUT = 1
+};
+
+void pynq_init(void);
+void pynq_destroy(void);
+void sleep_msec(int msec);
+
+// uart
+void uart_init(const int uart);
+void uart_destroy(const int uart);
+void uart_reset_fifos(const int uart);
+bool uart_has_data(const int uart);
+uint8_t uart_recv(const int uart);
+void uart_send(const int uart, const uint8_t data);
+void switchbox_set_pin(const int pin, const int function);
+
+// gpio + adc
+void gpio_init(void);
+void gpio_destroy(void);
+void gpio_set_direction(const int pin, const int direction);
+void adc_init(void);
+void adc_destroy(void);
+float adc_read_channel(const int channel);
+
+// switches + buttons
+void switches_init(void);
+void switches_destroy(void);
+int get_switch_state(const int switch_num);
+void buttons_init(void);
+void buttons_destroy(void);
+int get_button_state(const int button);
+
+// display
+#define DISPLAY_WIDTH 240
+#define DISPLAY_HEIGHT 240
+#define FontxGlyphBufSize (32 * 32 / 8)
+#define TEXT_DIRECTION0 0
+
+#define RGB_BLACK 0x0000
+#define RGB_WHITE 0xffff
+#define RGB_RED 0xf800
+#define RGB_GREEN 0x07e0
+#define RGB_BLUE 0x001f
+#define RGB_CYAN 0x07ff
+#define RGB_YELLOW 0xffe0
+
+typedef struct
+{
+    int flip_x, flip_y;
+} display_t;
+
+typedef struct
+{
+    uint8_t w, h;
+} FontxFile;
+
+void display_init(display_t *display);
+void display_destroy(display_t *display);
+void display_set_flip(display_t *display, bool xflip, bool yflip);
+void displayFillScreen(display_t *display, uint16_t color);
+void displayDrawFillRect(display_t *display, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+int displayDrawString(display_t *display, FontxFile *fx, uint16_t x, uint16_t y, uint8_t *ascii, uint16_t color);
+void displaySetFontDirection(display_t *display, uint16_t dir);
+void InitFontx(FontxFile *fx, const char *f0, const char *f1);
+bool GetFontx(FontxFile *fx, uint8_t ascii, uint8_t *pGlyph, uint8_t *pw, uint8_t *ph);
+
+// host only: the virtual clock and where ADC samples come from
+void libpynq_host_virtual_clock(double t_ms); // switch to (and set) the virtual clock
+double libpynq_host_time_ms(void);
+void libpynq_host_adc_source(float (*read)(int channel, void *ctx), void *ctx);
+
+#endif
@@ -0,0 +1,40 @@
+// node_crying.c — crying/main.c's P2P sampler and boot calibration, callable from a PC harness
+// Same trick as node_heartbeat.c: the node's own source, main() renamed. Build against the host libpynq.
+
+#define main crying_node_main
+#include "../../crying/main.c"
+#undef main
+
+#include "nodes.h"
+
+// the node's boot calibration: quiet, the gap, loud, then the runtime sampler reset exactly as main() does it.
+// quiet() / loud() are called right before each phase so the harness can switch its signal
+void node_crying_calibrate(void (*quiet)(void *ctx), void (*loud)(void *ctx), void *ctx)
+{
+    quiet(ctx);
+    g_p2p_quiet = measureQuietP2P(CAL_BASELINE_SAMPLES);
+    sleep_msec(CAL_GAP_MS);
+    loud(ctx);
+    g_p2p_max = measureMaxP2P(CAL_MAX_SAMPLES);
+    if (g_p2p_max < g_p2p_quiet + 0.02f)
+        g_p2p_max = g_p2p_quiet + 0.02f;
+
+    g_last_sample_ms = now_msec_u32();
+    g_win_min = 10.0f;
+    g_win_max = 0.0f;
+    g_win_count = 0;
+    g_latest_p2p = 0.0f;
+    g_latest_pct = 0.0f;
+    g_latest_cry = 0;
+}
+
+void node_crying_sample(void)
+{
+    cry_sampler_update();
+}
+
+// what the node answers to 'C'
+int node_crying_level(void)
+{
+    return g_latest_cry;
+}
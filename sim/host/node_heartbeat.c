@@ -0,0 +1,21 @@
+// node_heartbeat.c — heartbeat/main.c's beat detector, callable from a PC harness
+// The node's source is compiled as is (its main() renamed out of the way), so a harness exercises the exact
+// heartbeat_update() the board runs. Build against the host libpynq (-I sim/host).
+
+#define main heartbeat_node_main
+#include "../../heartbeat/main.c"
+#undef main
+
+#include "nodes.h"
+
+void node_heartbeat_sample(double t_ms)
+{
+    heartbeat_update(t_ms);
+}
+
+// what the node answers to 'H': the sensor BPM if it is plausible, else the (never pressed) button BPM of 0
+int node_heartbeat_bpm(void)
+{
+    int bpm = (g_bpm_est >= 40 && g_bpm_est <= 240) ? g_bpm_est : 0;
+    return clampi(bpm, 0, 255);
+}
@@ -0,0 +1,16 @@
+// nodes.h — the sensor nodes' signal processing, run on a PC (node_heartbeat.c, node_crying.c)
+// Both drive their node's real code; time is the host libpynq's clock, samples come from its ADC source.
+
+#ifndef NODES_H
+#define NODES_H
+
+// heartbeat/main.c: one pass of heartbeat_update() (the node's loop calls it every ~20 ms)
+void node_heartbeat_sample(double t_ms);
+int node_heartbeat_bpm(void);
+
+// crying/main.c: boot calibration, one cry_sampler_update() (takes a sample every 5 ms of clock), the level
+void node_crying_calibrate(void (*quiet)(void *ctx), void (*loud)(void *ctx), void *ctx);
+void node_crying_sample(void);
+int node_crying_level(void);
+
+#endif
@@ -0,0 +1,510 @@
+// lockstep.c — many worlds advanced together, struct-of-arrays
+// sim_batch() runs one SimWorld after the other. Here a block of LS_LANES sessions lives in flat per-lane
+// arrays and every controller step is three passes over the block:
+//   sense    delayed stress lookup, heartbeat and crying for every lane (branch free, vectorises)
+//   step     decision/controller.c per lane; its motor hook is the only scalar plant code (moves are rare)
+//   advance  the step period for every lane: convergence landing and the stress integral (vectorises)
+// Lanes that are done (calm, controller panic) are masked out rather than compacted, so a block costs as
+// many passes as its longest session, which is at most SIM_MAX_STEPS.
+//
+// The plant is the same as sim.c down to the last bit: same draws (scenario_sample/scenario_build on a
+// scratch world), same move outcome (sim_move_kind), same float operations in the same order. History is
+// always change-point (a dense sample every 50 ms is the opposite of what this is for), so results equal
+// sim_batch() with HIST_CHANGEPOINT. The ring per lane is LS_HIST changes; if a lane ever needs a change that
+// fell out of it, that session is rerun through sim_run_session() so the result stays exact. No trace output,
+// and only the ideal sensor read at the step (any other SimSensor or a poll period runs through sim_batch()).
+//
+// The sense and advance loops are written so the compiler can vectorise them (gcc -O3). Keep FMA contraction
+// off (no -march=native without -ffp-contract=off) or the last bits stop matching the scalar build.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#define LS_LANES 512
+#define LS_HIST 32 // power of two
+
+typedef struct LsBlock LsBlock;
+
+typedef struct
+{
+    LsBlock *b;
+    int i;
+} LsLane;
+
+struct LsBlock
+{
+    const SimParams *p;
+    int n; // lanes in use
+
+    // plant state, one entry per lane
+    double S[LS_LANES];
+    double t[LS_LANES];
+    double conv_at[LS_LANES]; // pending convergence, < 0 if none (instant model)
+    double goal[LS_LANES];    // exponential model: where S is heading
+    double area[LS_LANES];
+    double dt[LS_LANES];     // next advance, 0 = lane is done
+    double land_t[LS_LANES]; // advance: when a convergence landed, < 0 if none
+    double calm_t[LS_LANES];
+    int bpm[LS_LANES], cry[LS_LANES];
+    int moves[LS_LANES], panics[LS_LANES];
+    uint32_t visited[LS_LANES];
+    uint8_t curA[LS_LANES], curF[LS_LANES], curK[LS_LANES];
+    uint8_t relaxing[LS_LANES];
+    uint8_t live[LS_LANES];
+
+    // per-lane plant tables, k major so a pass over the lanes for one k is contiguous
+    double Sopt[10][LS_LANES];
+    double lo[10][LS_LANES];
+    double hi[10][LS_LANES];
+    uint8_t K[25][LS_LANES];
+
+    // change-point history ring, lane major (a lane's ring is one cache line run). timestamps strictly increase
+    // in logical order
+    double ht[LS_LANES][LS_HIST];
+    double hs[LS_LANES][LS_HIST];
+    double hg[LS_LANES][LS_HIST];
+    uint8_t hn[LS_LANES], hhead[LS_LANES];
+    uint8_t evicted[LS_LANES]; // the ring wrapped at least once
+    uint8_t lost[LS_LANES];    // needed a change that was evicted: rerun this session the slow way
+
+    controller_t ctrl[LS_LANES];
+    LsLane ref[LS_LANES];
+};
+
+// record_stress_sample(), change-point branch
+static void ls_record(LsBlock *b, int i, double t, double S)
+{
+    double g = b->relaxing[i] ? b->goal[i] : S;
+    int n = b->hn[i];
+    if (n > 0)
+    {
+        int last = (b->hhead[i] + n - 1) & (LS_HIST - 1);
+        if (b->hs[i][last] == S && b->hg[i][last] == g)
+            return;
+        if (b->ht[i][last] >= t)
+        {
+            b->hs[i][last] = S;
+            b->hg[i][last] = g;
+            return;
+        }
+    }
+    int slot;
+    if (n < LS_HIST)
+    {
+        slot = (b->hhead[i] + n) & (LS_HIST - 1);
+        b->hn[i]++;
+    }
+    else
+    {
+        slot = b->hhead[i];
+        b->hhead[i] = (uint8_t)((slot + 1) & (LS_HIST - 1));
+        b->evicted[i] = 1;
+    }
+    b->ht[i][slot] = t;
+    b->hs[i][slot] = S;
+    b->hg[i][slot] = g;
+}
+
+// tick(): the clock and the stress integral of one lane
+static void ls_tick(LsBlock *b, int i, double dt)
+{
+    b->t[i] += dt;
+    if (!b->relaxing[i])
+    {
+        b->area[i] += b->S[i] * dt;
+        return;
+    }
+    double tau = b->p->stress_tau;
+    double e = exp(-dt / tau);
+    double gap = b->S[i] - b->goal[i];
+    b->area[i] += b->goal[i] * dt + gap * tau * (1.0 - e);
+    b->S[i] = b->goal[i] + gap * e;
+}
+
+static void ls_converge(LsBlock *b, int i)
+{
+    if (b->p->stress_model == STRESS_EXP)
+    {
+        b->relaxing[i] = 1;
+        b->goal[i] = b->Sopt[b->curK[i]][i];
+        ls_record(b, i, b->t[i], b->S[i]);
+        return;
+    }
+    b->conv_at[i] = b->t[i] + b->p->convergence_time;
+}
+
+static void ls_panic(LsBlock *b, int i)
+{
+    b->panics[i]++;
+    b->conv_at[i] = -1.0;
+    b->relaxing[i] = 0;
+    b->S[i] = b->Sopt[9][i];
+    ls_record(b, i, b->t[i], b->S[i]);
+}
+
+// move_to_cell() for one lane
+static void ls_move(LsBlock *b, int i, int newA, int newF)
+{
+    if (newA < 0 || newA > 4 || newF < 0 || newF > 4)
+        return;
+    int oldA = b->curA[i], oldF = b->curF[i], oldK = b->curK[i];
+    int k = b->K[newA * 5 + newF][i];
+    b->moves[i]++;
+    b->visited[i] |= 1u << (newA * 5 + newF);
+
+    int kind = sim_move_kind(oldA, oldF, newA, newF, b->S[i], b->lo[oldK][i], b->hi[oldK][i], b->lo[k][i], b->hi[k][i]);
+    b->curA[i] = (uint8_t)newA;
+    b->curF[i] = (uint8_t)newF;
+    b->curK[i] = (uint8_t)k;
+
+    if (kind == MOVE_INSIDE)
+    {
+        ls_converge(b, i);
+        return;
+    }
+    if (kind == MOVE_PANIC_JUMP || kind == MOVE_PANIC_BLOCK)
+    {
+        ls_panic(b, i);
+        return;
+    }
+    if (b->S[i] < b->lo[k][i])
+        b->S[i] = b->lo[k][i];
+    if (b->S[i] > b->hi[k][i])
+        b->S[i] = b->hi[k][i];
+    ls_record(b, i, b->t[i], b->S[i]);
+    ls_converge(b, i);
+}
+
+// controller hooks, one lane each
+static void ls_command_cell(void *ctx, int aIndex, int fIndex)
+{
+    LsLane *l = ctx;
+    LsBlock *b = l->b;
+    int i = l->i, panics = b->panics[i];
+    ls_move(b, i, aIndex, fIndex);
+    if (b->panics[i] != panics)
+    {
+        ls_tick(b, i, 0.01); // advance_epsilon(), see sim_ctrl_command_cell()
+        ls_record(b, i, b->t[i], b->S[i]);
+    }
+}
+
+static double ls_now_ms(void *ctx)
+{
+    LsLane *l = ctx;
+    return l->b->t[l->i] * 1000.0;
+}
+
+// sessions seed0 .. seed0+n-1 into the block, at A5 F5 / K9 with a started controller
+static void ls_setup(LsBlock *b, SimWorld *scratch, uint64_t seed0, int n)
+{
+    const SimParams *p = b->p;
+    b->n = n;
+    for (int i = 0; i < n; i++)
+    {
+        // same draws as sim_run_session(): the world's PRNG and nothing else
+        sim_seed(scratch, seed0 + (uint64_t)i);
+        generate_matrix(scratch);
+        for (int k = 0; k < 10; k++)
+        {
+            b->Sopt[k][i] = scratch->Sopt[k];
+            b->lo[k][i] = scratch->BandLow[k];
+            b->hi[k][i] = scratch->BandHigh[k];
+        }
+        for (int c = 0; c < 25; c++)
+            b->K[c][i] = (uint8_t)scratch->K[c / 5][c % 5];
+
+        b->t[i] = 0.0;
+        b->area[i] = 0.0;
+        b->conv_at[i] = -1.0;
+        b->relaxing[i] = 0;
+        b->goal[i] = 0.0;
+        b->calm_t[i] = -1.0;
+        b->moves[i] = b->panics[i] = 0;
+        b->hn[i] = b->hhead[i] = b->evicted[i] = b->lost[i] = 0;
+        b->live[i] = 1;
+
+        // set_initial_state(4, 4, 9, Sopt[9])
+        b->curA[i] = 4;
+        b->curF[i] = 4;
+        b->curK[i] = 9;
+        b->S[i] = b->Sopt[9][i];
+        b->visited[i] = 1u << 24;
+        ls_record(b, i, 0.0, b->S[i]);
+
+        b->ref[i] = (LsLane){b, i};
+        controller_hooks_t hooks = {ls_command_cell, NULL, ls_now_ms, &b->ref[i]};
+        controller_init(&b->ctrl[i], &hooks);
+        b->ctrl[i].thresholdBPM = p->thresholdBPM;
+        b->ctrl[i].thresholdCRY = p->thresholdCRY;
+        b->ctrl[i].consts = p->consts;
+        b->ctrl[i].policy = p->policy;
+        controller_start(&b->ctrl[i]);
+    }
+}
+
+// stress_delayed() and the two sensors for every lane: the newest change at or before now - TAU. instead of a
+// binary search per lane, all lanes walk back from their newest change together, one masked pass per change,
+// until every lane has found its one (a TAU back is only a handful of changes)
+static void ls_sense(LsBlock *b)
+{
+    const int n = b->n;
+    const int exp_model = b->p->stress_model == STRESS_EXP;
+    const double TAU = b->p->TAU;
+    double bt[LS_LANES], bs[LS_LANES], bg[LS_LANES];
+    uint8_t found[LS_LANES];
+
+    for (int i = 0; i < n; i++)
+    {
+        int first = b->hhead[i]; // until something newer qualifies, S before the first change is the oldest one
+        bt[i] = -INFINITY;
+        bs[i] = b->hs[i][first];
+        bg[i] = b->hg[i][first];
+        found[i] = !b->live[i];
+    }
+    for (int k = 0; k < LS_HIST; k++)
+    {
+        int left = 0;
+        for (int i = 0; i < n; i++)
+        {
+            int idx = b->hn[i] - 1 - k;
+            int valid = !found[i] & (idx >= 0);
+            int slot = (b->hhead[i] + (valid ? idx : 0)) & (LS_HIST - 1);
+            double ht = b->ht[i][slot];
+            int take = valid & (ht <= b->t[i] - TAU);
+            bt[i] = take ? ht : bt[i];
+            bs[i] = take ? b->hs[i][slot] : bs[i];
+            bg[i] = take ? b->hg[i][slot] : bg[i];
+            found[i] |= (uint8_t)(take | !valid);
+            left += valid & !take;
+        }
+        if (!left)
+            break;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int none = bt[i] == -INFINITY;
+        b->lost[i] |= (uint8_t)(none & b->evicted[i] & b->live[i]);
+        double s = bs[i];
+        double S = b->S[i];
+        double cry = (S <= 100 && S >= 50) ? 100.0 : (S <= 50 && S >= 10) ? 2.5 * S - 25 : 0;
+        b->bpm[i] = (int)round(60.0 + 1.8 * s);
+        b->cry[i] = (int)round(cry);
+    }
+
+    if (exp_model)
+        for (int i = 0; i < n; i++)
+        {
+            if (bt[i] == -INFINITY || bg[i] == bs[i])
+                continue;
+            double s = bg[i] + (bs[i] - bg[i]) * exp(-((b->t[i] - TAU) - bt[i]) / b->p->stress_tau);
+            b->bpm[i] = (int)round(60.0 + 1.8 * s);
+        }
+}
+
+// one controller step for every live lane, then what run_controller() does with the outcome
+static void ls_step(LsBlock *b)
+{
+    for (int i = 0; i < b->n; i++)
+    {
+        b->dt[i] = 0.0;
+        if (!b->live[i])
+            continue;
+        controller_t *c = &b->ctrl[i];
+        controller_step(c, b->bpm[i], b->cry[i]);
+        if (c->calm_reached)
+        {
+            if (b->S[i] >= b->lo[1][i] && b->S[i] <= b->hi[1][i])
+                b->calm_t[i] = c->calm_elapsed_ms / 1000.0;
+            b->live[i] = 0;
+        }
+        else if (c->panic_mode)
+            b->live[i] = 0;
+        else
+            b->dt[i] = controller_step_period_ms(c) / 1000.0;
+    }
+}
+
+// advance_time() for every lane by its dt. in the instant model S is constant except for the landing, so
+// the whole pass is selects and multiply-adds; the landings are recorded afterwards
+static void ls_advance(LsBlock *b)
+{
+    const int n = b->n;
+    if (b->p->stress_model == STRESS_EXP)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (!(b->dt[i] > 0))
+                continue;
+            double end = b->t[i] + b->dt[i]; // advance_time() steps by end - t, not by dt
+            if (end - b->t[i] > 0)
+                ls_tick(b, i, end - b->t[i]);
+        }
+        return;
+    }
+
+    double *restrict S = b->S, *restrict t = b->t, *restrict ca = b->conv_at, *restrict area = b->area;
+    double *restrict land_t = b->land_t;
+    const double *restrict dt = b->dt;
+    for (int i = 0; i < n; i++)
+    {
+        double d = dt[i];
+        double end = t[i] + d;
+        int land = (d > 0) & (ca[i] >= 0.0) & (ca[i] <= end + 1e-9);
+        double d1 = ca[i] - t[i];
+        int t1 = land & (d1 > 0);
+        double tt = t1 ? t[i] + d1 : t[i];
+        double aa = t1 ? area[i] + S[i] * d1 : area[i];
+        double ss = land ? b->Sopt[b->curK[i]][i] : S[i];
+        land_t[i] = land ? tt : -1.0;
+        ca[i] = land ? -1.0 : ca[i];
+        double d2 = end - tt;
+        int t2 = (d > 0) & (d2 > 0);
+        t[i] = t2 ? tt + d2 : tt;
+        area[i] = t2 ? aa + ss * d2 : aa;
+        S[i] = ss;
+    }
+    for (int i = 0; i < n; i++)
+        if (land_t[i] >= 0.0)
+            ls_record(b, i, land_t[i], S[i]);
+}
+
+static void ls_run(LsBlock *b, SimWorld *scratch, uint64_t seed0, int n, SimResult *out)
+{
+    ls_setup(b, scratch, seed0, n);
+
+    for (int step = 0; step < SIM_MAX_STEPS; step++)
+    {
+        int any = 0;
+        for (int i = 0; i < n; i++)
+            any |= b->live[i];
+        if (!any)
+            break;
+        ls_sense(b);
+        ls_step(b);
+        ls_advance(b);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (b->lost[i])
+        {
+            SimParams q = *b->p;
+            q.hist_mode = HIST_CHANGEPOINT;
+            q.trace = NULL;
+            if (sim_run_session(&q, seed0 + (uint64_t)i, 0, &out[i]) != 0)
+                out[i].end_t = -1.0;
+            continue;
+        }
+        SimResult *r = &out[i];
+        r->calm = b->calm_t[i] >= 0.0;
+        r->calm_t = b->calm_t[i];
+        r->moves = b->moves[i];
+        r->panics = b->panics[i];
+        r->finalK = b->curK[i];
+        r->end_t = b->t[i];
+        r->visited = b->visited[i];
+        r->stress_area = b->area[i];
+        r->ctrl_panic = b->ctrl[i].panic_mode;
+        r->thr_lo = b->ctrl[i].thr_lo;
+        r->thr_hi = b->ctrl[i].thr_hi;
+    }
+}
+
+typedef struct
+{
+    const SimParams *p;
+    uint64_t seed;
+    int n;
+    SimResult *out;
+    pthread_mutex_t lock;
+    int next_block;
+    int failed;
+} LsShared;
+
+static void *ls_worker(void *arg)
+{
+    LsShared *sh = arg;
+    LsBlock *b = malloc(sizeof *b);
+    SimWorld *scratch = malloc(sizeof *scratch);
+    if (!b || !scratch)
+    {
+        pthread_mutex_lock(&sh->lock);
+        sh->failed = 1;
+        pthread_mutex_unlock(&sh->lock);
+        free(b);
+        free(scratch);
+        return NULL;
+    }
+    memset(scratch, 0, sizeof *scratch); // only its PRNG and plant tables are used, no history
+    b->p = sh->p;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&sh->lock);
+        int first = sh->next_block * LS_LANES;
+        if (first < sh->n)
+            sh->next_block++;
+        pthread_mutex_unlock(&sh->lock);
+        if (first >= sh->n)
+            break;
+        int count = sh->n - first < LS_LANES ? sh->n - first : LS_LANES;
+        ls_run(b, scratch, sh->seed + (uint64_t)first, count, sh->out + first);
+    }
+    free(b);
+    free(scratch);
+    return NULL;
+}
+
+// same contract as sim_batch(): out[i] belongs to seed+i. blocks are handed out in order from one counter,
+// they all take about as long (a block runs until its slowest lane is done)
+int sim_lockstep_batch(const SimParams *p, int n, int threads, uint64_t seed, SimResult *out)
+{
+    if (n <= 0)
+        return 0;
+    if (p->stress_model == STRESS_EXP && !(p->stress_tau > 0.0))
+        return -1;
+    // the lanes only know the ideal sensor, read at the step, and hold no MPC belief
+    if (!sim_sensor_ideal(&p->sensor) || p->poll_ms > 0 || p->mpc)
+        return sim_batch(p, n, threads, seed, out);
+    int blocks = (n + LS_LANES - 1) / LS_LANES;
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cores > 0) ? (int)cores : 1;
+    }
+    if (threads > blocks)
+        threads = blocks;
+
+    LsShared sh = {p, seed, n, out, PTHREAD_MUTEX_INITIALIZER, 0, 0};
+    pthread_t *tids = calloc((size_t)threads, sizeof *tids);
+    if (!tids)
+        return -1;
+    int started = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        if (pthread_create(&tids[t], NULL, ls_worker, &sh) != 0)
+            break;
+        started++;
+    }
+    if (started == 0)
+        ls_worker(&sh);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+    free(tids);
+    pthread_mutex_destroy(&sh.lock);
+
+    if (sh.failed)
+        return -1;
+    for (int i = 0; i < n; i++)
+        if (out[i].end_t < 0)
+            return -1;
+    return 0;
+}
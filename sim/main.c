@@ -0,0 +1,201 @@
+// main.c — simulator entry point
+// usage: sim [--seed N] [--changepoint] [--policy] [--mpc] [--threshold-bpm N] [--tau S] [--convergence S]
+//            [--continuous] [--stress-tau S] [--sensor ideal|real] [sensor options]
+//        sim --batch N [--threads T] [--lockstep] [same options]
+//                                                     (N sessions, seeds N..N+count-1, distributions only)
+//        sim --corpus FILE [same options]             (every path shape x band grid, results cached in FILE)
+//        sim --ring PATH [--speed X] [--ring-time S] [same options]
+//                                                     (nodes 1-3 of the UART ring on a pty, for decision/main.c)
+// --policy runs the solver's table (decision/policy_table.h) instead of the hand-written controller rules
+// --mpc runs the model-predictive planner (MPC mode in decision/controller.h) instead of either
+// --continuous lets S relax exponentially towards Sopt (time constant --stress-tau) instead of jumping there
+// --lockstep runs the batch on the struct-of-arrays engine (lockstep.c): same results as --changepoint, faster
+// --scenario "s1=.. step=.. half=.. path=.." runs that exact scenario (as printed by adversary) instead of a drawn one
+// --sensor real (or --bpm-beats, --cry-noise, --dropout, ... see sim.h) puts the nodes' averaging, noise,
+//   calibration error, lag and lost replies between the plant and the controller; the default is ideal
+// --ring PATH plays the heartbeat, crying and motor nodes on a pseudo-terminal linked at PATH; the decision
+//   program built against sim/host/libpynq talks to it (see ring.c). --speed runs the clock X times faster
+// --trace FILE appends every session's events to a binary trace (read it with trace_tool)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+
+static double wall_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    SimParams p;
+    sim_params_default(&p);
+    uint64_t seed = (uint64_t)time(0); // same as the old srand(time(0)) unless you ask for a seed
+    int batch = 0;
+    int threads = 0;
+    int lockstep = 0;
+    const char *corpus = NULL;
+    const char *trace = NULL;
+    const char *scenario = NULL;
+    const char *ring = NULL;
+    double speed = 1.0, ring_time = 600.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (sim_sensor_option(&p.sensor, argc, argv, &i))
+            continue;
+        if (strcmp(a, "--changepoint") == 0)
+            p.hist_mode = HIST_CHANGEPOINT;
+        else if (strcmp(a, "--policy") == 0)
+            p.policy = &policy_table;
+        else if (strcmp(a, "--mpc") == 0)
+            p.mpc = 1;
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--batch") == 0 && v)
+            batch = atoi(argv[++i]);
+        else if (strcmp(a, "--corpus") == 0 && v)
+            corpus = argv[++i];
+        else if (strcmp(a, "--threads") == 0 && v)
+            threads = atoi(argv[++i]);
+        else if (strcmp(a, "--scenario") == 0 && v)
+            scenario = argv[++i];
+        else if (strcmp(a, "--lockstep") == 0)
+            lockstep = 1;
+        else if (strcmp(a, "--ring") == 0 && v)
+            ring = argv[++i];
+        else if (strcmp(a, "--speed") == 0 && v)
+            speed = atof(argv[++i]);
+        else if (strcmp(a, "--ring-time") == 0 && v)
+            ring_time = atof(argv[++i]);
+        else if (strcmp(a, "--trace") == 0 && v)
+            trace = argv[++i];
+        else if (strcmp(a, "--threshold-bpm") == 0 && v)
+            p.thresholdBPM = atoi(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            p.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            p.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+
+    if (p.stress_model == STRESS_EXP && !(p.stress_tau > 0.0))
+    {
+        printf("--stress-tau must be > 0\n");
+        return 1;
+    }
+    const char *bad = sim_sensor_check(&p.sensor);
+    if (bad)
+    {
+        printf("%s\n", bad);
+        return 1;
+    }
+
+    if (ring && (trace || batch > 0 || corpus))
+    {
+        printf("--ring runs one live session, without --trace, --batch or --corpus\n");
+        return 1;
+    }
+
+    if (lockstep)
+    {
+        if (trace)
+        {
+            printf("--lockstep does not write traces\n");
+            return 1;
+        }
+        p.hist_mode = HIST_CHANGEPOINT;
+    }
+
+    if (trace)
+    {
+        p.trace = trace_open(trace);
+        if (!p.trace)
+        {
+            printf("[SYSTEM][ERROR] could not open trace %s\n", trace);
+            return 1;
+        }
+    }
+
+    if (corpus)
+    {
+        double t0 = wall_sec();
+        int rc = sim_corpus(&p, corpus);
+        printf("wall time %.3f s\n", wall_sec() - t0);
+        trace_close(p.trace);
+        return rc ? 1 : 0;
+    }
+
+    if (batch > 0)
+    {
+        SimResult *res = calloc((size_t)batch, sizeof *res);
+        if (!res)
+            return 1;
+        printf("batch: %d sessions, seeds %llu.., thresholdBPM=%d TAU=%.2f CONVERGENCE_TIME=%.2f",
+               batch, (unsigned long long)seed, p.thresholdBPM, p.TAU, p.convergence_time);
+        if (p.stress_model == STRESS_EXP)
+            printf(" continuous stress tau=%.2f", p.stress_tau);
+        if (!sim_sensor_ideal(&p.sensor))
+        {
+            char sens[160];
+            sim_sensor_describe(&p.sensor, sens, sizeof sens);
+            printf(" sensor %s", sens);
+        }
+        printf("\n");
+        double t0 = wall_sec();
+        int rc = lockstep ? sim_lockstep_batch(&p, batch, threads, seed, res)
+                          : sim_batch(&p, batch, threads, seed, res);
+        double t1 = wall_sec();
+        if (rc != 0)
+            printf("[SYSTEM][ERROR] some sessions failed to run\n");
+        sim_batch_report(res, batch);
+        printf("wall time %.3f s (%.0f sessions/s)\n", t1 - t0, (t1 > t0) ? batch / (t1 - t0) : 0.0);
+        free(res);
+        trace_close(p.trace);
+        return rc ? 1 : 0;
+    }
+
+    SimScenario sc;
+    if (scenario && sim_scenario_parse(scenario, &sc) != 0)
+    {
+        printf("[SYSTEM][ERROR] bad scenario \"%s\"\n", scenario);
+        trace_close(p.trace);
+        return 1;
+    }
+    printf("seed=%llu\n", (unsigned long long)seed);
+    if (ring)
+    {
+        if (sim_ring_serve(&p, scenario ? &sc : NULL, seed, ring, speed, ring_time) != 0)
+        {
+            printf("[SYSTEM][ERROR] ring session failed\n");
+            return 1;
+        }
+        return 0;
+    }
+    SimResult r;
+    int rc = sim_run_scenario(&p, scenario ? &sc : NULL, seed, 1, &r);
+    trace_close(p.trace);
+    if (rc != 0)
+    {
+        printf("[SYSTEM][ERROR] could not allocate stress history\n");
+        return 1;
+    }
+    printf("\nfinished at t = %.3f s.\n", r.end_t);
+    return 0;
+}
@@ -0,0 +1,248 @@
+// policy_solver.c — offline search for the controller policy table (POLICY MODE in decision/controller.h)
+// The plant hides the K path and draws continuous bands per session, so an exact POMDP solution is out of
+// reach. Instead we search the finite family the controller can run: per anchor cell which neighbour to probe
+// first and what to do when that probe fails, plus one settle time per vitals regime. The objective is the
+// expected time-to-calm over a fixed training set of sessions (the same seeds for every candidate, so two
+// candidates are compared on identical babies); a session that never calms costs FAIL_COST.
+// Coordinate descent: change one entry, keep it if the objective drops, sweep until nothing moves.
+// The winner is checked on a separate test set against the hand-written rules and written out as a header.
+//
+// usage: policy_solver [--train N] [--test N] [--seed N] [--threads T] [--lockstep] [--out FILE]
+//                      [--changepoint] [--threshold-bpm N] [--tau S] [--convergence S] [--continuous]
+//                      [--stress-tau S] [--sensor ideal|real] [sensor options, see sim.h]
+// build: gcc -O2 -pthread -o policy_solver policy_solver.c sim.c batch.c corpus.c trace.c lockstep.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+#define FAIL_COST 1200.0 // seconds charged for a session that never calms (twice the longest session)
+#define TEST_SEED_OFFSET 1000000
+
+typedef struct
+{
+    double cost; // mean cost, lower is better
+    double calm; // fraction of sessions that calmed
+    double ttc;  // mean time-to-calm of the calm ones
+} Score;
+
+static SimResult *g_res;
+static int g_lockstep; // evaluate on the lockstep engine (change-point history)
+
+static int evaluate(SimParams *p, const controller_policy_t *pol, int n, int threads, uint64_t seed, Score *out)
+{
+    p->policy = pol;
+    int rc = g_lockstep ? sim_lockstep_batch(p, n, threads, seed, g_res) : sim_batch(p, n, threads, seed, g_res);
+    if (rc != 0)
+        return -1;
+
+    double cost = 0.0, ttc = 0.0;
+    int calm = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (g_res[i].calm)
+        {
+            cost += g_res[i].calm_t;
+            ttc += g_res[i].calm_t;
+            calm++;
+        }
+        else
+            cost += FAIL_COST;
+    }
+    out->cost = cost / n;
+    out->calm = (double)calm / n;
+    out->ttc = calm ? ttc / calm : 0.0;
+    return 0;
+}
+
+static void write_header(FILE *f, const controller_policy_t *pol, const SimParams *p, int train, int test,
+                         uint64_t seed, const Score *sp, const Score *sr)
+{
+    fprintf(f, "// policy_table.h — generated by sim/policy_solver.c, do not edit by hand\n");
+    fprintf(f, "// plant: TAU=%.2f s, convergence %.2f s, thresholdBPM=%d", p->TAU, p->convergence_time, p->thresholdBPM);
+    if (p->stress_model == STRESS_EXP)
+        fprintf(f, ", continuous stress (time constant %.2f s)", p->stress_tau);
+    if (!sim_sensor_ideal(&p->sensor))
+    {
+        char sens[160];
+        sim_sensor_describe(&p->sensor, sens, sizeof sens);
+        fprintf(f, ", sensor %s", sens);
+    }
+    fprintf(f, "\n");
+    fprintf(f, "// train: %d sessions from seed %llu, test: %d sessions from seed %llu\n", train,
+            (unsigned long long)seed, test, (unsigned long long)(seed + TEST_SEED_OFFSET));
+    fprintf(f, "// test: policy calm %.1f%% mean time-to-calm %.1f s, hand-written rules calm %.1f%% mean %.1f s\n",
+            100.0 * sp->calm, sp->ttc, 100.0 * sr->calm, sr->ttc);
+    fprintf(f, "\n#ifndef POLICY_TABLE_H\n#define POLICY_TABLE_H\n\n#include \"controller.h\"\n\n");
+    fprintf(f, "// first_dir: 1 = LEFT, 2 = UP. on_fail: 0 = back to anchor, 1 = diagonal to the other neighbour\n");
+    fprintf(f, "static const controller_policy_t policy_table = {\n");
+
+    fprintf(f, "    .first_dir = {\n");
+    for (int a = 0; a < 5; a++)
+        fprintf(f, "        {%d, %d, %d, %d, %d}, // A%d\n", pol->first_dir[a][0], pol->first_dir[a][1],
+                pol->first_dir[a][2], pol->first_dir[a][3], pol->first_dir[a][4], a + 1);
+    fprintf(f, "    },\n    .on_fail = {\n");
+    for (int a = 0; a < 5; a++)
+        fprintf(f, "        {%d, %d, %d, %d, %d}, // A%d\n", pol->on_fail[a][0], pol->on_fail[a][1],
+                pol->on_fail[a][2], pol->on_fail[a][3], pol->on_fail[a][4], a + 1);
+    fprintf(f, "    },\n    .wait_ms = {%u, %u},\n};\n\n#endif\n", pol->wait_ms[0], pol->wait_ms[1]);
+}
+
+int main(int argc, char **argv)
+{
+    SimParams p;
+    sim_params_default(&p);
+    int train = 4000, test = 20000, threads = 0;
+    uint64_t seed = 1;
+    const char *out_path = "../decision/policy_table.h";
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (sim_sensor_option(&p.sensor, argc, argv, &i))
+            continue;
+        if (strcmp(a, "--changepoint") == 0)
+            p.hist_mode = HIST_CHANGEPOINT;
+        else if (strcmp(a, "--lockstep") == 0)
+        {
+            g_lockstep = 1;
+            p.hist_mode = HIST_CHANGEPOINT;
+        }
+        else if (strcmp(a, "--train") == 0 && v)
+            train = atoi(argv[++i]);
+        else if (strcmp(a, "--test") == 0 && v)
+            test = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--threads") == 0 && v)
+            threads = atoi(argv[++i]);
+        else if (strcmp(a, "--out") == 0 && v)
+            out_path = argv[++i];
+        else if (strcmp(a, "--threshold-bpm") == 0 && v)
+            p.thresholdBPM = atoi(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            p.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            p.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    if (train <= 0 || test <= 0)
+        return 1;
+    const char *bad = sim_sensor_check(&p.sensor);
+    if (bad)
+    {
+        printf("%s\n", bad);
+        return 1;
+    }
+
+    g_res = calloc((size_t)(train > test ? train : test), sizeof *g_res);
+    if (!g_res)
+        return 1;
+
+    // start: LEFT first, back to the anchor on failure, wait long enough for the delayed heartbeat to show
+    // the settled probe
+    controller_policy_t pol;
+    memset(&pol, 0, sizeof pol);
+    for (int a = 0; a < 5; a++)
+        for (int f = 0; f < 5; f++)
+        {
+            pol.first_dir[a][f] = POLICY_LEFT;
+            pol.on_fail[a][f] = POLICY_BACK;
+        }
+    pol.wait_ms[0] = HEARTBEAT_DELAY + CONVERGENCE_DELAY;
+    pol.wait_ms[1] = CONVERGENCE_DELAY;
+
+    Score best;
+    if (evaluate(&p, &pol, train, threads, seed, &best) != 0)
+        return 1;
+    printf("start: cost %.2f s (calm %.1f%%, ttc %.1f s)\n", best.cost, 100.0 * best.calm, best.ttc);
+
+    for (int sweep = 1;; sweep++)
+    {
+        int changed = 0;
+
+        // settle times, in whole seconds
+        for (int r = 0; r < 2; r++)
+        {
+            for (int ms = 1000; ms <= 30000; ms += 1000)
+            {
+                if (ms == pol.wait_ms[r])
+                    continue;
+                controller_policy_t cand = pol;
+                cand.wait_ms[r] = (uint16_t)ms;
+                Score s;
+                if (evaluate(&p, &cand, train, threads, seed, &s) != 0)
+                    return 1;
+                if (s.cost < best.cost)
+                {
+                    pol = cand;
+                    best = s;
+                    changed++;
+                    printf("  wait_ms[%s] = %d -> cost %.2f s\n", r ? "CRY" : "HB", ms, best.cost);
+                }
+            }
+        }
+
+        // per anchor entries. on a wall the controller has no choice, so only the inner cells matter
+        for (int a = 4; a >= 1; a--)
+            for (int f = 4; f >= 1; f--)
+                for (int which = 0; which < 2; which++)
+                {
+                    controller_policy_t cand = pol;
+                    if (which == 0)
+                        cand.first_dir[a][f] = (pol.first_dir[a][f] == POLICY_LEFT) ? POLICY_UP : POLICY_LEFT;
+                    else
+                        cand.on_fail[a][f] = (pol.on_fail[a][f] == POLICY_BACK) ? POLICY_DIAG : POLICY_BACK;
+                    Score s;
+                    if (evaluate(&p, &cand, train, threads, seed, &s) != 0)
+                        return 1;
+                    if (s.cost < best.cost)
+                    {
+                        pol = cand;
+                        best = s;
+                        changed++;
+                        printf("  A%d F%d %s -> cost %.2f s\n", a + 1, f + 1,
+                               which ? (pol.on_fail[a][f] ? "on_fail DIAG" : "on_fail BACK")
+                                     : (pol.first_dir[a][f] == POLICY_LEFT ? "first LEFT" : "first UP"),
+                               best.cost);
+                    }
+                }
+
+        printf("sweep %d: cost %.2f s (calm %.1f%%, ttc %.1f s), %d changes\n", sweep, best.cost,
+               100.0 * best.calm, best.ttc, changed);
+        if (!changed)
+            break;
+    }
+
+    // held-out check against the hand-written rules
+    Score sp, sr;
+    if (evaluate(&p, &pol, test, threads, seed + TEST_SEED_OFFSET, &sp) != 0 ||
+        evaluate(&p, NULL, test, threads, seed + TEST_SEED_OFFSET, &sr) != 0)
+        return 1;
+    printf("test:  policy calm %.1f%% ttc %.1f s cost %.2f s | hand-written calm %.1f%% ttc %.1f s cost %.2f s\n",
+           100.0 * sp.calm, sp.ttc, sp.cost, 100.0 * sr.calm, sr.ttc, sr.cost);
+
+    FILE *f = fopen(out_path, "w");
+    if (!f)
+    {
+        printf("[SYSTEM][ERROR] could not write %s\n", out_path);
+        return 1;
+    }
+    write_header(f, &pol, &p, train, test, seed, &sp, &sr);
+    fclose(f);
+    printf("wrote %s\n", out_path);
+
+    free(g_res);
+    return 0;
+}
@@ -0,0 +1,370 @@
+// rare.c — panic probability by importance sampling
+// A plant panic (PANIC JUMP/BLOCK in move_to_cell(): a move across bands that do not overlap) needs narrow
+// bands and steep Sopt steps in the right place, so under generate_matrix()'s distribution p it is rare and
+// plain Monte Carlo needs a huge run before the rate has a usable error bar.
+// Here scenarios are drawn from a proposal q that favours such draws and every outcome is weighted by
+// p(x) / q(x), which keeps the estimate unbiased:
+//   P(panic) = E_q[ 1{panic} p(x)/q(x) ]
+// q has the same shape as p: an independent categorical per Sopt[1], per step, per half-width and one over the
+// 70 paths. It is fitted with the cross-entropy method: draw from q, keep the sessions that hit the event,
+// refit every categorical to their weighted value counts, repeat. Where a panic can happen at all is mostly a
+// matter of the path (and then of the steps and bands around that spot), so the path carries most of the gain.
+// Each refit is shrunk towards p by CE_PRIOR pseudo-hits, so a field the event does not care about stays close
+// to uniform instead of chasing noise (every drifting field makes the weights heavier). The final q is mixed
+// with p (defensive mixture, MIX_P) so no weight can exceed 1 / MIX_P.
+//
+// usage: rare [--sessions N] [--rounds R] [--pilot N] [--seed N] [--event plant|frozen] [--check N] [--rules]
+//             [--changepoint] [--threshold-bpm N] [--tau S] [--convergence S] [--continuous] [--stress-tau S]
+//   --event plant    at least one PANIC JUMP/BLOCK in the session (default)
+//   --event frozen   the controller ended in its panic mode
+//   --check N        also run N plain sessions (seeds 1..N) and show where their rate falls
+// build: gcc -O2 -pthread -o rare rare.c sim.c batch.c corpus.c trace.c lockstep.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+
+#define N_SOPT1 (SC_SOPT1_MAX - SC_SOPT1_MIN + 1)
+#define N_STEP (SC_STEP_MAX - SC_STEP_MIN + 1)
+#define N_HALF (SC_HALF_MAX - SC_HALF_MIN + 1)
+
+#define N_PATH 70 // 8 steps, four LEFT and four UP
+
+#define MIX_P 0.1     // share of the final proposal that is p itself
+#define CE_SMOOTH 0.7 // weight of the refit against the previous q per round
+#define CE_PRIOR 20.0 // pseudo-hits spread like p in every refit
+#define Z95 1.959964
+
+#define EV_PLANT 0
+#define EV_FROZEN 1
+
+// the proposal: one categorical per drawn field
+typedef struct
+{
+    double sopt1[N_SOPT1];
+    double step[8][N_STEP];
+    double half[9][N_HALF];
+    double path[N_PATH];
+} Proposal;
+
+// the paths and how likely scenario_sample() draws each: a fair coin per step until one direction is used up
+static uint8_t g_path[N_PATH];
+static double g_path_p[N_PATH];
+static int g_path_idx[256];
+
+static void paths_init(void)
+{
+    int n = 0;
+    for (int m = 0; m < 256; m++)
+    {
+        g_path_idx[m] = -1;
+        if (__builtin_popcount((unsigned)m) != 4)
+            continue;
+        double pr = 1.0;
+        int left = 4, up = 4;
+        for (int i = 0; i < 8; i++)
+        {
+            if (left && up)
+                pr *= 0.5;
+            if ((m >> i) & 1)
+                up--;
+            else
+                left--;
+        }
+        g_path[n] = (uint8_t)m;
+        g_path_p[n] = pr;
+        g_path_idx[m] = n++;
+    }
+}
+
+static SimParams g_p;
+static int g_event = EV_PLANT;
+static SimWorld g_rng; // only its PRNG is used
+
+static double unif(void)
+{
+    return (sim_rand(&g_rng) + 0.5) / 4294967296.0;
+}
+
+static int draw_cat(const double *q, int n)
+{
+    double u = unif(), c = 0.0;
+    for (int i = 0; i < n - 1; i++)
+    {
+        c += q[i];
+        if (u < c)
+            return i;
+    }
+    return n - 1;
+}
+
+static void proposal_uniform(Proposal *q)
+{
+    for (int v = 0; v < N_SOPT1; v++)
+        q->sopt1[v] = 1.0 / N_SOPT1;
+    for (int k = 0; k < 8; k++)
+        for (int v = 0; v < N_STEP; v++)
+            q->step[k][v] = 1.0 / N_STEP;
+    for (int k = 0; k < 9; k++)
+        for (int v = 0; v < N_HALF; v++)
+            q->half[k][v] = 1.0 / N_HALF;
+    for (int v = 0; v < N_PATH; v++)
+        q->path[v] = g_path_p[v];
+}
+
+// q(x) / p(x) of the fields we tilt
+static double ratio_qp(const Proposal *q, const SimScenario *sc)
+{
+    double r = q->sopt1[sc->sopt1 - SC_SOPT1_MIN] * N_SOPT1;
+    for (int k = 0; k < 8; k++)
+        r *= q->step[k][sc->step[k] - SC_STEP_MIN] * N_STEP;
+    for (int k = 0; k < 9; k++)
+        r *= q->half[k][sc->half[k] - SC_HALF_MIN] * N_HALF;
+    int pi = g_path_idx[sc->path];
+    return r * q->path[pi] / g_path_p[pi];
+}
+
+// draw from (1 - mix) q + mix p, return the weight p / that
+static double draw(const Proposal *q, double mix, SimScenario *sc)
+{
+    if (unif() < mix)
+        scenario_sample(&g_rng, sc);
+    else
+    {
+        sc->path = g_path[draw_cat(q->path, N_PATH)];
+        sc->sopt1 = (uint8_t)(SC_SOPT1_MIN + draw_cat(q->sopt1, N_SOPT1));
+        for (int k = 0; k < 8; k++)
+            sc->step[k] = (uint8_t)(SC_STEP_MIN + draw_cat(q->step[k], N_STEP));
+        for (int k = 0; k < 9; k++)
+            sc->half[k] = (uint8_t)(SC_HALF_MIN + draw_cat(q->half[k], N_HALF));
+    }
+    return 1.0 / ((1.0 - mix) * ratio_qp(q, sc) + mix);
+}
+
+static int run_event(const SimScenario *sc)
+{
+    SimResult r;
+    if (sim_run_scenario(&g_p, sc, 0, 0, &r) != 0)
+    {
+        printf("[SYSTEM][ERROR] could not run a session\n");
+        exit(1);
+    }
+    return g_event == EV_PLANT ? r.panics > 0 : r.ctrl_panic != 0;
+}
+
+typedef struct
+{
+    double est, se; // estimate and its standard error
+    double ess;     // effective sample size of the weights
+    int hits;       // sessions with the event
+} Estimate;
+
+// n sessions from the mixture, optionally refitting q to the ones that hit the event (cross-entropy step)
+static Estimate sample(Proposal *q, double mix, int n, int refit)
+{
+    Proposal acc;
+    memset(&acc, 0, sizeof acc);
+    double sw = 0.0, sw2 = 0.0, wsum = 0.0, wsum2 = 0.0, wh = 0.0;
+    int hits = 0;
+    for (int i = 0; i < n; i++)
+    {
+        SimScenario sc;
+        double w = draw(q, mix, &sc);
+        wsum += w;
+        wsum2 += w * w;
+        if (!run_event(&sc))
+            continue;
+        hits++;
+        sw += w;
+        sw2 += w * w;
+        if (refit)
+        {
+            wh += w;
+            acc.sopt1[sc.sopt1 - SC_SOPT1_MIN] += w;
+            for (int k = 0; k < 8; k++)
+                acc.step[k][sc.step[k] - SC_STEP_MIN] += w;
+            for (int k = 0; k < 9; k++)
+                acc.half[k][sc.half[k] - SC_HALF_MIN] += w;
+            acc.path[g_path_idx[sc.path]] += w;
+        }
+    }
+
+    Estimate e;
+    e.hits = hits;
+    e.est = sw / n;
+    double var = sw2 / n - e.est * e.est;
+    e.se = sqrt((var > 0 ? var : 0) / n);
+    e.ess = wsum2 > 0 ? wsum * wsum / wsum2 : 0;
+
+    if (refit && hits > 0)
+    {
+        // weights are relative, scale them to sum to the number of hits so CE_PRIOR means hits
+        double s = hits / wh, d = hits + CE_PRIOR;
+        for (int v = 0; v < N_SOPT1; v++)
+            q->sopt1[v] = CE_SMOOTH * (acc.sopt1[v] * s + CE_PRIOR / N_SOPT1) / d + (1 - CE_SMOOTH) * q->sopt1[v];
+        for (int k = 0; k < 8; k++)
+            for (int v = 0; v < N_STEP; v++)
+                q->step[k][v] = CE_SMOOTH * (acc.step[k][v] * s + CE_PRIOR / N_STEP) / d + (1 - CE_SMOOTH) * q->step[k][v];
+        for (int k = 0; k < 9; k++)
+            for (int v = 0; v < N_HALF; v++)
+                q->half[k][v] = CE_SMOOTH * (acc.half[k][v] * s + CE_PRIOR / N_HALF) / d + (1 - CE_SMOOTH) * q->half[k][v];
+        for (int v = 0; v < N_PATH; v++)
+            q->path[v] = CE_SMOOTH * (acc.path[v] * s + CE_PRIOR * g_path_p[v]) / d + (1 - CE_SMOOTH) * q->path[v];
+    }
+    return e;
+}
+
+static void print_ci(const char *tag, double est, double se, int n)
+{
+    double lo = est - Z95 * se, hi = est + Z95 * se;
+    printf("%-14s %.5f  95%% CI [%.5f, %.5f]  rel. error %.1f%%  (%d sessions)\n", tag, est, lo > 0 ? lo : 0, hi,
+           est > 0 ? 100.0 * se / est : 0.0, n);
+}
+
+// how the fitted q leans compared to p, as the mean of each field under q
+static void print_proposal(const Proposal *q)
+{
+    double m = 0;
+    for (int v = 0; v < N_SOPT1; v++)
+        m += q->sopt1[v] * (SC_SOPT1_MIN + v);
+    printf("proposal means (uniform: Sopt1 %.1f, step %.1f, half %.1f)\n  Sopt1 %.1f\n  step ",
+           (SC_SOPT1_MIN + SC_SOPT1_MAX) / 2.0, (SC_STEP_MIN + SC_STEP_MAX) / 2.0, (SC_HALF_MIN + SC_HALF_MAX) / 2.0,
+           m);
+    for (int k = 0; k < 8; k++)
+    {
+        m = 0;
+        for (int v = 0; v < N_STEP; v++)
+            m += q->step[k][v] * (SC_STEP_MIN + v);
+        printf(" K%d:%.1f", k + 2, m);
+    }
+    printf("\n  half ");
+    for (int k = 0; k < 9; k++)
+    {
+        m = 0;
+        for (int v = 0; v < N_HALF; v++)
+            m += q->half[k][v] * (SC_HALF_MIN + v);
+        printf(" K%d:%.1f", k + 1, m);
+    }
+    printf("\n");
+
+    int best = 0;
+    for (int v = 1; v < N_PATH; v++)
+        if (q->path[v] / g_path_p[v] > q->path[best] / g_path_p[best])
+            best = v;
+    printf("  most boosted path ");
+    for (int i = 0; i < 8; i++)
+        printf("%c", ((g_path[best] >> i) & 1) ? 'U' : 'L');
+    printf(" (x%.1f)\n", q->path[best] / g_path_p[best]);
+}
+
+int main(int argc, char **argv)
+{
+    sim_params_default(&g_p);
+    g_p.policy = &policy_table; // what decision/main.c runs with CONTROLLER_USE_POLICY = 1
+    int n = 4000, rounds = 4, pilot = 1000, check = 0;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--rules") == 0)
+            g_p.policy = NULL;
+        else if (strcmp(a, "--changepoint") == 0)
+            g_p.hist_mode = HIST_CHANGEPOINT;
+        else if (strcmp(a, "--sessions") == 0 && v)
+            n = atoi(argv[++i]);
+        else if (strcmp(a, "--rounds") == 0 && v)
+            rounds = atoi(argv[++i]);
+        else if (strcmp(a, "--pilot") == 0 && v)
+            pilot = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--check") == 0 && v)
+            check = atoi(argv[++i]);
+        else if (strcmp(a, "--event") == 0 && v)
+        {
+            const char *e = argv[++i];
+            if (strcmp(e, "plant") == 0)
+                g_event = EV_PLANT;
+            else if (strcmp(e, "frozen") == 0)
+                g_event = EV_FROZEN;
+            else
+            {
+                printf("unknown event %s\n", e);
+                return 1;
+            }
+        }
+        else if (strcmp(a, "--threshold-bpm") == 0 && v)
+            g_p.thresholdBPM = atoi(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            g_p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            g_p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            g_p.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            g_p.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    if (n <= 0 || pilot <= 0 || rounds < 0)
+        return 1;
+
+    printf("rare: P(%s) for the %s controller\n", g_event == EV_PLANT ? "plant panic" : "controller panic mode",
+           g_p.policy ? "policy" : "rules");
+    sim_seed(&g_rng, seed);
+    paths_init();
+
+    // cross-entropy rounds. the first one draws from p, so it is also a small plain Monte Carlo run
+    Proposal q;
+    proposal_uniform(&q);
+    int spent = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        Estimate e = sample(&q, r == 0 ? 1.0 : MIX_P, pilot, 1);
+        spent += pilot;
+        printf("round %d: %4d of %d sessions hit, estimate %.5f +- %.5f\n", r + 1, e.hits, pilot, e.est, Z95 * e.se);
+        if (e.hits == 0)
+            printf("  no hits: q stays as it is (more --pilot sessions, or the event is out of reach)\n");
+    }
+    print_proposal(&q);
+
+    Estimate e = sample(&q, MIX_P, n, 0);
+    printf("\nfinal: %d of %d sessions hit, effective sample size %.0f\n", e.hits, n, e.ess);
+    print_ci("importance", e.est, e.se, n);
+    if (e.est > 0 && e.se > 0)
+    {
+        // plain Monte Carlo standard error is sqrt(P(1-P)/N)
+        double n_mc = e.est * (1 - e.est) / (e.se * e.se);
+        printf("plain Monte Carlo needs ~%.0f sessions for the same error (%.1fx, pilot rounds: %d sessions)\n",
+               n_mc, n_mc / (n + spent), spent);
+    }
+
+    if (check > 0)
+    {
+        SimResult *res = calloc((size_t)check, sizeof *res);
+        if (!res)
+            return 1;
+        if (sim_batch(&g_p, check, 0, 1, res) != 0)
+        {
+            printf("[SYSTEM][ERROR] some sessions failed to run\n");
+            free(res);
+            return 1;
+        }
+        int hits = 0;
+        for (int i = 0; i < check; i++)
+            hits += g_event == EV_PLANT ? res[i].panics > 0 : res[i].ctrl_panic != 0;
+        double pm = (double)hits / check;
+        print_ci("plain check", pm, sqrt(pm * (1 - pm) / check), check);
+        free(res);
+    }
+    return 0;
+}
@@ -0,0 +1,280 @@
+// ring.c — the simulator as the rest of the UART ring
+// Opens a pseudo-terminal pair and plays nodes 1 (heartbeat), 2 (crying) and 3 (motor) on it, so the real
+// decision program, built against the host libpynq stand-in (sim/host), runs closed loop on this plant. Frames
+// are ring/ring_frame.h's v2 ones, shown here as DST SRC PAYLOAD:
+//   x 0 'A'              ping for node 1..3         -> 0 x 'A'
+//   1 0 'H'              heartbeat request          -> 0 1 'H' bpm   BPM from S(t - TAU), like sim_run
+//   2 0 'C'              crying request             -> 0 2 'C' cry
+//   3 0 'M' a f          motor command              -> command_motor() on the cell those percentages belong to
+//   0 0 'V' ff ff        vitals collect frame       -> 0 0 'V' bpm cry, each slot left ff on a dropout
+//   1/2 0 'S' p          subscription               -> 0 1 'H' bpm / 0 2 'C' cry every p * 10 ms of plant time,
+//                                                      until SUB_LAPSE_S goes by without a renewal
+// Readings go through the world's sensor model; a dropout is a request that gets no answer, and the decision
+// node keeps its last value on its own. Frames for any other address are dropped.
+//
+// Plant time is wall time since the first byte arrived, times speed. Run the decision program with the same
+// LIBPYNQ_SPEED or the two clocks disagree. Past ~20x its 20 ms reply TIMEOUT gets shorter than a pty round
+// trip and replies start to go missing.
+//
+//   ./sim --ring /tmp/ryb-ring --speed 10 --policy
+//   LIBPYNQ_SPEED=10 ../decision/decision_host        (in a second terminal)
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "../ring/ring_frame.h"
+
+#define RING_MSTR 0
+#define RING_HRTBT 1
+#define RING_CRY 2
+#define RING_MTR 3
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_sigint(int sig)
+{
+    (void)sig;
+    g_stop = 1;
+}
+
+static double wall_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// percentages back to grid indexes. the levels are the ones decision/main.c's ctrl_command_cell() sends,
+// anything in between goes to the nearest one
+static int nearest_level(const int *levels, int v)
+{
+    int best = 0;
+    for (int i = 1; i < 5; i++)
+        if (abs(levels[i] - v) < abs(levels[best] - v))
+            best = i;
+    return best;
+}
+
+static void reply(int fd, uint8_t src, uint8_t type, int val)
+{
+    uint8_t pay[2] = {type, (uint8_t)(val >= 0 ? val : 0)}, f[RING_MAX_FRAME];
+    int n = ring_encode(f, RING_MSTR, src, pay, val >= 0 ? 2 : 1);
+    if (write(fd, f, (size_t)n) != n)
+        printf("[RING] reply to the decision node lost\n");
+}
+
+#define SUB_LAPSE_S 3.0 // a subscription the master stops renewing lapses, like SUB_LAPSE_MS on the nodes
+
+// subscriptions of the sensor nodes ('S'): publish period, plant time of the next publication and of the last
+// renewal, s
+static double g_pub_period[RING_NODES], g_pub_next[RING_NODES], g_sub_t[RING_NODES];
+
+// a request the node may not answer (the sensor model's dropout)
+static int dropped(SimWorld *w)
+{
+    return w->sensor.dropout > 0.0 && (sim_rand(w) + 0.5) / 4294967296.0 < w->sensor.dropout;
+}
+
+static void handle_frame(SimWorld *w, int fd, const ring_frame_t *f)
+{
+    uint8_t dst = f->dst, len = f->len;
+    const uint8_t *pay = f->pay;
+    if (dst == RING_MSTR && f->src == RING_MSTR && len >= RING_COLLECT_LEN && pay[0] == RING_COLLECT)
+    {
+        // the collect frame passes both sensor nodes on its way round, each fills its slot unless it drops out
+        uint8_t v[RING_MAX_PAY], out[RING_MAX_FRAME];
+        memcpy(v, pay, len);
+        if (!dropped(w))
+        {
+            int bpm = sim_sense_bpm(w, stress_delayed(w, now_sec(w), w->TAU));
+            v[RING_COLLECT_HB] = (uint8_t)(bpm < RING_NO_READING ? bpm : RING_NO_READING - 1);
+        }
+        if (!dropped(w))
+            v[RING_COLLECT_CRY] = (uint8_t)sim_sense_cry(w);
+        int n = ring_encode(out, RING_MSTR, RING_MSTR, v, len);
+        if (write(fd, out, (size_t)n) != n)
+            printf("[RING] collect frame lost on its way back\n");
+        return;
+    }
+    if (len < 1 || dst < RING_HRTBT || dst > RING_MTR)
+        return;
+
+    switch (pay[0])
+    {
+    case 'A':
+        reply(fd, dst, 'A', -1);
+        break;
+    case 'H':
+        if (dst == RING_HRTBT && !dropped(w))
+            reply(fd, dst, 'H', sim_sense_bpm(w, stress_delayed(w, now_sec(w), w->TAU)));
+        break;
+    case 'C':
+        if (dst == RING_CRY && !dropped(w))
+            reply(fd, dst, 'C', sim_sense_cry(w));
+        break;
+    case 'S':
+        if ((dst == RING_HRTBT || dst == RING_CRY) && len >= 2)
+        {
+            g_pub_period[dst] = pay[1] * 0.010;
+            g_sub_t[dst] = now_sec(w);
+            if (g_pub_next[dst] < now_sec(w) || g_pub_next[dst] > now_sec(w) + g_pub_period[dst])
+                g_pub_next[dst] = now_sec(w) + g_pub_period[dst];
+        }
+        break;
+    case 'M':
+        if (dst == RING_MTR && len >= 3)
+        {
+            static const int amp_levels[5] = {20, 40, 60, 80, 100};
+            static const int freq_levels[5] = {20, 35, 50, 65, 70};
+            command_motor(w, nearest_level(amp_levels, pay[1]), nearest_level(freq_levels, pay[2]));
+        }
+        break;
+    }
+}
+
+// the slave end of a fresh pty in raw mode. the slave fd stays open with us so the master never sees a hangup
+// between two runs of the decision program
+static int open_ring(int *master, int *slave, const char *link)
+{
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*master < 0 || grantpt(*master) != 0 || unlockpt(*master) != 0)
+        return -1;
+    const char *name = ptsname(*master);
+    if (!name)
+        return -1;
+    *slave = open(name, O_RDWR | O_NOCTTY);
+    if (*slave < 0)
+        return -1;
+    struct termios tio;
+    if (tcgetattr(*slave, &tio) != 0)
+        return -1;
+    cfmakeraw(&tio);
+    if (tcsetattr(*slave, TCSANOW, &tio) != 0)
+        return -1;
+
+    unlink(link); // an old link from an earlier run
+    if (symlink(name, link) != 0)
+    {
+        perror(link);
+        return -1;
+    }
+    printf("[RING] nodes 1-3 on %s (%s)\n", link, name);
+    return 0;
+}
+
+int sim_ring_serve(const SimParams *p, const SimScenario *sc, uint64_t seed, const char *link, double speed,
+                   double max_t)
+{
+    if (!(speed > 0.0))
+        return -1;
+    // the plant advances in small steps (one per poll of the pty). a dense history would keep a sample per
+    // step and its ring would no longer reach TAU back, so always change points
+    SimParams q = *p;
+    q.hist_mode = HIST_CHANGEPOINT;
+    SimWorld w;
+    if (sim_world_init(&w, seed) != 0 || sim_world_apply(&w, &q) != 0)
+    {
+        sim_world_free(&w);
+        return -1;
+    }
+    w.verbose = 1;
+
+    int master = -1, slave = -1;
+    if (open_ring(&master, &slave, link) != 0)
+    {
+        printf("[SYSTEM][ERROR] could not open the ring pty\n");
+        sim_world_free(&w);
+        return -1;
+    }
+    printf("[RING] start the decision program with LIBPYNQ_UART=%s LIBPYNQ_SPEED=%g\n", link, speed);
+    sim_session_start(&w, sc);
+
+    signal(SIGINT, on_sigint);
+    memset(g_pub_period, 0, sizeof g_pub_period);
+    memset(g_pub_next, 0, sizeof g_pub_next);
+    ring_rx_t rx;
+    ring_frame_t frame;
+    ring_rx_init(&rx);
+    double t0 = -1.0;
+    while (!g_stop)
+    {
+        struct pollfd pfd = {master, POLLIN, 0};
+        int r = poll(&pfd, 1, 1);
+        if (r < 0 && errno != EINTR)
+            break;
+
+        if (t0 < 0.0 && r > 0)
+        {
+            t0 = wall_sec();
+            printf("[RING] decision node is talking, plant clock running\n");
+        }
+        if (t0 >= 0.0)
+        {
+            double t = (wall_sec() - t0) * speed;
+            if (t > now_sec(&w))
+                advance_time(&w, t - now_sec(&w));
+        }
+
+        // subscribed readings fall due on the plant clock; a dropout loses that one publication
+        for (int node = RING_HRTBT; node <= RING_CRY; node++)
+        {
+            if (g_pub_period[node] > 0.0 && now_sec(&w) - g_sub_t[node] >= SUB_LAPSE_S)
+                g_pub_period[node] = 0.0;
+            if (!(g_pub_period[node] > 0.0) || now_sec(&w) < g_pub_next[node])
+                continue;
+            g_pub_next[node] += g_pub_period[node];
+            if (dropped(&w))
+                continue;
+            if (node == RING_HRTBT)
+                reply(master, RING_HRTBT, 'H', sim_sense_bpm(&w, stress_delayed(&w, now_sec(&w), w.TAU)));
+            else
+                reply(master, RING_CRY, 'C', sim_sense_cry(&w));
+        }
+
+        if (r > 0 && (pfd.revents & POLLIN))
+        {
+            uint8_t buf[256];
+            ssize_t n = read(master, buf, sizeof buf);
+            for (ssize_t i = 0; i < n; i++)
+            {
+                ring_rx_push(&rx, buf[i]);
+                while (ring_rx_pop(&rx, &frame))
+                    handle_frame(&w, master, &frame);
+            }
+        }
+
+        if (w.curA == 0 && w.curF == 0 && in_range(&w, 1, w.S))
+        {
+            w.calm_t = now_sec(&w);
+            break;
+        }
+        if (t0 >= 0.0 && now_sec(&w) >= max_t)
+            break;
+    }
+    signal(SIGINT, SIG_DFL);
+
+    if (w.calm_t >= 0.0)
+        printf("\n[RING] calm at A1F1/K1 after %.2f s\n", w.calm_t);
+    else
+        printf("\n[RING] not calm after %.2f s (A%d F%d K%d, S=%.1f)\n", now_sec(&w), w.curA + 1, w.curF + 1,
+               w.curK, w.S);
+    printf("[RING] %d moves, %d panics, stress area %.0f\n", w.moves, w.panics, w.stress_area);
+    if (rx.bad || rx.skipped)
+        printf("[RING] %u bad frames, %u bytes skipped resyncing\n", (unsigned)rx.bad, (unsigned)rx.skipped);
+
+    unlink(link);
+    close(slave);
+    close(master);
+    sim_world_free(&w);
+    return 0;
+}
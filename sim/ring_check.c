@@ -0,0 +1,294 @@
+// ring_check.c — ring/ring_link.h against byte sequences with a known right answer
+// Runs a node's receive/forward thread on the host libpynq, its UART on a fresh pseudo-terminal, and plays the
+// rest of the ring from the other end: writes bytes in, reads what the node sends on, and compares. Exits 1 if
+// any case fails, so it can run after every change to ring_frame.h / ring_link.h.
+//
+//   corrupt-then-good   a foreign frame with a bad CRC and a SYNC inside it, then a good one: both go out exactly
+//                       once, even though the receiver resyncs inside bytes it had already cut through
+//   collect-fill        the vitals collect frame through the heartbeat node, then the crying node: each writes its
+//                       reading into its slot in transit and fixes up the CRC, so the frame still checks out
+//   collect-corrupt     the same frame hit on the way in (a slot either node fills, or the CRC): still fails the
+//                       CRC after the heartbeat node has patched it
+//   collect-home        the filled frame back at the master: queued for the app, nothing sent on
+//   latest-fresh        heartbeat and cry readings published every PUB_MS while other frames for the node pile
+//                       up unread: the latest values never get older than 2 x PUB_MS and end on the last one sent
+//
+// usage: ring_check
+// build: gcc -O2 -pthread -Ihost -o ring_check ring_check.c host/libpynq.c
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "host/libpynq.h"
+#include "../ring/ring_link.h"
+
+#define QUIET_MS 100 // the node has sent everything once nothing more came for this long
+#define PUB_MS 200   // publish period of the sensor nodes' vitals stream
+#define PUBS 12      // publications per sensor in latest-fresh
+#define OTHERS 4     // full-size frames for the master that go with each publication and are never popped
+
+// the test side of a fresh pty; the host libpynq opens the other end as UART0 and puts it in raw mode
+static int open_pty(void)
+{
+    int m = posix_openpt(O_RDWR | O_NOCTTY);
+    if (m < 0 || grantpt(m) != 0 || unlockpt(m) != 0 || !ptsname(m))
+        return -1;
+    setenv("LIBPYNQ_UART", ptsname(m), 1);
+    uart_init(UART0);
+    return m;
+}
+
+// everything the node sends until it goes quiet, at most cap bytes
+static int read_all(int fd, uint8_t *buf, int cap)
+{
+    int n = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (n < cap && poll(&pfd, 1, QUIET_MS) > 0)
+    {
+        ssize_t r = read(fd, buf + n, (size_t)(cap - n));
+        if (r <= 0)
+            break;
+        n += (int)r;
+    }
+    return n;
+}
+
+static void dump(const char *what, const uint8_t *b, int n)
+{
+    printf("  %-9s", what);
+    for (int i = 0; i < n; i++)
+        printf(" %02x", b[i]);
+    printf("\n");
+}
+
+// the heartbeat node (1) passes on a frame for the motor (3) whose CRC was hit, with 0xA5 as its second payload
+// byte, followed by a good one. Forwarding cannot wait for the CRC, so the bad frame goes out whole; when its CRC
+// fails the receiver resyncs on that inner 0xA5, inside bytes that are already on the wire
+static int check_corrupt_then_good(int m)
+{
+    uint8_t in[2 * RING_MAX_FRAME];
+    uint8_t bad_pay[] = {'M', RING_SYNC, 2};
+    int nb = ring_encode(in, 3, 0, bad_pay, sizeof bad_pay);
+    in[nb - 1] ^= 0x5A;
+    uint8_t good_pay[] = {'M', 60, 50};
+    int n = nb + ring_encode(in + nb, 3, 0, good_pay, sizeof good_pay);
+
+    ring_link_t l;
+    if (ring_link_start(&l, UART0, 1, 1) != 0)
+        return 1;
+    if (write(m, in, (size_t)n) != n)
+        return 1;
+    uint8_t out[4 * RING_MAX_FRAME];
+    int got = read_all(m, out, sizeof out);
+    ring_link_stop(&l);
+
+    int ok = got == n && memcmp(out, in, (size_t)n) == 0 && l.rx.bad >= 1 && l.forwarded == 1;
+    printf("%-20s %s\n", "corrupt-then-good", ok ? "ok" : "FAIL");
+    if (!ok)
+    {
+        dump("sent in", in, n);
+        dump("came out", out, got);
+    }
+    return !ok;
+}
+
+// one sensor node's pass over in[]: its thread forwarding as me, with val for its collect slot; what it sent on
+static int pass_node(int m, uint8_t me, int slot, int val, const uint8_t *in, int n, uint8_t *out, int cap)
+{
+    ring_link_t l;
+    if (ring_link_start(&l, UART0, me, 1) != 0)
+        return -1;
+    ring_link_fill(&l, slot, val);
+    if (write(m, in, (size_t)n) != n)
+        n = -1;
+    int got = n < 0 ? -1 : read_all(m, out, cap);
+    ring_link_stop(&l);
+    return got;
+}
+
+// the good frames in b[0..n), the first one into *f; *bad counts the candidates that failed
+static int decode(const uint8_t *b, int n, ring_frame_t *f, uint32_t *bad)
+{
+    ring_rx_t rx;
+    ring_frame_t tmp;
+    int good = 0;
+    ring_rx_init(&rx);
+    for (int i = 0; i < n; i++)
+    {
+        ring_rx_push(&rx, b[i]);
+        while (ring_rx_pop(&rx, good ? &tmp : f))
+            good++;
+    }
+    *bad = rx.bad;
+    return good;
+}
+
+static int collect_frame(uint8_t *out, uint8_t hb, uint8_t cry)
+{
+    uint8_t pay[RING_COLLECT_LEN] = {RING_COLLECT};
+    pay[RING_COLLECT_HB] = hb;
+    pay[RING_COLLECT_CRY] = cry;
+    return ring_encode(out, 0, 0, pay, RING_COLLECT_LEN);
+}
+
+// the master's empty collect frame round the heartbeat node (1), then the crying node (2)
+static int check_collect_fill(int m)
+{
+    uint8_t in[RING_MAX_FRAME], mid[4 * RING_MAX_FRAME], out[4 * RING_MAX_FRAME];
+    int n = collect_frame(in, RING_NO_READING, RING_NO_READING);
+    int n_mid = pass_node(m, 1, RING_COLLECT_HB, 72, in, n, mid, sizeof mid);
+    int n_out = n_mid > 0 ? pass_node(m, 2, RING_COLLECT_CRY, 35, mid, n_mid, out, sizeof out) : -1;
+
+    ring_frame_t f1, f2;
+    uint32_t bad1, bad2;
+    int ok = n_mid == n && n_out == n && decode(mid, n_mid, &f1, &bad1) == 1 && bad1 == 0 &&
+             decode(out, n_out, &f2, &bad2) == 1 && bad2 == 0;
+    ok = ok && f1.pay[RING_COLLECT_HB] == 72 && f1.pay[RING_COLLECT_CRY] == RING_NO_READING;
+    ok = ok && f2.dst == 0 && f2.src == 0 && f2.len == RING_COLLECT_LEN && f2.pay[0] == RING_COLLECT &&
+         f2.pay[RING_COLLECT_HB] == 72 && f2.pay[RING_COLLECT_CRY] == 35;
+    printf("%-20s %s\n", "collect-fill", ok ? "ok" : "FAIL");
+    if (!ok)
+    {
+        dump("sent in", in, n);
+        dump("after hb", mid, n_mid);
+        dump("after cry", out, n_out);
+    }
+    return !ok;
+}
+
+// one bit flipped on the way to the heartbeat node, in the slot it overwrites, the crying node's slot or the
+// CRC. patching must not turn any of them into a frame that checks out
+static int check_collect_corrupt(int m)
+{
+    const int hit[] = {4 + RING_COLLECT_HB, 4 + RING_COLLECT_CRY, 4 + RING_COLLECT_LEN};
+    int failed = 0;
+    for (int k = 0; k < (int)(sizeof hit / sizeof hit[0]); k++)
+    {
+        uint8_t in[RING_MAX_FRAME], out[4 * RING_MAX_FRAME];
+        int n = collect_frame(in, RING_NO_READING, RING_NO_READING);
+        in[hit[k]] ^= 0x10;
+        int got = pass_node(m, 1, RING_COLLECT_HB, 72, in, n, out, sizeof out);
+
+        ring_frame_t f;
+        uint32_t bad;
+        // it still goes on whole, with the slot filled: the next receiver is the one that drops it
+        int ok = got == n && out[4 + RING_COLLECT_HB] == 72 && decode(out, got, &f, &bad) == 0 && bad >= 1;
+        if (!ok)
+        {
+            printf("  byte %d flipped:\n", hit[k]);
+            dump("sent in", in, n);
+            dump("came out", out, got);
+        }
+        failed |= !ok;
+    }
+    printf("%-20s %s\n", "collect-corrupt", failed ? "FAIL" : "ok");
+    return failed;
+}
+
+// the master (0) sends the collect frame to itself: back home it is the app's reply, not a frame to pass on
+static int check_collect_home(int m)
+{
+    uint8_t in[RING_MAX_FRAME], out[4 * RING_MAX_FRAME];
+    int n = collect_frame(in, 72, 35);
+
+    ring_link_t l;
+    if (ring_link_start(&l, UART0, 0, 0) != 0)
+        return 1;
+    if (write(m, in, (size_t)n) != n)
+        return 1;
+    int got = read_all(m, out, sizeof out);
+    ring_frame_t f;
+    int popped = ring_link_pop(&l, &f);
+    ring_link_stop(&l);
+
+    int ok = got == 0 && popped && f.src == 0 && f.dst == 0 && f.pay[0] == RING_COLLECT &&
+             f.pay[RING_COLLECT_HB] == 72 && f.pay[RING_COLLECT_CRY] == 35 && !ring_link_pop(&l, &f);
+    printf("%-20s %s\n", "collect-home", ok ? "ok" : "FAIL");
+    if (!ok)
+        dump("came out", out, got);
+    return !ok;
+}
+
+// the master (0) keeps H from the heartbeat node (1) and C from the cry node (2) as latest values and, like the
+// decision loop in a long sleep, never pops its queue. A second sender's frames for the master fill that queue
+// long before the last publication; the latest values must keep up all the same
+static int check_latest_fresh(int m)
+{
+    ring_link_t l;
+    if (ring_link_start(&l, UART0, 0, 0) != 0)
+        return 1;
+    int hb = ring_link_keep_latest(&l, 1, 'H');
+    int cry = ring_link_keep_latest(&l, 2, 'C');
+
+    uint32_t worst = 0;
+    int ok = hb >= 0 && cry >= 0;
+    for (int k = 1; k <= PUBS && ok; k++)
+    {
+        uint8_t f[2 * RING_MAX_FRAME + OTHERS * RING_MAX_FRAME];
+        uint8_t h[] = {'H', (uint8_t)(60 + k)}, c[] = {'C', (uint8_t)k}, other[RING_MAX_PAY] = {'?', (uint8_t)k};
+        int n = ring_encode(f, 0, 1, h, sizeof h);
+        n += ring_encode(f + n, 0, 2, c, sizeof c);
+        for (int j = 0; j < OTHERS; j++)
+            n += ring_encode(f + n, 0, 3, other, sizeof other);
+        if (write(m, f, (size_t)n) != n)
+            return 1;
+        // sample the way the app would between two publications
+        for (int t = 0; t < PUB_MS; t += 10)
+        {
+            usleep(10000);
+            int v;
+            uint32_t cnt, t_ms, now = (uint32_t)(ring_link_now_us() / 1000u);
+            for (int i = 0; i < 2; i++)
+            {
+                if (!ring_link_latest(&l, i == 0 ? hb : cry, &v, &cnt, &t_ms))
+                {
+                    if (k > 1 || t > PUB_MS / 2)
+                        ok = 0; // the first reading should long be in
+                    continue;
+                }
+                if (now - t_ms > worst)
+                    worst = now - t_ms;
+            }
+        }
+    }
+    int h_val = -1, c_val = -1;
+    uint32_t h_n = 0, c_n = 0;
+    ring_link_latest(&l, hb, &h_val, &h_n, NULL);
+    ring_link_latest(&l, cry, &c_val, &c_n, NULL);
+    ring_link_stop(&l);
+
+    ok = ok && worst <= 2 * PUB_MS && h_val == 60 + PUBS && c_val == PUBS && h_n == PUBS && c_n == PUBS &&
+         l.dropped > 0;
+    printf("%-20s %s\n", "latest-fresh", ok ? "ok" : "FAIL");
+    if (!ok)
+        printf("  oldest %u ms (max %d), H %d #%u, C %d #%u, %u queue drops\n", worst, 2 * PUB_MS, h_val, h_n, c_val,
+               c_n, l.dropped);
+    return !ok;
+}
+
+int main(void)
+{
+    pynq_init();
+    int m = open_pty();
+    if (m < 0)
+    {
+        printf("[SYSTEM][ERROR] could not open a pty\n");
+        return 1;
+    }
+    int failed = 0;
+    failed += check_corrupt_then_good(m);
+    failed += check_collect_fill(m);
+    failed += check_collect_corrupt(m);
+    failed += check_collect_home(m);
+    failed += check_latest_fresh(m);
+
+    uart_destroy(UART0);
+    close(m);
+    printf("%s\n", failed ? "ring_check: FAILED" : "ring_check: all ok");
+    return failed ? 1 : 0;
+}
@@ -1,82 +1,401 @@
 #include <stdio.h>
-#include <unistd.h>
 #include <stdlib.h>
-#include <time.h>
+#include <stdarg.h>
 #include <math.h>
-#include <windows.h>
+#include <string.h>
+
+#include "sim.h"
 
 #define AMP_CH 0
 #define FREQ_CH 1 // example, this is how its probably going to look like in production
-#define HIST_MAX 2048
-#define CONVERGENCE_TIME 4
-
-double Sopt[10];
-double BandLow[10];
-double BandHigh[10];
-int K[5][5];     // stress matrix (internal to sim; controller won't read it)
-int curA = 4;    // start at A5 (row index 4)(current a)
-int curF = 4;    // start at F5 (col index 4)(current f)
-int curK = 9;    // start at K9(current K)
-double S = 95.0; // current stress (0..100)
-double heartbeat = 240;
-
-// simulation clock & dense history sampling (no real waiting) ====
-// keep my sanity: we move time ourselves so delayed reads have data to interpolate. what is time?
-double sim_t = 0.0;      // simulated seconds since start
-double SAMPLE_DT = 0.05; // record history every 50 ms for nice interpolation
-double TAU = 10.0;       // heartbeat delay seconds (controller’s guess)
 
-// heartbeat- this is where shit goes crazy
-double hist_t[HIST_MAX]; // timestamps (seconds since start)
-double hist_s[HIST_MAX]; // recorded S values
-int hist_n = 0;          // number of samples stored
+// only talk when the world wants us to (batch runs keep quiet)
+static void sim_log(const SimWorld *w, const char *fmt, ...)
+{
+    if (!w->verbose)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+// append an event to the world's trace (if it keeps one)
+static void trace_ev(SimWorld *w, int type, int a, int f, int k, uint32_t val)
+{
+    if (!w->trace)
+        return;
+    TraceEvent e = {(uint32_t)(w->sim_t * 1000.0 + 0.5), (uint8_t)type, (uint8_t)a, (uint8_t)f, (uint8_t)k, val};
+    trace_buf_push(w->trace, e);
+}
+
+static uint32_t s10(double S)
+{
+    return (uint32_t)(S * 10.0 + 0.5);
+}
+
+// PRNG
+// splitmix64 to spread the seed, xorshift64* for the stream. tiny, fast and the same everywhere,
+// unlike rand() which is shared process state and differs between C libraries.
+void sim_seed(SimWorld *w, uint64_t seed)
+{
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z = z ^ (z >> 31);
+    w->rng = z ? z : 0x2545F4914F6CDD1Dull; // xorshift must never hold 0
+}
 
-// Append a (time, S) sample
-void record_stress_sample(double t_sec, double S_val)
+uint32_t sim_rand(SimWorld *w)
 {
-    if (hist_n < HIST_MAX)
+    uint64_t x = w->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    w->rng = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// standard normal (Box-Muller), always two draws so the stream does not depend on the values
+static double rand_gauss(SimWorld *w)
+{
+    double u1 = (sim_rand(w) + 0.5) / 4294967296.0;
+    double u2 = (sim_rand(w) + 0.5) / 4294967296.0;
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+// controller hooks: the production controller talks to the cradle through these, here the cradle is us
+static void sim_ctrl_command_cell(void *ctx, int aIndex, int fIndex)
+{
+    SimWorld *w = ctx;
+    int panics = w->panics;
+    command_motor(w, aIndex, fIndex);
+    if (w->panics != panics)
+        advance_epsilon(w); // the 10 ms between the panic and the controller's next look
+}
+
+static void sim_ctrl_log(void *ctx, const char *msg)
+{
+    sim_log(ctx, "%s", msg);
+}
+
+static double sim_ctrl_now_ms(void *ctx)
+{
+    return now_sec(ctx) * 1000.0;
+}
+
+// set a world to the start-of-session defaults. history is allocated with HIST_MAX samples.
+int sim_world_init(SimWorld *w, uint64_t seed)
+{
+    memset(w, 0, sizeof *w);
+
+    w->curA = 4;  // start at A5 (row index 4)
+    w->curF = 4;  // start at F5 (col index 4)
+    w->curK = 9;  // start at K9
+    w->S = 95.0;  // current stress (0..100)
+    w->heartbeat = 240;
+
+    // keep my sanity: we move time ourselves so delayed reads have data to interpolate. what is time?
+    w->sim_t = 0.0;
+    w->SAMPLE_DT = 0.05; // record history every 50 ms for nice interpolation
+    w->TAU = 10.0;       // heartbeat delay seconds
+    w->convergence_time = CONVERGENCE_TIME;
+    w->converge_at = -1.0;
+    w->stress_model = STRESS_INSTANT;
+    w->stress_tau = STRESS_TAU;
+    w->hist_mode = HIST_DENSE;
+
+    w->verbose = 1;
+    w->calm_t = -1.0;
+
+    controller_hooks_t hooks = {sim_ctrl_command_cell, sim_ctrl_log, sim_ctrl_now_ms, w};
+    controller_init(&w->ctrl, &hooks);
+
+    sim_seed(w, seed);
+    return hist_init(w, HIST_MAX);
+}
+
+void sim_params_default(SimParams *p)
+{
+    p->thresholdBPM = 10;
+    p->thresholdCRY = 1;
+    controller_consts_default(&p->consts);
+    p->TAU = 10.0;
+    p->convergence_time = CONVERGENCE_TIME;
+    p->hist_mode = HIST_DENSE;
+    p->hist_len = HIST_MAX;
+    p->stress_model = STRESS_INSTANT;
+    p->stress_tau = STRESS_TAU;
+    memset(&p->sensor, 0, sizeof p->sensor);
+    p->poll_ms = 0;
+    p->policy = NULL;
+    p->mpc = 0;
+    p->trace = NULL;
+}
+
+// copy the knobs into a freshly initialised world
+int sim_world_apply(SimWorld *w, const SimParams *p)
+{
+    w->ctrl.thresholdBPM = p->thresholdBPM;
+    w->ctrl.thresholdCRY = p->thresholdCRY;
+    if (p->consts.hb_delay_ms <= 0 || p->consts.cry_delay_ms <= 0 || p->consts.conv_delay_ms <= 0)
+        return -1; // a zero step period never lets time pass
+    w->ctrl.consts = p->consts;
+    w->ctrl.policy = p->policy;
+    if (p->mpc && !w->mpc)
+    {
+        w->mpc = malloc(sizeof *w->mpc);
+        if (!w->mpc)
+            return -1;
+    }
+    w->ctrl.mpc = p->mpc ? w->mpc : NULL;
+    w->TAU = p->TAU;
+    w->convergence_time = p->convergence_time;
+    if (p->stress_model == STRESS_EXP && !(p->stress_tau > 0.0))
+        return -1;
+    w->stress_model = p->stress_model;
+    w->stress_tau = p->stress_tau;
+    if (sim_sensor_check(&p->sensor))
+        return -1;
+    w->sensor = p->sensor;
+    if (p->poll_ms < 0)
+        return -1;
+    w->poll_ms = p->poll_ms;
+    w->hist_mode = p->hist_mode;
+    if (p->hist_len != w->hist_cap)
+        return hist_init(w, p->hist_len);
+    return 0;
+}
+
+// one full session: matrix from the scenario (or a random one from the seed when sc is NULL), start at
+// A5F5/K9, run the controller until calm, controller panic or out of steps. this is what main() does for a single run and
+// what the batch runner calls per scenario.
+int sim_run_scenario(const SimParams *p, const SimScenario *sc, uint64_t seed, int verbose, SimResult *out)
+{
+    SimWorld w;
+    if (sim_world_init(&w, seed) != 0 || sim_world_apply(&w, p) != 0)
     {
-        hist_t[hist_n] = t_sec;
-        hist_s[hist_n] = S_val;
-        hist_n++;
+        sim_world_free(&w);
+        return -1;
     }
+    w.verbose = verbose;
+
+    TraceBuf tb = {0};
+    if (p->trace)
+    {
+        w.trace = &tb;
+        trace_ev(&w, TR_SESSION, p->thresholdBPM, 0, p->mpc ? 2 : p->policy ? 1 : 0, (uint32_t)seed);
+    }
+
+    sim_session_start(&w, sc);
+    run_controller(&w);
+
+    if (p->trace)
+    {
+        trace_ev(&w, TR_END, w.curA, w.curF, w.curK, w.calm_t >= 0.0 ? (uint32_t)(w.calm_t * 1000.0 + 0.5) : TRACE_NOT_CALM);
+        trace_write(p->trace, &tb);
+        trace_buf_free(&tb);
+    }
+
+    if (out)
+    {
+        out->calm = (w.calm_t >= 0.0);
+        out->calm_t = w.calm_t;
+        out->moves = w.moves;
+        out->panics = w.panics;
+        out->finalK = w.curK;
+        out->end_t = now_sec(&w);
+        out->visited = w.visited;
+        out->stress_area = w.stress_area;
+        out->ctrl_panic = w.ctrl.panic_mode;
+        out->thr_lo = w.ctrl.thr_lo;
+        out->thr_hi = w.ctrl.thr_hi;
+    }
+    sim_world_free(&w);
+    return 0;
+}
+
+// the plant side of a session start: matrix from the scenario (random from the world's seed when sc is NULL),
+// this session's sensor calibration, baby at A5F5/K9 on Sopt[9]
+void sim_session_start(SimWorld *w, const SimScenario *sc)
+{
+    if (sc)
+        scenario_build(w, sc);
     else
+        generate_matrix(w);
+    get_heartbeat(w, w->Sopt[9]); // much needed on init
+    w->cry_gain = 1.0; // the boot calibration of the crying node, off by this much for the whole session
+    w->cry_offset = 0.0;
+    if (w->sensor.cry_gain > 0.0)
+        w->cry_gain += w->sensor.cry_gain * rand_gauss(w);
+    if (w->sensor.cry_offset > 0.0)
+        w->cry_offset = w->sensor.cry_offset * rand_gauss(w);
+
+    // Start + record first sample (internal sim state)
+    set_initial_state(w, 4, 4, 9, w->Sopt[9]);
+}
+
+int sim_run_session(const SimParams *p, uint64_t seed, int verbose, SimResult *out)
+{
+    return sim_run_scenario(p, NULL, seed, verbose, out);
+}
+
+void sim_world_free(SimWorld *w)
+{
+    free(w->hist_t);
+    free(w->hist_s);
+    free(w->hist_g);
+    w->hist_t = NULL;
+    w->hist_s = NULL;
+    w->hist_g = NULL;
+    w->hist_cap = 0;
+    w->hist_n = 0;
+    free(w->mpc);
+    w->mpc = NULL;
+    w->ctrl.mpc = NULL;
+}
+
+// heartbeat- this is where shit goes crazy
+// circular history: once full the oldest sample gets overwritten, so recording is O(1) per tick
+// no matter how long the session runs. length is set with hist_init() (defaults to HIST_MAX).
+
+// (re)allocate the history ring with room for cap samples. drops anything recorded so far.
+int hist_init(SimWorld *w, int cap)
+{
+    if (cap < 2)
+        cap = 2; // need two samples to interpolate
+    double *t = realloc(w->hist_t, (size_t)cap * sizeof *t);
+    if (!t)
+        return -1;
+    w->hist_t = t;
+    double *s = realloc(w->hist_s, (size_t)cap * sizeof *s);
+    if (!s)
+        return -1;
+    w->hist_s = s;
+    double *g = realloc(w->hist_g, (size_t)cap * sizeof *g);
+    if (!g)
+        return -1;
+    w->hist_g = g;
+    w->hist_cap = cap;
+    w->hist_head = 0;
+    w->hist_n = 0;
+    return 0;
+}
+
+// logical index i (0 = oldest) -> physical slot in the ring
+static inline int hist_idx(const SimWorld *w, int i)
+{
+    int p = w->hist_head + i;
+    return (p >= w->hist_cap) ? p - w->hist_cap : p;
+}
+
+// Append a (time, S) sample. S_val is S at t_sec; where it is heading from there is the world's business
+// (S_goal while relaxing), so a change point also records that.
+void record_stress_sample(SimWorld *w, double t_sec, double S_val)
+{
+    if (w->hist_cap == 0 && hist_init(w, HIST_MAX) != 0)
+        return;
+
+    double goal = w->relaxing ? w->S_goal : S_val;
+
+    if (w->hist_mode == HIST_CHANGEPOINT && w->hist_n > 0)
     {
-        // simplest overwrite behavior: shift left (slow but easy)
-        for (int i = 1; i < HIST_MAX; i++)
+        int last = hist_idx(w, w->hist_n - 1);
+        if (w->hist_s[last] == S_val && w->hist_g[last] == goal)
+            return; // nothing changed, nothing to store
+        if (w->hist_t[last] >= t_sec)
         {
-            hist_t[i - 1] = hist_t[i];
-            hist_s[i - 1] = hist_s[i];
+            // several changes at the same instant: only the final value is ever observable
+            w->hist_s[last] = S_val;
+            w->hist_g[last] = goal;
+            return;
         }
-        hist_t[HIST_MAX - 1] = t_sec;
-        hist_s[HIST_MAX - 1] = S_val;
+    }
+
+    if (w->hist_n < w->hist_cap)
+    {
+        int slot = hist_idx(w, w->hist_n);
+        w->hist_t[slot] = t_sec;
+        w->hist_s[slot] = S_val;
+        w->hist_g[slot] = goal;
+        w->hist_n++;
+    }
+    else
+    {
+        // full: overwrite the oldest slot and move the head past it
+        w->hist_t[w->hist_head] = t_sec;
+        w->hist_s[w->hist_head] = S_val;
+        w->hist_g[w->hist_head] = goal;
+        w->hist_head = hist_idx(w, 1);
     }
 }
 
-// drive the simulation time forward by dt and keep recording S while time passes
-void advance_time(double dt)
+// the only place the clock moves. both models integrate exactly: S is either constant over dt, or an
+// exponential towards S_goal (S_goal + (S - S_goal) e^(-dt/stress_tau)), whose integral is closed form too
+static void tick(SimWorld *w, double dt)
+{
+    w->sim_t += dt;
+    if (!w->relaxing)
+    {
+        w->stress_area += w->S * dt;
+        return;
+    }
+    double e = exp(-dt / w->stress_tau);
+    double gap = w->S - w->S_goal;
+    w->stress_area += w->S_goal * dt + gap * w->stress_tau * (1.0 - e);
+    w->S = w->S_goal + gap * e;
+}
+
+// let time pass, recording S in dense mode
+static void advance_plain(SimWorld *w, double dt)
 {
     if (dt <= 0)
         return;
+    if (w->hist_mode == HIST_CHANGEPOINT)
+    {
+        // S is constant while time just passes (or follows the exponential recorded at its last change),
+        // so there is nothing to record
+        tick(w, dt);
+        return;
+    }
     double remain = dt;
     while (remain > 1e-9)
     {
-        double step = (remain > SAMPLE_DT) ? SAMPLE_DT : remain;
-        sim_t += step;
-        record_stress_sample(sim_t, S);
+        double step = (remain > w->SAMPLE_DT) ? w->SAMPLE_DT : remain;
+        tick(w, step);
+        record_stress_sample(w, w->sim_t, w->S);
         remain -= step;
     }
 }
 
+// drive the simulation time forward by dt and keep recording S while time passes.
+// a convergence that lands inside the interval (also exactly at its end) is applied on the way.
+void advance_time(SimWorld *w, double dt)
+{
+    if (dt <= 0)
+        return;
+    double end = w->sim_t + dt;
+    if (w->converge_at >= 0.0 && w->converge_at <= end + 1e-9)
+    {
+        advance_plain(w, w->converge_at - w->sim_t);
+        w->converge_at = -1.0;
+        w->S = w->Sopt[w->curK];
+        record_stress_sample(w, now_sec(w), w->S);
+        trace_ev(w, TR_CONVERGE, w->curA, w->curF, w->curK, s10(w->S));
+        print_status(w, "[SYSTEM]converged");
+    }
+    advance_plain(w, end - w->sim_t);
+}
+
 // tiny nudge to separate equal timestamps in logs when we instant-set S
-void advance_epsilon(void)
+void advance_epsilon(SimWorld *w)
 {
-    sim_t += 0.01; // 10 ms nudge
-    record_stress_sample(sim_t, S);
+    tick(w, 0.01); // 10 ms nudge
+    record_stress_sample(w, w->sim_t, w->S);
 }
 
 // get "now"
-double now_sec(void) { return sim_t; }
+double now_sec(const SimWorld *w) { return w->sim_t; }
 
 // Linear interpolation helper. This is the same as Linear approximation. Turns out that is actually really usefull irl.
 double lerp(double x0, double y0, double x1, double y1, double x)
@@ -87,46 +406,74 @@ double lerp(double x0, double y0, double x1, double y1, double x)
     return y0 + u * (y1 - y0);
 }
 
+// change-point history: S(t) follows from the last change at or before t (exact, no interpolation):
+// constant, or relaxing from there towards the recorded goal
+static double stress_delayed_changepoint(const SimWorld *w, double target)
+{
+    // binary search for the first index with time > target
+    int lo = 0, hi = w->hist_n;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) >> 1;
+        if (w->hist_t[hist_idx(w, mid)] <= target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    // before the first change we only know the oldest value
+    if (lo == 0)
+        return w->hist_s[hist_idx(w, 0)];
+    int i = hist_idx(w, lo - 1);
+    if (w->hist_g[i] == w->hist_s[i])
+        return w->hist_s[i];
+    return w->hist_g[i] + (w->hist_s[i] - w->hist_g[i]) * exp(-(target - w->hist_t[i]) / w->stress_tau);
+}
+
 // Return S(t - tau). If not enough history, fall back sensibly.
-double stress_delayed(double now_sec_val, double tau_sec)
+// The binary search runs over logical indices (0 = oldest) so it does not care where the ring wraps.
+double stress_delayed(const SimWorld *w, double now_sec_val, double tau_sec)
 {
-    if (hist_n == 0)
-        return S;
+    if (w->hist_n == 0)
+        return w->S;
 
     const double EPS = 1e-6;
     double target = now_sec_val - tau_sec;
 
+    if (w->hist_mode == HIST_CHANGEPOINT)
+        return stress_delayed_changepoint(w, target);
+
+    const double *ht = w->hist_t;
+    const double *hs = w->hist_s;
+    int first = hist_idx(w, 0);
+    int last = hist_idx(w, w->hist_n - 1);
+
     // clamp to history bounds
-    if (target <= hist_t[0] + EPS)
-        return hist_s[0];
-    if (target >= hist_t[hist_n - 1] - EPS)
-        return hist_s[hist_n - 1];
+    if (target <= ht[first] + EPS)
+        return hs[first];
+    if (target >= ht[last] - EPS)
+        return hs[last];
 
-    // binary search for the first index with time >= target
-    int lo = 0, hi = hist_n - 1;
+    // binary search for the first index with time > target (+EPS)
+    int lo = 0, hi = w->hist_n - 1;
     while (lo < hi)
     {
         int mid = (lo + hi) >> 1;
-        if (hist_t[mid] < target)
+        if (ht[hist_idx(w, mid)] <= target + EPS)
             lo = mid + 1;
         else
             hi = mid;
     }
-    // lo is the first index with t >= target
-    int i1 = lo;     // t[i1] >= target
-    int i0 = i1 - 1; // t[i0] <  target
+    // lo is the first index with t > target
+    int i1 = hist_idx(w, lo);     // t[i1] >  target
+    int i0 = hist_idx(w, lo - 1); // t[i0] <= target
 
-    // if we basically hit an exact timestamp, return it
-    if (fabs(hist_t[i1] - target) <= EPS)
-        return hist_s[i1];
-    if (fabs(hist_t[i0] - target) <= EPS)
-        return hist_s[i0];
+    // if we basically hit an exact timestamp, return it. several samples can share it (a move records the
+    // new S at the same instant); the newest one wins, same as the change-point history
+    if (fabs(ht[i0] - target) <= EPS)
+        return hs[i0];
 
     // linear interpolate between the bracketing samples
-    double x0 = hist_t[i0], y0 = hist_s[i0];
-    double x1 = hist_t[i1], y1 = hist_s[i1];
-    double u = (target - x0) / (x1 - x0);
-    return y0 + u * (y1 - y0);
+    return lerp(ht[i0], hs[i0], ht[i1], hs[i1], target);
 }
 
 // MOTOR
@@ -176,20 +523,17 @@ void set_pwm_percent(int channel, int percent)
     // never exceed 90% (emergency)
 }
 
-// forward decl (sim engine)
-void move_to_cell(int newA, int newF);
-
 // amp, freq are percentages (0-100).
 // Any value inside an interval maps to that (A,F) cell.
 // We "command" the cradle logically via move_to_cell(A-1, F-1).
 // aIndex, fIndex are 0-4 (matrix indices)
-void command_motor(int aIndex, int fIndex)
+void command_motor(SimWorld *w, int aIndex, int fIndex)
 {
     // safety
     if (aIndex < 0 || aIndex > 4 || fIndex < 0 || fIndex > 4)
     {
-        printf("[SYSTEM][ERROR] command_motor out-of-bounds A%d F%d\n",
-               aIndex + 1, fIndex + 1);
+        sim_log(w, "[SYSTEM][ERROR] command_motor out-of-bounds A%d F%d\n",
+                aIndex + 1, fIndex + 1);
         return;
     }
 
@@ -200,11 +544,11 @@ void command_motor(int aIndex, int fIndex)
     set_pwm_percent(AMP_CH, dutyA);
     set_pwm_percent(FREQ_CH, dutyF);
 
-    move_to_cell(aIndex, fIndex);
+    move_to_cell(w, aIndex, fIndex);
 }
 
 // simulated crying based on current stress level
-double get_crying()
+static double crying_of(double S)
 {
     if (S <= 100 && S >= 50)
         return 100.0;
@@ -214,45 +558,293 @@ double get_crying()
         return 0;
 }
 
-double get_heartbeat(double stress_delayed_val)
+double sim_cry_of(const SimWorld *w, double S)
+{
+    const double *m = w->sensor.cry_map;
+    if (m[0] == 0.0 && m[1] == 0.0)
+        return crying_of(S);
+    double c = m[0] + m[1] * S;
+    return c < 0.0 ? 0.0 : c > 100.0 ? 100.0 : c;
+}
+
+double sim_bpm_of(const SimWorld *w, double S)
+{
+    const double *m = w->sensor.bpm_map;
+    if (m[0] == 0.0 && m[1] == 0.0)
+        return 60.0 + 1.8 * S;
+    return m[0] + m[1] * S;
+}
+
+double get_crying(const SimWorld *w)
+{
+    return sim_cry_of(w, w->S);
+}
+
+double get_heartbeat(SimWorld *w, double stress_delayed_val)
+{
+    w->heartbeat = sim_bpm_of(w, stress_delayed_val);
+    return w->heartbeat;
+}
+
+// SENSORS
+// what a poll of the heartbeat and crying nodes returns, through w->sensor. the ideal sensor is the plain
+// round(get_heartbeat()) / round(get_crying()). every reading makes the same number of PRNG draws whatever
+// the values are, so a session still replays the same for every thresholdBPM in [thr_lo, thr_hi]
+
+static int quantise(double v, int step, int hi)
+{
+    int q = (step > 1) ? step * (int)round(v / step) : (int)round(v);
+    return q < 0 ? 0 : q > hi ? hi : q;
+}
+
+// heartbeat_update(): beats come at the rate the baby's heart had (S TAU seconds before each beat), the
+// reported BPM is 60000 / the integer mean of the last bpm_beats intervals in ms. walks back from a beat now
+int sim_sense_bpm(SimWorld *w, double S_tau)
+{
+    const SimSensor *s = &w->sensor;
+    double hb = get_heartbeat(w, S_tau);
+    if (s->bpm_beats <= 0)
+        return quantise(hb, s->bpm_step, 255);
+
+    double t = now_sec(w), total = 0.0;
+    for (int b = 0; b < s->bpm_beats; b++)
+    {
+        double rate = sim_bpm_of(w, stress_delayed(w, t, w->TAU));
+        double ibi = 60000.0 / rate;
+        if (s->bpm_jitter > 0.0)
+            ibi += s->bpm_jitter * rand_gauss(w);
+        if (ibi < 250.0) // the node's refractory period
+            ibi = 250.0;
+        total += (int)ibi;
+        t -= ibi / 1000.0;
+    }
+    int avg = (int)(total / s->bpm_beats);
+    return quantise(60000 / avg, s->bpm_step, 255);
+}
+
+// cry_sampler_update(): the P2P level of a window a little in the past, through this session's calibration
+int sim_sense_cry(SimWorld *w)
+{
+    const SimSensor *s = &w->sensor;
+    double S = (s->cry_lag > 0.0) ? stress_delayed(w, now_sec(w), s->cry_lag) : w->S;
+    double c = sim_cry_of(w, S) * w->cry_gain + w->cry_offset;
+    if (s->cry_noise > 0.0)
+        c += s->cry_noise * rand_gauss(w);
+    return quantise(c, s->cry_step, 100);
+}
+
+// one poll of both nodes. a dropped reply leaves the decision node's last value in place, like decision/main.c
+void sense_vitals(SimWorld *w, double S_tau, int *bpm, int *cry)
+{
+    int b = sim_sense_bpm(w, S_tau);
+    int c = sim_sense_cry(w);
+    if (w->sensor.dropout > 0.0)
+    {
+        if ((sim_rand(w) + 0.5) / 4294967296.0 >= w->sensor.dropout)
+            w->last_bpm = b;
+        if ((sim_rand(w) + 0.5) / 4294967296.0 >= w->sensor.dropout)
+            w->last_cry = c;
+        b = w->last_bpm;
+        c = w->last_cry;
+    }
+    *bpm = b;
+    *cry = c;
+}
+
+// a guess at the real nodes, not a measurement: 10-beat average with a few samples of detection jitter at
+// 200 Hz, a calibration good to ~10%, a few percent of window noise, now and then a lost reply
+void sim_sensor_real(SimSensor *s)
+{
+    memset(s, 0, sizeof *s);
+    s->bpm_beats = 10;
+    s->bpm_jitter = 15.0;
+    s->cry_gain = 0.1;
+    s->cry_offset = 3.0;
+    s->cry_noise = 4.0;
+    s->cry_lag = 0.2;
+    s->dropout = 0.02;
+}
+
+int sim_sensor_ideal(const SimSensor *s)
+{
+    return s->bpm_beats <= 0 && s->bpm_jitter <= 0.0 && s->bpm_step <= 1 && s->cry_gain <= 0.0 &&
+           s->cry_offset <= 0.0 && s->cry_noise <= 0.0 && s->cry_lag <= 0.0 && s->cry_step <= 1 &&
+           s->dropout <= 0.0 && s->bpm_map[0] == 0.0 && s->bpm_map[1] == 0.0 && s->cry_map[0] == 0.0 &&
+           s->cry_map[1] == 0.0;
+}
+
+const char *sim_sensor_check(const SimSensor *s)
 {
-    heartbeat = 60.0 + 1.8 * stress_delayed_val;
-    return heartbeat;
+    if (s->bpm_beats < 0 || s->bpm_beats > 64)
+        return "--bpm-beats must be 0..64";
+    if (s->bpm_jitter < 0.0 || s->cry_gain < 0.0 || s->cry_offset < 0.0 || s->cry_noise < 0.0)
+        return "sensor noise must be >= 0";
+    if (s->cry_lag < 0.0)
+        return "--cry-lag must be >= 0";
+    if (s->bpm_step > 255 || s->cry_step > 100)
+        return "quantisation step too large";
+    if (s->dropout < 0.0 || s->dropout >= 1.0)
+        return "--dropout must be in [0, 1)";
+    if (((s->bpm_map[0] != 0.0 || s->bpm_map[1] != 0.0) && !(s->bpm_map[1] > 0.0)) ||
+        ((s->cry_map[0] != 0.0 || s->cry_map[1] != 0.0) && !(s->cry_map[1] > 0.0)))
+        return "--bpm-map / --cry-map need a positive slope";
+    return NULL;
+}
+
+void sim_sensor_describe(const SimSensor *s, char *buf, int len)
+{
+    SimSensor real;
+    sim_sensor_real(&real);
+    if (sim_sensor_ideal(s))
+        snprintf(buf, (size_t)len, "ideal");
+    else if (memcmp(s, &real, sizeof real) == 0)
+        snprintf(buf, (size_t)len, "real");
+    else
+    {
+        int n = snprintf(buf, (size_t)len, "beats=%d jit=%g q=%d gain=%g off=%g noise=%g lag=%g q=%d drop=%g",
+                         s->bpm_beats, s->bpm_jitter, s->bpm_step, s->cry_gain, s->cry_offset, s->cry_noise,
+                         s->cry_lag, s->cry_step, s->dropout);
+        if (n > 0 && n < len && (s->bpm_map[1] != 0.0 || s->cry_map[1] != 0.0))
+            snprintf(buf + n, (size_t)(len - n), " bpm=%g%+gS cry=%g%+gS", s->bpm_map[0], s->bpm_map[1],
+                     s->cry_map[0], s->cry_map[1]);
+    }
+}
+
+int sim_sensor_option(SimSensor *s, int argc, char **argv, int *i)
+{
+    const char *a = argv[*i];
+    if (*i + 1 >= argc)
+        return 0;
+    const char *v = argv[*i + 1];
+    if (strcmp(a, "--sensor") == 0)
+    {
+        if (strcmp(v, "real") == 0)
+            sim_sensor_real(s);
+        else if (strcmp(v, "ideal") == 0)
+            memset(s, 0, sizeof *s);
+        else
+            return 0;
+    }
+    else if (strcmp(a, "--bpm-beats") == 0)
+        s->bpm_beats = atoi(v);
+    else if (strcmp(a, "--bpm-jitter") == 0)
+        s->bpm_jitter = atof(v);
+    else if (strcmp(a, "--bpm-step") == 0)
+        s->bpm_step = atoi(v);
+    else if (strcmp(a, "--cry-gain") == 0)
+        s->cry_gain = atof(v);
+    else if (strcmp(a, "--cry-offset") == 0)
+        s->cry_offset = atof(v);
+    else if (strcmp(a, "--cry-noise") == 0)
+        s->cry_noise = atof(v);
+    else if (strcmp(a, "--cry-lag") == 0)
+        s->cry_lag = atof(v);
+    else if (strcmp(a, "--cry-step") == 0)
+        s->cry_step = atoi(v);
+    else if (strcmp(a, "--dropout") == 0)
+        s->dropout = atof(v);
+    else if (strcmp(a, "--bpm-map") == 0)
+    {
+        if (sscanf(v, "%lf,%lf", &s->bpm_map[0], &s->bpm_map[1]) != 2)
+            return 0;
+    }
+    else if (strcmp(a, "--cry-map") == 0)
+    {
+        if (sscanf(v, "%lf,%lf", &s->cry_map[0], &s->cry_map[1]) != 2)
+            return 0;
+    }
+    else
+        return 0;
+    (*i)++;
+    return 1;
 }
 
 // Force system into K9 panic and make outputs match Sopt[9]
-void go_panic(const char *tag)
+void go_panic(SimWorld *w, const char *tag)
 {
+    w->panics++;
+    w->converge_at = -1.0; // whatever was settling, it is not anymore
+    w->relaxing = 0;
+
     // 1) set stress to K9's Sopt and record immediately
-    S = Sopt[9];
-    record_stress_sample(now_sec(), S);
+    w->S = w->Sopt[9];
+    record_stress_sample(w, now_sec(w), w->S);
+    trace_ev(w, TR_PANIC, w->curA, w->curF, w->curK, s10(w->S));
 
     // 3) recompute outputs coherently
 
-    heartbeat = get_heartbeat(S);
+    get_heartbeat(w, w->S);
 
-    int cry_now = (int)round(get_crying());
+    int cry_now = (int)round(get_crying(w));
 
-    // 4) log + tiny nudge to separate timestamps
-    printf("[%s] PANIC -> S=%.1f, HB=%.0f, CRY=%d @t=%.2f\n",
-           tag, S, heartbeat, cry_now, now_sec());
-
-    advance_epsilon();
+    // 4) log. the plant leaves the clock alone; whoever drives it adds advance_epsilon() to separate timestamps
+    sim_log(w, "[%s] PANIC -> S=%.1f, HB=%.0f, CRY=%d @t=%.2f\n",
+            tag, w->S, w->heartbeat, cry_now, now_sec(w));
 }
 
-void generate_matrix()
+// uniform integer in [0, n) from the world's own stream (replaces rand() % n)
+static int rand_below(SimWorld *w, int n)
 {
-    int a, f;
+    return (int)(sim_rand(w) % (uint32_t)n);
+}
 
-    srand(time(0)); // intialize the random seed
+// draw a random scenario the way the cradle does: Sopt[1], the 8 Sopt steps, the 9 band half-widths,
+// then the LEFT/UP path. same draw order as before, so a seed still gives the same matrix.
+void scenario_sample(SimWorld *w, SimScenario *sc)
+{
+    // the random seed comes from the world (sim_world_init / sim_seed), not from the clock
 
     // determine the first sopt for level K1 (idk if the sopt for k1 is always zero but well see)
-    Sopt[1] = 10.0 + (rand() % 6); // 5 + a random value between 0-5
+    sc->sopt1 = (uint8_t)(SC_SOPT1_MIN + rand_below(w, 6)); // 5 + a random value between 0-5
 
     // each next Sopt is increased by a small random step of  (7-14), capped at 98
     for (int k = 2; k <= 9; k++)
+        sc->step[k - 2] = (uint8_t)(SC_STEP_MIN + rand_below(w, 5)); // 7 + a random value between 0-5
+
+    // ideally every step has a range of 11ish. we are going to move based on that. This is just an assumption
+    for (int k = 1; k <= 9; k++)
+        sc->half[k - 1] = (uint8_t)(SC_HALF_MIN + rand_below(w, 7)); // random value between 6-12
+
+    /* RANDOM path from K9 K1 (LEFT/UP moves) */
+    int leftMoves = 4;
+    int upMoves = 4;
+    sc->path = 0;
+
+    for (int i = 0; i < 8; i++)
     {
-        int step = 7.0 + (rand() % 5); // 7 + a random value between 0-5
+        int dir; // 0 = LEFT, 1 = UP
+
+        if (leftMoves == 0)
+            dir = 1; // must go UP
+        else if (upMoves == 0)
+            dir = 0; // must go LEFT
+        else
+            dir = rand_below(w, 2);
+
+        if (dir == 0)
+            leftMoves--;
+        else
+        {
+            upMoves--;
+            sc->path |= (uint8_t)(1u << i);
+        }
+    }
+}
+
+// turn a scenario into the world's Sopt / bands / K matrix
+void scenario_build(SimWorld *w, const SimScenario *sc)
+{
+    int a, f;
+    double *Sopt = w->Sopt;
+    double *BandLow = w->BandLow;
+    double *BandHigh = w->BandHigh;
+    int (*K)[5] = w->K;
+
+    Sopt[1] = sc->sopt1;
+
+    for (int k = 2; k <= 9; k++)
+    {
+        int step = sc->step[k - 2];
         int next = (int)(Sopt[k - 1] + step);
         if (next > 98.0)
             next = 98.0;
@@ -262,10 +854,9 @@ void generate_matrix()
     }
     // Sopt for K9 is Spanic (i think)
 
-    // ideally every step has a range of 11ish. we are going to move based on that. This is just an assumption
     for (int k = 1; k <= 9; k++)
     {
-        double half = 6.0 + (rand() % 7); // random value between 6-12
+        double half = sc->half[k - 1];
         BandLow[k] = Sopt[k] - half;
         BandHigh[k] = Sopt[k] + half;
         if (BandLow[k] < 0.0)
@@ -300,35 +891,17 @@ void generate_matrix()
     K[0][0] = 1; // A1 F1
     K[4][4] = 9; // A5 F5
 
-    /* RANDOM path from K9 K1 (LEFT/UP moves) */
+    // walk the path from K9 to K1: bit i of sc->path says whether step i goes UP (else LEFT)
     int adx = 4;  // start at A5 (row 4)
     int fdx = 4;  // start at F5 (col 4)
     int kcur = 9; // current K label at start
 
-    int leftMoves = 4;
-    int upMoves = 4;
-
-    while (kcur > 1)
+    for (int i = 0; i < 8 && kcur > 1; i++)
     {
-        int dir; // 0 = LEFT, 1 = UP
-
-        if (leftMoves == 0)
-            dir = 1; // must go UP
-        else if (upMoves == 0)
-            dir = 0; // must go LEFT
+        if ((sc->path >> i) & 1u)
+            adx = (adx > 0) ? adx - 1 : adx;
         else
-            dir = rand() % 2;
-
-        if (dir == 0 && leftMoves > 0 && (fdx - 1) >= 0)
-        {
-            fdx = fdx - 1;
-            leftMoves--;
-        }
-        else if (dir == 1 && upMoves > 0 && (adx - 1) >= 0)
-        {
-            adx = adx - 1;
-            upMoves--;
-        }
+            fdx = (fdx > 0) ? fdx - 1 : fdx;
 
         kcur = kcur - 1;    // lower the k
         K[adx][fdx] = kcur; // place K on the path
@@ -377,66 +950,176 @@ void generate_matrix()
 
     for (int k = 1; k <= 9; k++)
     {
-        printf("K%d: Sopt=%5.1f  range=[%5.1f, %5.1f]\n",
-               k, Sopt[k], BandLow[k], BandHigh[k]);
+        sim_log(w, "K%d: Sopt=%5.1f  range=[%5.1f, %5.1f]\n",
+                k, Sopt[k], BandLow[k], BandHigh[k]);
     }
 
-    printf("\n");
+    sim_log(w, "\n");
 
     for (a = 0; a < 5; a++)
     {
         for (f = 0; f < 5; f++)
         {
-            printf("K%d", K[a][f]);
+            sim_log(w, "K%d", K[a][f]);
             if (f < 4)
-                printf(" ");
+                sim_log(w, " ");
+        }
+        sim_log(w, "\n");
+    }
+}
+
+void generate_matrix(SimWorld *w)
+{
+    SimScenario sc;
+    scenario_sample(w, &sc);
+    scenario_build(w, &sc);
+}
+
+void sim_scenario_format(const SimScenario *sc, char *buf, int len)
+{
+    char path[9];
+    for (int i = 0; i < 8; i++)
+        path[i] = ((sc->path >> i) & 1u) ? 'U' : 'L';
+    path[8] = '\0';
+    snprintf(buf, (size_t)len, "s1=%d step=%d,%d,%d,%d,%d,%d,%d,%d half=%d,%d,%d,%d,%d,%d,%d,%d,%d path=%s", sc->sopt1,
+             sc->step[0], sc->step[1], sc->step[2], sc->step[3], sc->step[4], sc->step[5], sc->step[6], sc->step[7],
+             sc->half[0], sc->half[1], sc->half[2], sc->half[3], sc->half[4], sc->half[5], sc->half[6], sc->half[7],
+             sc->half[8], path);
+}
+
+int sim_scenario_parse(const char *str, SimScenario *sc)
+{
+    int s1, st[8], h[9];
+    char path[16];
+    if (sscanf(str, "s1=%d step=%d,%d,%d,%d,%d,%d,%d,%d half=%d,%d,%d,%d,%d,%d,%d,%d,%d path=%15s", &s1, &st[0], &st[1],
+               &st[2], &st[3], &st[4], &st[5], &st[6], &st[7], &h[0], &h[1], &h[2], &h[3], &h[4], &h[5], &h[6], &h[7],
+               &h[8], path) != 19)
+        return -1;
+    if (s1 < SC_SOPT1_MIN || s1 > SC_SOPT1_MAX || strlen(path) != 8)
+        return -1;
+    sc->sopt1 = (uint8_t)s1;
+    for (int i = 0; i < 8; i++)
+    {
+        if (st[i] < SC_STEP_MIN || st[i] > SC_STEP_MAX)
+            return -1;
+        sc->step[i] = (uint8_t)st[i];
+    }
+    for (int i = 0; i < 9; i++)
+    {
+        if (h[i] < SC_HALF_MIN || h[i] > SC_HALF_MAX)
+            return -1;
+        sc->half[i] = (uint8_t)h[i];
+    }
+    // four LEFT and four UP, like every path the cradle draws
+    int ups = 0;
+    sc->path = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        if (path[i] == 'U')
+        {
+            sc->path |= (uint8_t)(1u << i);
+            ups++;
         }
-        printf("\n");
+        else if (path[i] != 'L')
+            return -1;
     }
+    return ups == 4 ? 0 : -1;
 }
 
-int in_range(int k, double v)
+int in_range(const SimWorld *w, int k, double v)
 {
     if (k < 1 || k > 9)
         return 0;
-    return (v >= BandLow[k] && v <= BandHigh[k]);
+    return (v >= w->BandLow[k] && v <= w->BandHigh[k]);
 }
 
-void print_status(const char *tag)
+void print_status(const SimWorld *w, const char *tag)
 {
-    printf("[%s] pos=A%d F%d  K%d  S=%.1f  (band %.1f-%.1f  Sopt=%.1f) @t=%.2f\n",
-           tag, curA + 1, curF + 1, curK, S, BandLow[curK], BandHigh[curK], Sopt[curK], now_sec());
+    sim_log(w, "[%s] pos=A%d F%d  K%d  S=%.1f  (band %.1f-%.1f  Sopt=%.1f) @t=%.2f\n",
+            tag, w->curA + 1, w->curF + 1, w->curK, w->S, w->BandLow[w->curK], w->BandHigh[w->curK],
+            w->Sopt[w->curK], now_sec(w));
 }
 
-// Converge to Sopt of current K after ~2 seconds IF inside range
+// Converge to Sopt of current K convergence_time after the move IF inside range
 // we need to wait for convergence to sopt because we know sopt is guarenteed to be in the lower Ks range. or else we would cause a stress jump
-void converge_now()
+// the clock belongs to the controller loop now, so this only schedules it; advance_time() lands it.
+// the exponential model starts heading for Sopt right here instead, and tick() does the rest.
+void converge_now(SimWorld *w)
 {
-    advance_time(CONVERGENCE_TIME);
-    S = Sopt[curK];
-    record_stress_sample(now_sec(), S);
-    print_status("[SYSTEM]converged");
+    if (w->stress_model == STRESS_EXP)
+    {
+        w->relaxing = 1;
+        w->S_goal = w->Sopt[w->curK];
+        record_stress_sample(w, now_sec(w), w->S);
+        trace_ev(w, TR_CONVERGE, w->curA, w->curF, w->curK, s10(w->S_goal));
+        return;
+    }
+    w->converge_at = now_sec(w) + w->convergence_time;
 }
 
 /* called when you change cell. You MUST pass the K-label for that cell.
    newA/newF are 0..4 indexes (A1-A5 -> 0-4, F1-F5 -> 0-4). newK is 1-9.
 */
-void move_to_cell(int newA, int newF)
+void move_to_cell(SimWorld *w, int newA, int newF)
 {
     if (newA < 0 || newA > 4 || newF < 0 || newF > 4)
     {
-        printf("[SYSTEM][ERROR] out-of-bounds move A%d F%d ignored.\n", newA + 1, newF + 1);
+        sim_log(w, "[SYSTEM][ERROR] out-of-bounds move A%d F%d ignored.\n", newA + 1, newF + 1);
         return;
     }
 
-    int oldA = curA;
-    int oldF = curF;
-    int oldK = curK;
+    int oldA = w->curA;
+    int oldF = w->curF;
+    int oldK = w->curK;
 
-    int targetK = K[newA][newF];
+    int targetK = w->K[newA][newF];
+    w->moves++;
+    w->visited |= 1u << (newA * 5 + newF);
 
-    printf("\n[SYSTEM] MOVE request: A%d F%d  K%d ---> A%d F%d  K%d \n",
-           oldA + 1, oldF + 1, oldK, newA + 1, newF + 1, targetK);
+    sim_log(w, "\n[SYSTEM] MOVE request: A%d F%d  K%d ---> A%d F%d  K%d \n",
+            oldA + 1, oldF + 1, oldK, newA + 1, newF + 1, targetK);
+    trace_ev(w, TR_MOVE, newA, newF, targetK, (uint32_t)(oldA * 5 + oldF) | s10(w->S) << 8);
+
+    int kind = sim_move_kind(oldA, oldF, newA, newF, w->S, w->BandLow[oldK], w->BandHigh[oldK],
+                             w->BandLow[targetK], w->BandHigh[targetK]);
+
+    w->curA = newA;
+    w->curF = newF;
+    w->curK = targetK;
+
+    switch (kind)
+    {
+    case MOVE_INSIDE:
+        sim_log(w, "[SYSTEM] inside-band");
+        converge_now(w);
+        return;
+    case MOVE_PANIC_JUMP:
+        go_panic(w, "PANIC JUMP");
+        return;
+    case MOVE_PANIC_BLOCK:
+        go_panic(w, "PANIC BLOCK");
+        return;
+    }
+
+    if (w->S < w->BandLow[w->curK])
+        w->S = w->BandLow[w->curK];
+    if (w->S > w->BandHigh[w->curK])
+        w->S = w->BandHigh[w->curK];
+    record_stress_sample(w, now_sec(w), w->S);
+    if (kind == MOVE_MIXED)
+        print_status(w, "[SYSTEM] mixed-move-converge");
+    else
+        sim_log(w, "[SYSTEM][WARNING] overlap-converge. This is an unwanted message");
+    converge_now(w);
+}
+
+// what a move does to the baby, from the stress S at the moment of the move and the bands of the old and new K.
+// the one place that decides it, so the lockstep engine (lockstep.c) cannot drift from move_to_cell()
+int sim_move_kind(int oldA, int oldF, int newA, int newF, double S, double oldLo, double oldHi, double newLo,
+                  double newHi)
+{
+    if (S >= newLo && S <= newHi)
+        return MOVE_INSIDE;
 
     int softerA = (newA < oldA);
     int softerF = (newF < oldF);
@@ -446,287 +1129,106 @@ void move_to_cell(int newA, int newF)
     int is_soft = ((softerA || softerF) && !(harderA || harderF));
     int is_hard = ((harderA || harderF) && !(softerA || softerF));
 
-    int overlap = 1;
-    if (BandHigh[oldK] < BandLow[targetK] || BandLow[oldK] > BandHigh[targetK])
-        overlap = 0;
-
-    curA = newA;
-    curF = newF;
-    curK = targetK;
-
-    if (in_range(curK, S))
-    {
-        printf("[SYSTEM] inside-band");
-        converge_now();
-
-        return;
-    }
-
-    if (!overlap)
+    if (oldHi < newLo || oldLo > newHi) // the bands do not overlap
     {
         if (is_soft)
-        {
-            go_panic("PANIC JUMP");
-            return;
-        }
-        else if (is_hard)
-        {
-            go_panic("PANIC BLOCK");
-            return;
-        }
-        else
-        {
-            if (S < BandLow[curK])
-                S = BandLow[curK];
-            if (S > BandHigh[curK])
-                S = BandHigh[curK];
-            record_stress_sample(now_sec(), S);
-            print_status("[SYSTEM] mixed-move-converge");
-            converge_now();
-
-            return;
-        }
+            return MOVE_PANIC_JUMP;
+        if (is_hard)
+            return MOVE_PANIC_BLOCK;
+        return MOVE_MIXED;
     }
-
-    if (S < BandLow[curK])
-        S = BandLow[curK];
-    if (S > BandHigh[curK])
-        S = BandHigh[curK];
-    record_stress_sample(now_sec(), S);
-    printf("[SYSTEM][WARNING] overlap-converge. This is an unwanted message");
-    converge_now();
+    return MOVE_OVERLAP;
 }
 
 // CONTROLLR LOGIC
-// recuresive???
-
-// evaluate heartbeat improvement thresholds
-// controller state
-// CONTROLLER STATE
-int lastBPM = 0;
-int thresholdBPM = 10;
-int crying_started = 0; // keep for future, unused in simple rule
-
-// remember where we came from (anchor cell)
-int prevA = -1;
-int prevF = -1;
-
-// add at top-level
-int anchorA_mem = -1, anchorF_mem = -1;
-int triedLeftFromAnchor = 0;
-
-// how we moved last step from (prevA,prevF) to current
-// 0 = none/initial, 1 = left (F-1), 2 = up (A-1)
-int lastMoveDir = 0;
+// lives in decision/controller.c, we only run its loop. the controller state sits in the world (w->ctrl)
+// so two worlds never see each other's decisions.
 
 // set starting state once, after you call generate_matrix(). keep my sanity.
-void set_initial_state(int aIndex, int fIndex, int kLabel, double Sstart)
-{
-    curA = aIndex;
-    curF = fIndex;
-    curK = kLabel;
-    S = Sstart;
-    record_stress_sample(now_sec(), S);
-    print_status("init");
-
-    prevA = curA;
-    prevF = curF;
-    lastMoveDir = 0;
-}
-
-// Return 1 if BPM looks better than before, 0 otherwise.
-// Also may flip crying_started if clearly worse.
-// "Improved" = closer to calm:
-// - either near rest (<= 60 + thresholdBPM)
-// - or dropped by at least thresholdBPM vs lastBPM
-// replace your signature or keep it the same and read globals
-int heartbeat_improved(int bpm_now)
-{
-    // immediate improvement: lower K than where we came from
-    if (curK < K[prevA][prevF])
-        return 1;
-
-    if (bpm_now <= 60 + thresholdBPM)
-        return 1;
-    if (lastBPM > 0 && bpm_now <= lastBPM - thresholdBPM)
-        return 1;
-    return 0;
+void set_initial_state(SimWorld *w, int aIndex, int fIndex, int kLabel, double Sstart)
+{
+    w->curA = aIndex;
+    w->curF = fIndex;
+    w->curK = kLabel;
+    w->S = Sstart;
+    w->visited |= 1u << (aIndex * 5 + fIndex);
+    record_stress_sample(w, now_sec(w), w->S);
+    print_status(w, "init");
 }
 
-void run_decision_once(void)
+// the decision module's main loop on a virtual clock: sense, step, then wait the step period the
+// controller asks for (HEARTBEAT_DELAY / CRYING_DELAY / CONVERGENCE_DELAY). waiting is just advance_time().
+// The vitals are what the submodules would report right then: BPM from S(t - TAU), CRY from S(t), through
+// the world's sensor model (sense_vitals()). With a poll period they are from the last poll before the step
+// instead: decision/main.c polls every VITALS_POLL_MS on its own timer, which lines up with the step timer
+// again after each step, so a step period that is not a multiple of the poll period leaves the vitals
+// period % poll_ms old.
+// Calm means the controller reached A1F1 and the baby is inside the K1 band there.
+void run_controller(SimWorld *w)
 {
-    // 1) Catch up to the LAST move.
-    advance_time(TAU);
-
-    // 2) Sense delayed stress -> BPM/CRY
-    double S_tau = stress_delayed(now_sec(), TAU);
-    int bpm_now = (int)round(get_heartbeat(S_tau));
-    int cry_now = (int)round(get_crying());
-
-    printf("[SENSE] S_tau=%.1f  BPM=%d  CRY=%d  pos=A%d F%d K%d @t=%.2f\n",
-           S_tau, bpm_now, cry_now, curA + 1, curF + 1, curK, now_sec());
-
-    // 3) Evaluate last move
-    int improved = heartbeat_improved(bpm_now);
-
-    // Ensure anchor memory is aligned with our current "home" cell when idle
-    if (lastMoveDir == 0)
-    {
-        if (anchorA_mem != curA || anchorF_mem != curF)
-        {
-            anchorA_mem = curA;
-            anchorF_mem = curF;
-            triedLeftFromAnchor = 0; // new anchor => haven't tried LEFT here
-        }
-    }
-
-    // 4) choose first trial from this anchor
-    if (lastMoveDir == 0)
-    {
-        prevA = curA;
-        prevF = curF;
-
-        if (!triedLeftFromAnchor && curF > 0)
-        {
-            lastMoveDir = 1;         // LEFT
-            triedLeftFromAnchor = 1; // remember we tried LEFT at this anchor
-            printf("[ALGORITHM] initial/pick -> try LEFT from A%d F%d\n", curA + 1, curF + 1);
-            command_motor(curA, curF - 1);
-            lastBPM = bpm_now;
-            return;
-        }
-        else if (curA > 0)
-        {
-            lastMoveDir = 2; // UP
-            printf("[ALGORITHM] initial/pick -> try UP from A%d F%d (LEFT tried/blocked)\n", curA + 1, curF + 1);
-            command_motor(curA - 1, curF);
-            lastBPM = bpm_now;
-            return;
-        }
-        else
-        {
-            // Nowhere softer to go
-            printf("[ALGORITHM] at softest corner; waiting");
-            lastBPM = bpm_now;
-            return;
-        }
-    }
+    controller_t *c = &w->ctrl;
+    controller_start(c);
+    uint32_t anchors = 0; // cells already traced as anchors (bit a*5+f)
 
-    // 5) We HAVE a last move. Determine anchor:
-    //    - if improved -> current cell becomes new anchor (reset LEFT-tried flag)
-    //    - if not     -> backtrack to previous (prevA, prevF) and keep LEFT-tried flag
-    if (improved)
+    double S_tau = 0.0;
+    int bpm_now = 0, cry_now = 0, polled = 0;
+    for (int step = 0; step < SIM_MAX_STEPS; ++step)
     {
-        int anchorA = curA;
-        int anchorF = curF;
-        printf("[ALGORITHM] last move (dir=%d) IMPROVED -> new anchor at A%d F%d\n",
-               lastMoveDir, anchorA + 1, anchorF + 1);
-
-        // Refresh anchor memory and reset LEFT attempt flag
-        if (anchorA_mem != anchorA || anchorF_mem != anchorF)
+        if (!polled)
         {
-            anchorA_mem = anchorA;
-            anchorF_mem = anchorF;
-            triedLeftFromAnchor = 0;
+            S_tau = stress_delayed(w, now_sec(w), w->TAU);
+            sense_vitals(w, S_tau, &bpm_now, &cry_now);
         }
-
-        // From the new anchor, prefer LEFT; else UP
-        prevA = anchorA;
-        prevF = anchorF;
-
-        if (anchorF > 0)
+        polled = 0;
+
+        sim_log(w, "\n[ALGORITHM] Controller Step %d \n", step + 1);
+        sim_log(w, "[SENSE] S_tau=%.1f  BPM=%d  CRY=%d  pos=A%d F%d K%d @t=%.2f\n",
+                S_tau, bpm_now, cry_now, w->curA + 1, w->curF + 1, w->curK, now_sec(w));
+        trace_ev(w, TR_SENSE, w->curA, w->curF, w->curK, (uint32_t)bpm_now | (uint32_t)cry_now << 8 | s10(S_tau) << 16);
+
+        controller_step(c, bpm_now, cry_now);
+
+        trace_ev(w, TR_DECISION, c->curA, c->curF,
+                 c->lastMoveDir | c->probe << 2 | c->panic_mode << 4 | c->is_crying_activated << 5 | c->hit_wall << 6,
+                 (uint32_t)controller_step_period_ms(c));
+        if (w->trace)
+            for (int a = 0; a < 5; a++)
+                for (int f = 0; f < 5; f++)
+                    if (c->anchorMatrix[a][f] && !(anchors & 1u << (a * 5 + f)))
+                    {
+                        anchors |= 1u << (a * 5 + f);
+                        trace_ev(w, TR_ANCHOR, a, f, c->anchorLevel, (uint32_t)c->anchorMatrix[a][f]);
+                    }
+
+        if (c->calm_reached)
         {
-            lastMoveDir = 1;         // LEFT
-            triedLeftFromAnchor = 1; // about to try LEFT here
-            printf("[ALGORITHM] improved -> next try LEFT from A%d F%d\n", anchorA + 1, anchorF + 1);
-            command_motor(anchorA, anchorF - 1);
-        }
-        else if (anchorA > 0)
-        {
-            lastMoveDir = 2; // UP
-            printf("[ALGORITHM] improved -> next try UP from A%d F%d\n", anchorA + 1, anchorF + 1);
-            command_motor(anchorA - 1, anchorF);
-        }
-        
-
-        lastBPM = bpm_now;
-        return;
-    }
-    else
-    {
-        // No improvement.
-        // If we just moved LEFT but K didn't change, switch direction to UP immediately.
-        if (lastMoveDir == 1 && K[curA][curF] == K[prevA][prevF])
-        {
-            int anchorA = prevA;
-            int anchorF = prevF;
-
-            if (anchorA > 0)
+            // the controller calls it calm as soon as it commands A1F1. only count it if that move did not
+            // panic the baby on the way in
+            if (in_range(w, 1, w->S))
             {
-                // Try UP from the anchor without an extra backtrack cycle.
-                printf("[ALGORITHM] left kept same K -> try UP from A%dF%d\n",
-                       anchorA + 1, anchorF + 1);
-
-                // Re-align to anchor logically
-                curA = anchorA;
-                curF = anchorF;
-
-                lastMoveDir = 2; // UP
-                command_motor(anchorA - 1, anchorF);
-                lastBPM = bpm_now;
-                return;
+                w->calm_t = c->calm_elapsed_ms / 1000.0;
+                sim_log(w, "[ALGORITHM] rest reached\n");
             }
-            // If can't go UP, fall through to standard backtrack.
+            else
+                sim_log(w, "[ALGORITHM] controller says calm but the baby panicked\n");
+            break;
         }
-
-        // Standard backtrack path (unchanged)
-        int anchorA = prevA, anchorF = prevF;
-        if (anchorA != curA || anchorF != curF)
+        if (c->panic_mode)
         {
-            printf("[ALGORITHM] last move (dir=%d) NO IMPROVEMENT -> backtrack to A%dF%d\n",
-                   lastMoveDir, anchorA + 1, anchorF + 1);
-            command_motor(anchorA, anchorF);
-        }
-        curA = anchorA;
-        curF = anchorF;
-        lastMoveDir = 0; // re-bootstrap next cycle
-        lastBPM = bpm_now;
-        return;
-    }
-}
-
-void run_controller()
-{
-    // Drive the controller for some steps
-
-    for (int step = 0; step < 40; ++step)
-    {
-        printf("\n[ALGORITHM] Controller Step %d \n", step + 1);
-        run_decision_once();
-
-        // stop if we’ve reached A1F1 and converged near K1
-        if (curA == 0 && curF == 0 && curK == 1){
-            printf("[ALGORITHM] rest reached");
+            // production freezes at A1F1 until someone restarts it, nothing left to simulate
+            sim_log(w, "[ALGORITHM] controller panic, frozen\n");
             break;
         }
 
-            
+        int period_ms = controller_step_period_ms(c);
+        int age_ms = (w->poll_ms > 0) ? period_ms % w->poll_ms : 0;
+        advance_time(w, (period_ms - age_ms) / 1000.0);
+        if (age_ms > 0)
+        {
+            S_tau = stress_delayed(w, now_sec(w), w->TAU);
+            sense_vitals(w, S_tau, &bpm_now, &cry_now);
+            polled = 1;
+            advance_time(w, age_ms / 1000.0);
+        }
     }
 }
-
-int main(void)
-{
-    generate_matrix();
-    heartbeat = get_heartbeat(Sopt[9]); // much needed on init. also reminds me
-    lastBPM = heartbeat;
-    // that we should wait for tau seconds at the start because if its a delayed value its not going to read anything
-    // until tau seconds are actually passed
-
-    // Start + record first sample (internal sim state)
-    set_initial_state(4, 4, 9, Sopt[9]);
-
-    run_controller();
-
-    printf("\nfinished at t = %.3f s.\n", now_sec());
-    return 0;
-}
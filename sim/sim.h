@@ -0,0 +1,280 @@
+// sim.h — cradle/baby plant simulator (runs on PC)
+// Everything the simulator knows lives in a SimWorld, so any number of worlds can run side by side
+// in one process (and in parallel) without sharing hidden state. Every sim function takes the world
+// it works on as its first argument.
+//
+// The controller is not a copy: it is decision/controller.c, the same file the PYNQ runs, driven by this plant
+// on a virtual clock (a 10 s HEARTBEAT_DELAY costs nothing).
+//
+// build: gcc -O2 -pthread -o sim sim.c batch.c corpus.c trace.c lockstep.c ring.c main.c ../decision/controller.c -lm
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include "../decision/controller.h"
+#include "trace.h"
+
+#ifndef HIST_MAX
+#define HIST_MAX 2048 // default history length, override with -DHIST_MAX=... or hist_init()
+#endif
+#define CONVERGENCE_TIME 4
+#define SIM_MAX_STEPS 60 // controller steps per session before we give up
+
+// bump whenever the controller or plant logic changes, so cached corpus results (corpus.c) are not reused
+#define SIM_CONTROLLER_REV 5
+
+// how the stress history is kept:
+// HIST_DENSE       - a (t, S) sample every SAMPLE_DT, delayed reads interpolate between samples
+// HIST_CHANGEPOINT - only the moments S changes. S is piecewise constant between them, so a delayed
+//                    read is exact and time passing costs nothing (S only changes on move/converge/panic)
+#define HIST_DENSE 0
+#define HIST_CHANGEPOINT 1
+
+// how S settles after a move:
+// STRESS_INSTANT - S stays put for convergence_time, then jumps to Sopt of the new K (the original model)
+// STRESS_EXP     - S relaxes towards Sopt right away, dS/dt = (Sopt - S) / stress_tau. integrated with the
+//                  exact exponential step, so a long wait costs one exp() and not one step per sample
+#define STRESS_INSTANT 0
+#define STRESS_EXP 1
+#define STRESS_TAU (CONVERGENCE_TIME / 3.0) // default time constant: 95% of the way there after CONVERGENCE_TIME
+
+// what the sensor nodes do to the vitals before the controller sees them. all zero is the ideal sensor: the
+// exact values, rounded to the uint8 the ring carries (what the sim always did). sim_sensor_real() is a guess at
+// the real nodes: heartbeat_update() averages 10 beat intervals, cry_sampler_update() reports 200 ms P2P
+// windows scaled by a calibration done once at boot
+typedef struct
+{
+    int bpm_beats;     // BPM = 60000 / mean of the last N beat intervals in ms, as heartbeat_update() does (0 = instant)
+    double bpm_jitter; // beat detection jitter, sd of each interval in ms
+    int bpm_step;      // report BPM in steps of this many (<= 1: whole BPM)
+    double cry_gain;   // calibration error, sd of the per-session gain (0.1 = 10%)
+    double cry_offset; // calibration error, sd of the per-session offset in percent
+    double cry_noise;  // sd of the window-to-window noise in percent
+    double cry_lag;    // seconds the cry reading trails S (P2P window + poll)
+    int cry_step;      // report cry in steps of this many (<= 1: whole percent)
+    double dropout;    // chance a reading never arrives; the decision node keeps its last value (0 at start)
+    double bpm_map[2]; // BPM = [0] + [1] * S. all zero = 60 + 1.8 S (sysid.c fits these from recorded sessions)
+    double cry_map[2]; // cry = [0] + [1] * S within 0..100. all zero = 2.5 S - 25 with the sim's own clipping
+} SimSensor;
+
+typedef struct
+{
+    // plant (hidden from the controller)
+    double Sopt[10];
+    double BandLow[10];
+    double BandHigh[10];
+    int K[5][5];      // stress matrix (internal to sim; controller won't read it)
+    int curA;         // current A (row index, A5 = 4)
+    int curF;         // current F (col index, F5 = 4)
+    int curK;         // current K
+    double S;         // current stress (0..100)
+    double heartbeat; // last heartbeat output
+
+    // simulation clock (no real waiting)
+    double sim_t;     // simulated seconds since start
+    double SAMPLE_DT; // dense history sample period
+    double TAU;       // heartbeat delay seconds (controller’s guess)
+    double convergence_time; // seconds until S settles on Sopt after a move
+    double converge_at;      // when the pending convergence lands, < 0 if none (instant model)
+    int stress_model;        // STRESS_INSTANT or STRESS_EXP
+    double stress_tau;       // time constant of the exponential model, seconds
+    int relaxing;            // exponential model: S is heading for S_goal
+    double S_goal;
+
+    // sensors (see SimSensor)
+    SimSensor sensor;
+    double cry_gain, cry_offset; // this session's calibration error
+    int last_bpm, last_cry;      // what the decision node holds when a reading drops out
+    int poll_ms;                 // vitals poll period, 0 = read at the step
+
+    // stress history ring
+    int hist_mode;   // HIST_DENSE or HIST_CHANGEPOINT
+    double *hist_t;  // timestamps (seconds since start)
+    double *hist_s;  // recorded S values
+    double *hist_g;  // change-point history: where S was relaxing to from that point on (== hist_s if it held still)
+    int hist_cap;    // ring capacity (max samples kept)
+    int hist_head;   // physical index of the oldest sample
+    int hist_n;      // number of samples stored
+
+    // per-world PRNG, so a seed fully determines a run
+    uint64_t rng;
+
+    // log to stdout?
+    int verbose;
+    TraceBuf *trace; // binary event trace of this session, NULL = off
+
+    // session counters (what a batch run reports)
+    int moves;     // valid move_to_cell() requests
+    int panics;    // go_panic() calls
+    double calm_t; // time A1F1/K1 was reached, -1 if not (yet)
+    uint32_t visited; // bit a*5+f set once cell (a,f) was entered; the run only ever reads K there
+    double stress_area; // integral of S over the session (stress x seconds)
+
+    // the production controller (decision/controller.c). its hooks point back at this world,
+    // so a SimWorld must not be moved after sim_world_init()
+    controller_t ctrl;
+    controller_mpc_t *mpc; // its MPC belief, allocated by sim_world_apply() when SimParams.mpc asks for it
+} SimWorld;
+
+// knobs a session is run with (everything a batch sweep may want to vary)
+typedef struct
+{
+    int thresholdBPM;
+    int thresholdCRY;
+    controller_consts_t consts; // the controller's constants (controller_consts_default() = the shipped #defines)
+    double TAU;
+    double convergence_time;
+    int hist_mode;
+    int hist_len; // history ring length (samples)
+    int stress_model;  // STRESS_INSTANT or STRESS_EXP
+    double stress_tau; // STRESS_EXP time constant, seconds (> 0)
+    SimSensor sensor;  // all zero = ideal
+    int poll_ms;       // decision node's VITALS_POLL_MS, 0 = vitals read at the step itself (see run_controller)
+    const controller_policy_t *policy; // NULL = the hand-written controller_step() rules
+    int mpc;                           // 1 = the MPC planner (decision/controller.h), ahead of policy and rules
+    TraceSink *trace;                  // append every session's events here, NULL = no trace
+} SimParams;
+
+// outcome of one session
+typedef struct
+{
+    int calm;      // 1 if A1F1/K1 was reached
+    double calm_t; // time-to-calm in simulated seconds (only meaningful if calm)
+    int moves;
+    int panics;
+    int finalK;
+    double end_t; // simulated time when the session stopped
+    uint32_t visited; // cells the session entered (bit a*5+f)
+    double stress_area; // integral of S dt until end_t
+    int ctrl_panic;   // the controller went into panic mode (and froze at A1F1)
+    int thr_lo, thr_hi; // any thresholdBPM in [thr_lo, thr_hi] gives this exact result
+} SimResult;
+
+// everything generate_matrix() draws, as raw draws. scenario_build() turns it into Sopt/bands/K.
+typedef struct
+{
+    uint8_t sopt1;   // Sopt[1], 10..15
+    uint8_t step[8]; // Sopt[k] - Sopt[k-1] for k = 2..9 before capping, 7..11
+    uint8_t half[9]; // band half-width for k = 1..9, 6..12
+    uint8_t path;    // bit i = 1 if step i of the K9 -> K1 walk goes UP, else LEFT (always four of each)
+} SimScenario;
+
+// world lifetime
+int sim_world_init(SimWorld *w, uint64_t seed);
+void sim_world_free(SimWorld *w);
+
+// sessions
+void sim_params_default(SimParams *p);
+int sim_world_apply(SimWorld *w, const SimParams *p);
+int sim_run_session(const SimParams *p, uint64_t seed, int verbose, SimResult *out);
+int sim_run_scenario(const SimParams *p, const SimScenario *sc, uint64_t seed, int verbose, SimResult *out);
+void sim_session_start(SimWorld *w, const SimScenario *sc);
+
+// batch (batch.c): n sessions spread over all cores, seeds seed..seed+n-1
+int sim_batch(const SimParams *p, int n, int threads, uint64_t seed, SimResult *out);
+void sim_batch_report(const SimResult *res, int n);
+double sim_percentile(double *v, int n, double q); // nearest rank, sorts v in place
+
+// lockstep (lockstep.c): same as sim_batch(), blocks of worlds in struct-of-arrays form advanced together.
+// always change-point history (results equal sim_batch() with HIST_CHANGEPOINT), p->trace is ignored.
+// a sensor model other than the ideal one is handed to sim_batch()
+int sim_lockstep_batch(const SimParams *p, int n, int threads, uint64_t seed, SimResult *out);
+
+// ring (ring.c): this plant as nodes 1, 2 and 3 of the UART ring on a pseudo-terminal, so the real
+// decision/main.c (built against sim/host/libpynq) runs closed loop on it. link names the pty (a symlink),
+// speed is the clock factor (the same LIBPYNQ_SPEED the decision program runs with), max_t the plant seconds
+// to serve for. returns 0 once the session ends (calm, max_t or Ctrl+C)
+int sim_ring_serve(const SimParams *p, const SimScenario *sc, uint64_t seed, const char *link, double speed,
+                   double max_t);
+
+// waveforms (wave.c): the raw ADC0 signals of the sensor nodes, in volts. one SimWave per signal
+typedef struct
+{
+    double phase;  // PPG: beats since start
+    double t_last; // PPG: time of the previous sample, seconds
+    uint64_t rng;
+    double noise;  // extra sample noise sd, volts
+} SimWave;
+void wave_init(SimWave *g, uint64_t seed, double noise);
+double wave_ppg(SimWave *g, double t, double bpm); // photodiode at heart rate bpm
+double wave_mic(SimWave *g, double t, double cry); // microphone at cry level 0..100
+
+// corpus (corpus.c): every path shape x a grid of band configurations, results cached on disk
+int sim_corpus(const SimParams *p, const char *cache_path);
+uint64_t sim_params_fingerprint(const SimParams *p); // every knob except thresholdBPM
+
+// PRNG
+void sim_seed(SimWorld *w, uint64_t seed);
+uint32_t sim_rand(SimWorld *w);
+
+// history + clock
+int hist_init(SimWorld *w, int cap);
+void record_stress_sample(SimWorld *w, double t_sec, double S_val);
+void advance_time(SimWorld *w, double dt);
+void advance_epsilon(SimWorld *w);
+double now_sec(const SimWorld *w);
+double stress_delayed(const SimWorld *w, double now_sec_val, double tau_sec);
+
+// plant
+void scenario_sample(SimWorld *w, SimScenario *sc);
+void scenario_build(SimWorld *w, const SimScenario *sc);
+void generate_matrix(SimWorld *w);
+// a scenario as one line of text and back ("s1=12 step=7,8,9,10,11,7,8,9 half=6,...,12 path=LULULULU"), so a
+// scenario found by a search can be rerun with sim --scenario. parse returns 0 if it is valid under
+// scenario_sample()'s rules
+#define SIM_SCENARIO_STR 96
+void sim_scenario_format(const SimScenario *sc, char *buf, int len);
+int sim_scenario_parse(const char *str, SimScenario *sc);
+// the ranges scenario_sample() draws from
+#define SC_SOPT1_MIN 10
+#define SC_SOPT1_MAX 15
+#define SC_STEP_MIN 7
+#define SC_STEP_MAX 11
+#define SC_HALF_MIN 6
+#define SC_HALF_MAX 12
+void set_initial_state(SimWorld *w, int aIndex, int fIndex, int kLabel, double Sstart);
+void command_motor(SimWorld *w, int aIndex, int fIndex);
+void move_to_cell(SimWorld *w, int newA, int newF);
+// outcome of a move, see sim_move_kind()
+#define MOVE_INSIDE 0      // S already inside the new band: converge to its Sopt
+#define MOVE_PANIC_JUMP 1  // bands apart, softer move: panic
+#define MOVE_PANIC_BLOCK 2 // bands apart, harder move: panic
+#define MOVE_MIXED 3       // bands apart, mixed move: clamp S into the new band, then converge
+#define MOVE_OVERLAP 4     // bands overlap: clamp S into the new band, then converge
+int sim_move_kind(int oldA, int oldF, int newA, int newF, double S, double oldLo, double oldHi, double newLo,
+                  double newHi);
+void converge_now(SimWorld *w);
+void go_panic(SimWorld *w, const char *tag);
+double get_crying(const SimWorld *w);
+double get_heartbeat(SimWorld *w, double stress_delayed_val);
+double sim_bpm_of(const SimWorld *w, double S); // the two vitals mappings, through w->sensor
+double sim_cry_of(const SimWorld *w, double S);
+void sense_vitals(SimWorld *w, double S_tau, int *bpm, int *cry);
+int sim_sense_bpm(SimWorld *w, double S_tau); // one reading of each node, no dropout
+int sim_sense_cry(SimWorld *w);
+
+// sensor model knobs (SimSensor)
+void sim_sensor_real(SimSensor *s);
+int sim_sensor_ideal(const SimSensor *s);
+const char *sim_sensor_check(const SimSensor *s); // what is wrong with it, NULL if it is usable
+void sim_sensor_describe(const SimSensor *s, char *buf, int len);
+// the tools' shared sensor options: --sensor ideal|real, --bpm-beats N, --bpm-jitter MS, --bpm-step N,
+// --cry-gain F, --cry-offset P, --cry-noise P, --cry-lag S, --cry-step N, --dropout P, --bpm-map B0,B1,
+// --cry-map C0,C1.
+// returns 1 and moves *i past the value if argv[*i] is one of them
+int sim_sensor_option(SimSensor *s, int argc, char **argv, int *i);
+int in_range(const SimWorld *w, int k, double v);
+void print_status(const SimWorld *w, const char *tag);
+
+// motor helpers
+int to_region(int percent);
+int region_mid_duty(int r);
+void set_pwm_percent(int channel, int percent);
+double lerp(double x0, double y0, double x1, double y1, double x);
+
+// controller loop on the virtual clock
+void run_controller(SimWorld *w);
+
+#endif
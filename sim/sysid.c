@@ -0,0 +1,648 @@
+// sysid.c — fit the simulator's plant parameters from recorded sessions
+// Input: the session logs decision/main.c writes with RECORD_SESSION 1, one line per event:
+//   S t            session start (the controller starts at A5 F5)
+//   V t bpm cry    one vitals poll, -1 = that node did not reply
+//   M t a f        cell command, indices 0..4
+// (t in ms). Or --simulate N: the same records from N sim sessions polled every --poll-ms, to check that the
+// fit gets back what the sim was run with (sensor options apply, e.g. --sensor real or --cry-map -20,2.2).
+//
+// What is fitted:
+//   TAU          least squares over a grid of lags: BPM(t) against CRY(t - TAU) wherever the crying node is
+//                off its rails. Both are linear in S there, so the right lag leaves the smallest residual. This is
+//                the lag the controller sees: the plant's plus the heartbeat node's beat averaging, good to a poll.
+//   mappings     the same regression gives BPM = a + b CRY. S itself is never observed, so only that relation
+//                is identifiable, not both mappings: S has to be pinned by one of them. The report gives the
+//                crying mapping with the heartbeat one held at 60 + 1.8 S, and the other way round.
+//   convergence  after a move, the first level change of the BPM trace TAU later (the band clamp shows at
+//                once, Sopt after the convergence time)
+//   Sopt, bands  the settled level before the next move is Sopt of the cell. K labels are hidden, so the
+//                report gives ranges: the start level (K9), the level at A1 F1 (K1), the mean step between them,
+//                and band half-widths from moves to a harder cell (clamped to Sopt - half of the new cell)
+//
+// usage: sysid FILE... | --simulate N [--seed N] [--rules] [--poll-ms N] [--tail S] [sim plant options]
+//        [--max-tau S] [--tol BPM]
+// build: gcc -O2 -pthread -o sysid sysid.c sim.c batch.c corpus.c trace.c lockstep.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+
+#define TAU_STEP 0.05   // lag grid, seconds
+#define CRY_RAIL 2      // CRY within this of a rail counts as clipped (plus 4 sd of its noise)
+#define SETTLE_PAD 0.3  // seconds kept clear of a level change on either side
+#define MIN_WINDOW 5    // readings needed for a level
+#define LINE_MAX_LEN 128
+
+typedef struct
+{
+    double t; // seconds since the session start
+    int bpm, cry;
+} Poll;
+
+typedef struct
+{
+    double t;
+    int a, f;
+} Cmd;
+
+typedef struct
+{
+    Poll *v;
+    int nv, capv;
+    Cmd *m; // cell changes only (a repeated command of the same cell is not a move)
+    int nm, capm;
+    int a, f; // cell the cradle is in while recording
+    double cry_lo, cry_hi; // where this session's CRY rails sit (calibration moves them off 0 and 100)
+} Rec;
+
+static Rec *g_rec;
+static int g_nrec, g_caprec;
+
+static Rec *rec_new(void)
+{
+    if (g_nrec == g_caprec)
+    {
+        int cap = g_caprec ? 2 * g_caprec : 16;
+        Rec *r = realloc(g_rec, (size_t)cap * sizeof *r);
+        if (!r)
+            return NULL;
+        g_rec = r;
+        g_caprec = cap;
+    }
+    Rec *r = &g_rec[g_nrec++];
+    memset(r, 0, sizeof *r);
+    r->a = r->f = 4;
+    return r;
+}
+
+static int rec_poll(Rec *r, double t, int bpm, int cry)
+{
+    if (r->nv == r->capv)
+    {
+        int cap = r->capv ? 2 * r->capv : 1024;
+        Poll *v = realloc(r->v, (size_t)cap * sizeof *v);
+        if (!v)
+            return -1;
+        r->v = v;
+        r->capv = cap;
+    }
+    r->v[r->nv++] = (Poll){t, bpm, cry};
+    return 0;
+}
+
+static int rec_cmd(Rec *r, double t, int a, int f)
+{
+    if (a == r->a && f == r->f)
+        return 0;
+    if (r->nm == r->capm)
+    {
+        int cap = r->capm ? 2 * r->capm : 64;
+        Cmd *m = realloc(r->m, (size_t)cap * sizeof *m);
+        if (!m)
+            return -1;
+        r->m = m;
+        r->capm = cap;
+    }
+    r->m[r->nm++] = (Cmd){t, a, f};
+    r->a = a;
+    r->f = f;
+    return 0;
+}
+
+// LOADING
+
+static int load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        printf("[SYSTEM][ERROR] could not open %s\n", path);
+        return -1;
+    }
+    char line[LINE_MAX_LEN];
+    Rec *r = NULL;
+    double t0 = 0.0;
+    int lineno = 0;
+    while (fgets(line, sizeof line, f))
+    {
+        lineno++;
+        char kind;
+        double t;
+        int x = 0, y = 0;
+        int n = sscanf(line, " %c %lf %d %d", &kind, &t, &x, &y);
+        if (n < 2)
+            continue; // blank
+        if (kind == 'S' || !r)
+        {
+            r = rec_new();
+            if (!r)
+                break;
+            t0 = t;
+            if (kind == 'S')
+                continue;
+        }
+        if ((kind == 'V' || kind == 'M') && n == 4)
+        {
+            if (kind == 'V' ? rec_poll(r, (t - t0) / 1000.0, x, y) : rec_cmd(r, (t - t0) / 1000.0, x, y))
+                break;
+        }
+        else
+            printf("%s:%d: skipped \"%.*s\"\n", path, lineno, (int)strcspn(line, "\n"), line);
+    }
+    fclose(f);
+    return 0;
+}
+
+// SIMULATED RECORDINGS
+// the decision loop of decision/main.c on the sim's virtual clock: poll every poll_ms, step when the step
+// period is up, a bit of tail after the session is over so the last cell settles in the trace
+
+typedef struct
+{
+    SimWorld *w;
+    Rec *r;
+} SimRec;
+
+static void simrec_command_cell(void *ctx, int aIndex, int fIndex)
+{
+    SimRec *s = ctx;
+    int panics = s->w->panics;
+    command_motor(s->w, aIndex, fIndex);
+    if (s->w->panics != panics)
+        advance_epsilon(s->w);
+    rec_cmd(s->r, now_sec(s->w), aIndex, fIndex);
+}
+
+static double simrec_now_ms(void *ctx)
+{
+    SimRec *s = ctx;
+    return now_sec(s->w) * 1000.0;
+}
+
+static int simulate(const SimParams *p, int n, uint64_t seed, int poll_ms, double tail)
+{
+    for (int i = 0; i < n; i++)
+    {
+        SimWorld w;
+        if (sim_world_init(&w, seed + (uint64_t)i) != 0 || sim_world_apply(&w, p) != 0)
+        {
+            sim_world_free(&w);
+            return -1;
+        }
+        w.verbose = 0;
+        Rec *r = rec_new();
+        if (!r)
+            return -1;
+        SimRec sr = {&w, r};
+        controller_hooks_t hooks = {simrec_command_cell, NULL, simrec_now_ms, &sr};
+        w.ctrl.hooks = hooks;
+
+        sim_session_start(&w, NULL);
+        controller_t *c = &w.ctrl;
+        controller_start(c);
+
+        double next_step = 0.0, stop = -1.0;
+        int bpm = 0, cry = 0;
+        for (int steps = 0; stop < 0.0 || now_sec(&w) < stop;)
+        {
+            double t = now_sec(&w);
+            sense_vitals(&w, stress_delayed(&w, t, w.TAU), &bpm, &cry);
+            rec_poll(r, t, bpm, cry);
+            if (stop < 0.0 && t >= next_step - 1e-9)
+            {
+                controller_step(c, bpm, cry);
+                next_step = t + controller_step_period_ms(c) / 1000.0;
+                if (c->calm_reached || c->panic_mode || ++steps >= SIM_MAX_STEPS)
+                    stop = t + tail;
+            }
+            advance_time(&w, poll_ms / 1000.0);
+        }
+        sim_world_free(&w);
+    }
+    return 0;
+}
+
+// FITTING
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, int n)
+{
+    return n > 0 ? sim_percentile(v, n, 0.5) : NAN;
+}
+
+// first poll at or after t
+static int poll_at(const Rec *r, double t)
+{
+    int lo = 0, hi = r->nv;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (r->v[mid].t < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// valid BPM readings in [t0, t1) into buf, returns how many
+static int bpm_window(const Rec *r, double t0, double t1, double *buf, int cap)
+{
+    int n = 0;
+    for (int i = poll_at(r, t0); i < r->nv && r->v[i].t < t1 && n < cap; i++)
+        if (r->v[i].bpm > 0)
+            buf[n++] = r->v[i].bpm;
+    return n;
+}
+
+typedef struct
+{
+    double tau;
+    double a, b;   // BPM = a + b CRY
+    double rms;    // residual, BPM
+    long pairs;
+} LagFit;
+
+// each session's rails: the 1st and 99th percentile of its CRY, pulled in by the 2.33 sd the noise puts them
+// off a railed reading's centre. a session that never reaches a rail loses its extreme readings, which costs little
+static void find_rails(double noise)
+{
+    for (int s = 0; s < g_nrec; s++)
+    {
+        Rec *r = &g_rec[s];
+        double *c = malloc((size_t)(r->nv > 0 ? r->nv : 1) * sizeof *c);
+        int k = 0;
+        for (int i = 0; c && i < r->nv; i++)
+            if (r->v[i].cry >= 0)
+                c[k++] = r->v[i].cry;
+        r->cry_lo = k ? sim_percentile(c, k, 0.01) + 2.33 * noise : 0.0;
+        r->cry_hi = k ? sim_percentile(c, k, 0.99) - 2.33 * noise : 100.0;
+        free(c);
+    }
+}
+
+// BPM = a + b CRY(t - tau) over every session, least squares. CRY within rail of the session's rails is left out
+static void fit_lag(double tau, double rail, LagFit *out)
+{
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, syy = 0;
+    for (int s = 0; s < g_nrec; s++)
+    {
+        const Rec *r = &g_rec[s];
+        int j = -1, cry = -1; // newest valid cry at or before t - tau
+        for (int i = 0; i < r->nv; i++)
+        {
+            double tq = r->v[i].t - tau;
+            while (j + 1 < r->nv && r->v[j + 1].t <= tq + 1e-9)
+            {
+                j++;
+                if (r->v[j].cry >= 0)
+                    cry = r->v[j].cry;
+            }
+            if (j < 0 || cry <= r->cry_lo + rail || cry >= r->cry_hi - rail || r->v[i].bpm <= 0)
+                continue;
+            double x = cry, y = r->v[i].bpm;
+            n++;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+            syy += y * y;
+        }
+    }
+    out->tau = tau;
+    out->pairs = (long)n;
+    double vx = sxx - sx * sx / (n > 0 ? n : 1), cxy = sxy - sx * sy / (n > 0 ? n : 1);
+    if (n < 10 || vx <= 0.0)
+    {
+        out->a = out->b = 0.0;
+        out->rms = INFINITY;
+        return;
+    }
+    out->b = cxy / vx;
+    out->a = (sy - out->b * sx) / n;
+    double sse = syy - sy * sy / n - cxy * cxy / vx;
+    out->rms = sqrt((sse > 0.0 ? sse : 0.0) / n);
+}
+
+// noise of a trace (0 = BPM, 1 = CRY): robust sd of the difference of neighbouring polls (most of them see
+// the same S)
+static double trace_noise(int cry)
+{
+    long n = 0;
+    for (int s = 0; s < g_nrec; s++)
+        n += g_rec[s].nv;
+    double *d = malloc((size_t)(n > 0 ? n : 1) * sizeof *d);
+    if (!d)
+        return 1.0;
+    int k = 0;
+    for (int s = 0; s < g_nrec; s++)
+        for (int i = 1; i < g_rec[s].nv; i++)
+        {
+            int x = cry ? g_rec[s].v[i].cry : g_rec[s].v[i].bpm;
+            int y = cry ? g_rec[s].v[i - 1].cry : g_rec[s].v[i - 1].bpm;
+            if (x >= 0 && y >= 0 && (cry || (x > 0 && y > 0)))
+                d[k++] = fabs((double)x - y);
+        }
+    double mad = median(d, k);
+    free(d);
+    return (k > 0 ? mad : 0.0) * 1.4826 / sqrt(2.0);
+}
+
+typedef struct
+{
+    double *v;
+    int n, cap;
+} Samples;
+
+static void add(Samples *s, double x)
+{
+    if (s->n == s->cap)
+    {
+        int cap = s->cap ? 2 * s->cap : 64;
+        double *v = realloc(s->v, (size_t)cap * sizeof *v);
+        if (!v)
+            return;
+        s->v = v;
+        s->cap = cap;
+    }
+    s->v[s->n++] = x;
+}
+
+static void print_range(const char *name, Samples *s, const char *unit)
+{
+    if (s->n == 0)
+    {
+        printf("%-14s n/a\n", name);
+        return;
+    }
+    qsort(s->v, (size_t)s->n, sizeof *s->v, cmp_double);
+    printf("%-14s median %6.2f %s  (p5 %.2f .. p95 %.2f, min %.2f max %.2f, n=%d)\n", name,
+           s->v[s->n / 2], unit, s->v[(int)(0.05 * (s->n - 1) + 0.5)], s->v[(int)(0.95 * (s->n - 1) + 0.5)],
+           s->v[0], s->v[s->n - 1], s->n);
+}
+
+int main(int argc, char **argv)
+{
+    SimParams p;
+    sim_params_default(&p);
+    p.policy = &policy_table;
+    int n_sim = 0, poll_ms = 100;
+    uint64_t seed = 1;
+    double max_tau = 20.0, tol = 0.0, tail = 30.0;
+    const char *files[64];
+    int nfiles = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (sim_sensor_option(&p.sensor, argc, argv, &i))
+            continue;
+        if (strcmp(a, "--simulate") == 0 && v)
+            n_sim = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--rules") == 0)
+            p.policy = NULL;
+        else if (strcmp(a, "--poll-ms") == 0 && v)
+            poll_ms = atoi(argv[++i]);
+        else if (strcmp(a, "--tail") == 0 && v)
+            tail = atof(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--max-tau") == 0 && v)
+            max_tau = atof(argv[++i]);
+        else if (strcmp(a, "--tol") == 0 && v)
+            tol = atof(argv[++i]);
+        else if (a[0] != '-' && nfiles < 64)
+            files[nfiles++] = a;
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    const char *bad = sim_sensor_check(&p.sensor);
+    if (bad)
+    {
+        printf("%s\n", bad);
+        return 1;
+    }
+    if (poll_ms <= 0 || max_tau <= 0.0)
+        return 1;
+
+    p.hist_mode = HIST_CHANGEPOINT; // polls are 100 ms apart, a dense ring would not reach TAU back
+    if (n_sim > 0 && simulate(&p, n_sim, seed, poll_ms, tail) != 0)
+        return 1;
+    for (int i = 0; i < nfiles; i++)
+        if (load(files[i]) != 0)
+            return 1;
+    long polls = 0, moves = 0;
+    for (int s = 0; s < g_nrec; s++)
+    {
+        polls += g_rec[s].nv;
+        moves += g_rec[s].nm;
+    }
+    if (g_nrec == 0 || polls == 0)
+    {
+        printf("no recorded sessions (give log files or --simulate N)\n");
+        return 1;
+    }
+    printf("sysid: %d sessions, %ld polls, %ld moves\n", g_nrec, polls, moves);
+
+    // TAU and BPM against CRY. noise pulls a railed CRY off 0/100, keep clear of that as well
+    double cry_noise = trace_noise(1), rail = CRY_RAIL + 4.0 * cry_noise;
+    find_rails(cry_noise);
+    // polls quantise the lag, so the residual has a flat bottom about one poll wide: take its middle
+    int n_lag = (int)(max_tau / TAU_STEP) + 1;
+    LagFit *lag = malloc((size_t)n_lag * sizeof *lag);
+    if (!lag)
+        return 1;
+    LagFit best = {.rms = INFINITY};
+    for (int i = 0; i < n_lag; i++)
+    {
+        fit_lag(i * TAU_STEP, rail, &lag[i]);
+        if (lag[i].rms < best.rms)
+            best = lag[i];
+    }
+    int lo = -1, hi = -1;
+    for (int i = 0; i < n_lag; i++)
+        if (lag[i].rms <= best.rms * 1.01 + 1e-6)
+        {
+            if (lo < 0)
+                lo = i;
+            hi = i;
+        }
+    if (lo >= 0)
+        best = lag[(lo + hi) / 2];
+    free(lag);
+    if (!isfinite(best.rms) || best.b <= 0.0)
+    {
+        printf("not enough readings with the crying node off its rails to fit TAU\n");
+        return 1;
+    }
+    double tau = best.tau, dt = 0.0;
+    for (int s = 0; s < g_nrec; s++)
+        if (g_rec[s].nv > 1)
+            dt = fmax(dt, (g_rec[s].v[g_rec[s].nv - 1].t - g_rec[s].v[0].t) / (g_rec[s].nv - 1));
+    printf("TAU            %.2f s +-%.2f  (BPM = %.2f + %.4f CRY(t - TAU), rms %.2f BPM over %ld polls)\n", tau, dt,
+           best.a, best.b, best.rms, best.pairs);
+    // S pinned by the heartbeat mapping: CRY = (BPM - a) / b = (60 + 1.8 S - a) / b
+    double c1 = 1.8 / best.b, c0 = (60.0 - best.a) / best.b;
+    // S pinned by the crying mapping: BPM = a + b (2.5 S - 25)
+    double h1 = 2.5 * best.b, h0 = best.a - 25.0 * best.b;
+    printf("mappings       BPM = 60 + 1.8 S held:  cry = %.2f S %+.2f   (sim: 2.5 S - 25)\n", c1, c0);
+    printf("               cry = 2.5 S - 25 held:  BPM = %.2f %+.3f S  (sim: 60 + 1.8 S)\n", h0, h1);
+
+    // levels from here on are in S of the heartbeat gauge
+    double noise = trace_noise(0);
+    if (tol <= 0.0)
+        tol = fmax(2.0, 4.0 * noise);
+    printf("BPM noise      %.2f BPM per poll, level change above %.1f BPM\n", noise, tol);
+    if (best.rms > 2.0 + 3.0 * noise)
+        printf("               the residual is well above the noise: few moves cross the crying node's range, or the\n"
+               "               calibration drifts between sessions. take TAU and the mappings with salt\n");
+
+    // two passes: the convergence time first, then only moves made after the previous one settled are told
+    // apart (a convergence landing right on the next move looks just like a clamp or a panic)
+    Samples conv = {0}, sopt9 = {0}, sopt1 = {0}, mstep = {0}, half = {0}, upper = {0};
+    int panics = 0, clamps = 0, unclear = 0;
+    double conv_s = p.convergence_time;
+    double *buf = malloc((size_t)polls * sizeof *buf);
+    if (!buf)
+        return 1;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int s = 0; s < g_nrec; s++)
+        {
+            const Rec *r = &g_rec[s];
+            double first = r->nm ? r->m[0].t : (r->nv ? r->v[r->nv - 1].t : 0.0);
+            int k = bpm_window(r, SETTLE_PAD, fmin(tau, first + tau) - SETTLE_PAD, buf, (int)polls);
+            double start = k >= MIN_WINDOW ? (median(buf, k) - 60.0) / 1.8 : NAN;
+            if (pass == 1 && !isnan(start))
+                add(&sopt9, start);
+            double s_calm = NAN;
+
+            for (int m = 0; m < r->nm; m++)
+            {
+                double te = r->m[m].t + tau; // the move shows in the BPM trace from here
+                double tn = (m + 1 < r->nm ? r->m[m + 1].t : r->v[r->nv - 1].t) + tau;
+                int i0 = poll_at(r, te + SETTLE_PAD);
+
+                // the levels right before and right after, and the first reading that leaves the latter for good
+                // (three in a row)
+                k = bpm_window(r, te - SETTLE_PAD - 0.5, te - SETTLE_PAD, buf, (int)polls);
+                double s_pre = k >= 3 ? (median(buf, k) - 60.0) / 1.8 : NAN;
+                k = bpm_window(r, te + SETTLE_PAD, te + SETTLE_PAD + 0.5, buf, (int)polls);
+                if (k < 3)
+                    continue;
+                double post = median(buf, k);
+                double t_change = -1.0;
+                for (int i = i0; i + 2 < r->nv && r->v[i + 2].t < tn; i++)
+                {
+                    int off = 1;
+                    for (int j = i; j < i + 3 && off; j++)
+                        off = r->v[j].bpm > 0 && fabs(r->v[j].bpm - post) > tol;
+                    if (off)
+                    {
+                        t_change = r->v[i].t;
+                        break;
+                    }
+                }
+
+                if (pass == 0)
+                {
+                    if (t_change >= 0.0)
+                        add(&conv, t_change - te);
+                    continue;
+                }
+                if (m > 0 && r->m[m].t - r->m[m - 1].t < conv_s + 2 * SETTLE_PAD)
+                {
+                    unclear++;
+                    s_pre = NAN; // still converging from the last move
+                }
+
+                double s_post = (post - 60.0) / 1.8;
+                int pa = m ? r->m[m - 1].a : 4, pf = m ? r->m[m - 1].f : 4;
+                int softer = r->m[m].a <= pa && r->m[m].f <= pf;
+                int harder = r->m[m].a >= pa && r->m[m].f >= pf;
+                if (softer && !isnan(s_pre) && s_post > s_pre + tol / 1.8)
+                {
+                    // softer cell, more stress: a panic, S jumped to Sopt of K9 and stays there
+                    panics++;
+                    add(&sopt9, s_post);
+                    continue;
+                }
+                if (t_change < 0.0)
+                    continue; // moved inside the band onto the same Sopt, or the next move came first
+
+                k = bpm_window(r, t_change + SETTLE_PAD, tn - SETTLE_PAD, buf, (int)polls);
+                if (k < MIN_WINDOW)
+                    continue;
+                double settled = (median(buf, k) - 60.0) / 1.8;
+                if (!isnan(s_pre) && fabs(s_post - s_pre) > tol / 1.8)
+                {
+                    // clamped into the new band on the way in: the edge it landed on is visible
+                    clamps++;
+                    if (harder && s_post < settled)
+                        add(&half, settled - s_post);
+                    else if (!harder && s_post > settled)
+                        add(&upper, s_post - settled);
+                }
+                if (r->m[m].a == 0 && r->m[m].f == 0)
+                    s_calm = settled;
+            }
+            if (!isnan(s_calm))
+            {
+                add(&sopt1, s_calm);
+                if (!isnan(start))
+                    add(&mstep, (start - s_calm) / 8.0);
+            }
+        }
+        if (pass == 0 && conv.n)
+        {
+            qsort(conv.v, (size_t)conv.n, sizeof *conv.v, cmp_double);
+            conv_s = conv.v[conv.n / 2];
+        }
+    }
+    free(buf);
+
+    print_range("convergence", &conv, "s");
+    print_range("Sopt K9", &sopt9, "S");
+    print_range("Sopt K1", &sopt1, "S");
+    print_range("mean step", &mstep, "S");
+    print_range("band half", &half, "S");
+    print_range("upper edge", &upper, "S");
+    printf("%-14s %d moves clamped into the new band, %d panics, %d moves too close to the last one to tell\n", "",
+           clamps, panics, unclear);
+    printf("sim draws      Sopt K1 %d..%d, steps %d..%d (K9 capped at 98), band half %d..%d\n", SC_SOPT1_MIN,
+           SC_SOPT1_MAX, SC_STEP_MIN, SC_STEP_MAX, SC_HALF_MIN, SC_HALF_MAX);
+
+    printf("\na probe's settled BPM shows %.1f s after the move (TAU + convergence)\n", tau + conv_s);
+    printf("sim options:   --tau %.2f --convergence %.2f --cry-map %.2f,%.3f\n", tau, conv_s, c0, c1);
+
+    for (int s = 0; s < g_nrec; s++)
+    {
+        free(g_rec[s].v);
+        free(g_rec[s].m);
+    }
+    free(g_rec);
+    free(conv.v);
+    free(sopt9.v);
+    free(sopt1.v);
+    free(mstep.v);
+    free(half.v);
+    free(upper.v);
+    return 0;
+}
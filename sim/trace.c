@@ -0,0 +1,162 @@
+// trace.c — binary event trace, see trace.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+struct TraceSink
+{
+    FILE *f;
+    pthread_mutex_t lock;
+};
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t get_u32(const uint8_t *p) { return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16); }
+
+TraceSink *trace_open(const char *path)
+{
+    TraceSink *s = calloc(1, sizeof *s);
+    if (!s)
+        return NULL;
+    s->f = fopen(path, "ab");
+    if (!s->f)
+    {
+        free(s);
+        return NULL;
+    }
+    fseek(s->f, 0, SEEK_END);
+    if (ftell(s->f) == 0)
+    {
+        uint8_t hdr[TRACE_HDR_SIZE];
+        memcpy(hdr, TRACE_MAGIC, 4);
+        put_u16(hdr + 4, TRACE_VERSION);
+        put_u16(hdr + 6, TRACE_REC_SIZE);
+        fwrite(hdr, 1, sizeof hdr, s->f);
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    return s;
+}
+
+void trace_close(TraceSink *s)
+{
+    if (!s)
+        return;
+    fclose(s->f);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+int trace_write(TraceSink *s, const TraceBuf *b)
+{
+    int rc = 0;
+    uint8_t rec[TRACE_REC_SIZE];
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < b->n && rc == 0; i++)
+    {
+        const TraceEvent *e = &b->ev[i];
+        put_u32(rec, e->t_ms);
+        rec[4] = e->type;
+        rec[5] = e->a;
+        rec[6] = e->f;
+        rec[7] = e->k;
+        put_u32(rec + 8, e->val);
+        if (fwrite(rec, 1, sizeof rec, s->f) != sizeof rec)
+            rc = -1;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return rc;
+}
+
+void trace_buf_push(TraceBuf *b, TraceEvent ev)
+{
+    if (b->n == b->cap)
+    {
+        int cap = b->cap ? 2 * b->cap : 256;
+        TraceEvent *e = realloc(b->ev, (size_t)cap * sizeof *e);
+        if (!e)
+            return; // out of memory: drop the event rather than the session
+        b->ev = e;
+        b->cap = cap;
+    }
+    b->ev[b->n++] = ev;
+}
+
+void trace_buf_free(TraceBuf *b)
+{
+    free(b->ev);
+    b->ev = NULL;
+    b->n = b->cap = 0;
+}
+
+int trace_read(const char *path, TraceEvent **out, int *n)
+{
+    *out = NULL;
+    *n = 0;
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+
+    uint8_t hdr[TRACE_HDR_SIZE];
+    if (fread(hdr, 1, sizeof hdr, f) != sizeof hdr || memcmp(hdr, TRACE_MAGIC, 4) != 0 ||
+        get_u16(hdr + 4) != TRACE_VERSION || get_u16(hdr + 6) != TRACE_REC_SIZE)
+    {
+        fclose(f);
+        return -1;
+    }
+
+    TraceBuf b = {0};
+    uint8_t rec[TRACE_REC_SIZE];
+    while (fread(rec, 1, sizeof rec, f) == sizeof rec)
+    {
+        TraceEvent e;
+        e.t_ms = get_u32(rec);
+        e.type = rec[4];
+        e.a = rec[5];
+        e.f = rec[6];
+        e.k = rec[7];
+        e.val = get_u32(rec + 8);
+        trace_buf_push(&b, e);
+    }
+    fclose(f);
+    *out = b.ev;
+    *n = b.n;
+    return 0;
+}
+
+const char *trace_type_name(int type)
+{
+    switch (type)
+    {
+    case TR_SESSION:
+        return "SESSION";
+    case TR_SENSE:
+        return "SENSE";
+    case TR_DECISION:
+        return "DECISION";
+    case TR_MOVE:
+        return "MOVE";
+    case TR_CONVERGE:
+        return "CONVERGE";
+    case TR_PANIC:
+        return "PANIC";
+    case TR_END:
+        return "END";
+    case TR_ANCHOR:
+        return "ANCHOR";
+    default:
+        return "?";
+    }
+}
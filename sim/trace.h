@@ -0,0 +1,77 @@
+// trace.h — compact binary event trace of simulator sessions
+// Every session appends its events to one file: no text formatting on the hot path, and a batch run over all
+// cores writes a trace as fast as it simulates. Each world collects its events in memory (TraceBuf) and
+// hands the whole session to the sink at the end, so sessions never interleave in the file.
+//
+// file: "RYBT" | u16 version | u16 record size, then records until EOF (little endian)
+// record (12 bytes): u32 t_ms | u8 type | u8 a | u8 f | u8 k | u32 val
+//
+//   type         a, f, k                                  val
+//   TR_SESSION   thresholdBPM, -, controller (0 rules,   seed (low 32 bits)
+//                1 policy table, 2 MPC)
+//   TR_SENSE     cell, K the plant is in                  bpm | cry << 8 | S_tau x10 << 16
+//   TR_DECISION  controller cell after the step,          next step period in ms
+//                k = lastMoveDir | probe << 2 | panic << 4 | crying << 5 | hit_wall << 6
+//   TR_MOVE      target cell and its K                    from cell (a*5+f) | S at the request x10 << 8
+//   TR_CONVERGE  cell, K                                  S x10 (STRESS_EXP: emitted when S starts relaxing,
+//                                                         val = the Sopt it relaxes to)
+//   TR_PANIC     cell, K                                  S x10
+//   TR_END       final cell, K                            time-to-calm in ms, TRACE_NOT_CALM if it never calmed
+//   TR_ANCHOR    cell the controller registered as an     its anchorMatrix value
+//                anchor this step, k = anchorLevel
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "RYBT"
+#define TRACE_VERSION 1
+#define TRACE_HDR_SIZE 8
+#define TRACE_REC_SIZE 12
+#define TRACE_NOT_CALM 0xFFFFFFFFu
+
+enum
+{
+    TR_SESSION = 1,
+    TR_SENSE,
+    TR_DECISION,
+    TR_MOVE,
+    TR_CONVERGE,
+    TR_PANIC,
+    TR_END,
+    TR_ANCHOR,
+};
+
+typedef struct
+{
+    uint32_t t_ms;
+    uint8_t type;
+    uint8_t a, f, k;
+    uint32_t val;
+} TraceEvent;
+
+// events of one session, in memory
+typedef struct
+{
+    TraceEvent *ev;
+    int n, cap;
+} TraceBuf;
+
+typedef struct TraceSink TraceSink;
+
+// open for appending (the header is written if the file is new or empty). NULL on error
+TraceSink *trace_open(const char *path);
+void trace_close(TraceSink *s);
+// append a whole session, thread safe. 0 on success
+int trace_write(TraceSink *s, const TraceBuf *b);
+
+void trace_buf_push(TraceBuf *b, TraceEvent ev);
+void trace_buf_free(TraceBuf *b);
+
+// read every record of a trace file. 0 on success, *out must be freed
+int trace_read(const char *path, TraceEvent **out, int *n);
+
+const char *trace_type_name(int type);
+
+#endif
@@ -0,0 +1,535 @@
+// trace_tool.c — read the binary traces written by sim --trace
+//   dump FILE                 one text line per event
+//   summary FILE              per-session stats over the whole file (same numbers as the batch report)
+//   heatmap FILE              per-cell averages over all sessions: visits, controller steps, dwell time,
+//                             backtracks, wall hits, plant panics and anchors, as 5x5 grids (rows A1..A5,
+//                             columns F1..F5). shows which cells eat the HEARTBEAT_DELAY waits
+//   replay FILE [--session N | --seed S] [-v]
+//                             feed the recorded vitals back into decision/controller.c and check it commands
+//                             the same cells and makes the same decisions. exits 1 at the first divergence, so a
+//                             controller change that should be behaviour neutral can be checked against an old trace
+//
+// build: gcc -O2 -pthread -o trace_tool trace_tool.c trace.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "../decision/controller.h"
+#include "../decision/policy_table.h"
+
+#define WORST_N 5
+#define MAX_CMDS 16 // cells commanded by one controller_step (it is 1 or 2 in practice)
+
+// one session = the events from its TR_SESSION up to (not including) the next one
+typedef struct
+{
+    const TraceEvent *ev;
+    int n;
+} Session;
+
+static int split_sessions(const TraceEvent *ev, int n, Session **out)
+{
+    int count = 0;
+    for (int i = 0; i < n; i++)
+        count += ev[i].type == TR_SESSION;
+    Session *s = calloc((size_t)(count ? count : 1), sizeof *s);
+    if (!s)
+        return -1;
+    int k = -1;
+    for (int i = 0; i < n; i++)
+    {
+        if (ev[i].type == TR_SESSION)
+            s[++k].ev = &ev[i];
+        if (k >= 0)
+            s[k].n++;
+    }
+    *out = s;
+    return count;
+}
+
+static void print_event(const TraceEvent *e)
+{
+    printf("%10.3f %-9s ", e->t_ms / 1000.0, trace_type_name(e->type));
+    switch (e->type)
+    {
+    case TR_SESSION:
+        printf("seed=%u thresholdBPM=%d controller=%s\n", e->val, e->a, e->k == 2 ? "mpc" : e->k ? "policy" : "rules");
+        break;
+    case TR_SENSE:
+        printf("A%d F%d K%d  BPM=%u CRY=%u S_tau=%.1f\n", e->a + 1, e->f + 1, e->k, e->val & 0xFF,
+               (e->val >> 8) & 0xFF, (e->val >> 16) / 10.0);
+        break;
+    case TR_DECISION:
+        printf("A%d F%d  dir=%d probe=%d panic=%d crying=%d wall=%d  next=%u ms\n", e->a + 1, e->f + 1, e->k & 3,
+               (e->k >> 2) & 3, (e->k >> 4) & 1, (e->k >> 5) & 1, (e->k >> 6) & 1, e->val);
+        break;
+    case TR_MOVE:
+        printf("A%u F%u -> A%d F%d K%d  S=%.1f\n", (e->val & 0xFF) / 5 + 1, (e->val & 0xFF) % 5 + 1, e->a + 1,
+               e->f + 1, e->k, (e->val >> 8) / 10.0);
+        break;
+    case TR_CONVERGE:
+    case TR_PANIC:
+        printf("A%d F%d K%d  S=%.1f\n", e->a + 1, e->f + 1, e->k, e->val / 10.0);
+        break;
+    case TR_ANCHOR:
+        printf("A%d F%d  level %d  value %u\n", e->a + 1, e->f + 1, e->k, e->val);
+        break;
+    case TR_END:
+        if (e->val == TRACE_NOT_CALM)
+            printf("A%d F%d K%d  not calm\n", e->a + 1, e->f + 1, e->k);
+        else
+            printf("A%d F%d K%d  calm after %.3f s\n", e->a + 1, e->f + 1, e->k, e->val / 1000.0);
+        break;
+    default:
+        printf("a=%d f=%d k=%d val=%u\n", e->a, e->f, e->k, e->val);
+    }
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double *v, int n, double q)
+{
+    qsort(v, (size_t)n, sizeof *v, cmp_double);
+    int i = (int)(q * (n - 1) + 0.5);
+    return v[i];
+}
+
+typedef struct
+{
+    uint32_t seed;
+    double ttc; // < 0 = never calmed
+    int moves;
+} Worst;
+
+// longest (or never) calm first
+static int cmp_worst(const void *a, const void *b)
+{
+    const Worst *x = a, *y = b;
+    double tx = x->ttc < 0 ? 1e30 : x->ttc, ty = y->ttc < 0 ? 1e30 : y->ttc;
+    return (tx < ty) - (tx > ty);
+}
+
+static int summary(const Session *s, int ns)
+{
+    double *ttc = malloc((size_t)ns * sizeof *ttc);
+    Worst *worst = malloc((size_t)ns * sizeof *worst);
+    if (!ttc || !worst)
+    {
+        free(ttc);
+        free(worst);
+        return 1;
+    }
+
+    int calm = 0, panicked = 0, frozen = 0, truncated = 0;
+    long moves = 0;
+    double sum = 0.0;
+    for (int i = 0; i < ns; i++)
+    {
+        int m = 0, p = 0, ended = 0;
+        uint32_t end = TRACE_NOT_CALM;
+        uint8_t last_k = 0;
+        for (int j = 0; j < s[i].n; j++)
+        {
+            const TraceEvent *e = &s[i].ev[j];
+            m += e->type == TR_MOVE;
+            p += e->type == TR_PANIC;
+            if (e->type == TR_DECISION)
+                last_k = e->k;
+            if (e->type == TR_END)
+            {
+                ended = 1;
+                end = e->val;
+            }
+        }
+        truncated += !ended;
+        moves += m;
+        panicked += p > 0;
+        frozen += (last_k >> 4) & 1;
+        worst[i] = (Worst){s[i].ev[0].val, end == TRACE_NOT_CALM ? -1.0 : end / 1000.0, m};
+        if (end != TRACE_NOT_CALM)
+        {
+            ttc[calm++] = end / 1000.0;
+            sum += end / 1000.0;
+        }
+    }
+
+    printf("sessions %d", ns);
+    if (truncated)
+        printf(" (%d without an END record)", truncated);
+    printf("\ncalm %.1f%%", 100.0 * calm / ns);
+    if (calm)
+        printf("  time-to-calm median %.1f s  p95 %.1f s  mean %.1f s", percentile(ttc, calm, 0.50),
+               percentile(ttc, calm, 0.95), sum / calm);
+    printf("\nmoves mean %.1f  plant panic %.1f%%  controller panic %.1f%%\n", (double)moves / ns,
+           100.0 * panicked / ns, 100.0 * frozen / ns);
+
+    qsort(worst, (size_t)ns, sizeof *worst, cmp_worst);
+    printf("worst sessions:\n");
+    for (int i = 0; i < ns && i < WORST_N; i++)
+    {
+        if (worst[i].ttc < 0)
+            printf("  seed %u  not calm  %d moves\n", worst[i].seed, worst[i].moves);
+        else
+            printf("  seed %u  %.1f s  %d moves\n", worst[i].seed, worst[i].ttc, worst[i].moves);
+    }
+
+    free(ttc);
+    free(worst);
+    return 0;
+}
+
+// HEATMAP
+enum
+{
+    HM_VISITS,  // entered the cell (the start cell counts once)
+    HM_STEPS,   // controller steps that left the cradle on the cell
+    HM_DWELL,   // seconds spent on the cell waiting for the next step
+    HM_BACK,    // moves from the cell to a harder one (a failed probe going back)
+    HM_WALL,    // steps on the cell where the controller ran into the grid edge
+    HM_PANIC,   // plant panics on the cell
+    HM_ANCHOR,  // sessions that registered the cell as an anchor
+    HM_N
+};
+
+static const char *hm_title[HM_N] = {"visits", "steps", "dwell s", "backtracks", "wall hits", "panics",
+                                     "anchor %"};
+
+#define HM_PER_ROW 3
+#define HM_TOP 5
+
+// one row of up to HM_PER_ROW grids side by side
+static void print_grids(double (*g)[25], const int *which, int n)
+{
+    for (int i = 0; i < n; i++)
+        printf("  %-34s", hm_title[which[i]]);
+    printf("\n");
+    for (int i = 0; i < n; i++)
+        printf("      F1    F2    F3    F4    F5    ");
+    printf("\n");
+    for (int a = 0; a < 5; a++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            printf("A%d", a + 1);
+            for (int f = 0; f < 5; f++)
+            {
+                double v = g[which[i]][a * 5 + f];
+                if (v == 0.0)
+                    printf("     .");
+                else if (v < 10.0 && which[i] != HM_ANCHOR)
+                    printf(" %5.2f", v);
+                else
+                    printf(" %5.1f", v);
+            }
+            printf("    ");
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+static int heatmap(const Session *s, int ns)
+{
+    double g[HM_N][25] = {{0}};
+    int anchored = 0; // sessions with ANCHOR records (traces from before they existed have none)
+    double total = 0.0;
+
+    for (int i = 0; i < ns; i++)
+    {
+        const TraceEvent *ev = s[i].ev;
+        int started = 0, has_anchor = 0;
+        for (int j = 0; j < s[i].n; j++)
+        {
+            const TraceEvent *e = &ev[j];
+            int cell = e->a * 5 + e->f;
+            if (e->a > 4 || e->f > 4)
+                continue;
+            switch (e->type)
+            {
+            case TR_SENSE:
+                if (!started)
+                    g[HM_VISITS][cell] += 1.0;
+                started = 1;
+                break;
+            case TR_MOVE:
+            {
+                int from = (int)(e->val & 0xFF);
+                g[HM_VISITS][cell] += 1.0;
+                if (from < 25 && (e->a > from / 5 || e->f > from % 5))
+                    g[HM_BACK][from] += 1.0;
+                break;
+            }
+            case TR_DECISION:
+                g[HM_STEPS][cell] += 1.0;
+                if ((e->k >> 6) & 1)
+                    g[HM_WALL][cell] += 1.0;
+                // the wait after this step runs until the next SENSE (none after the last step: calm or frozen)
+                for (int k = j + 1; k < s[i].n && ev[k].type != TR_SESSION; k++)
+                    if (ev[k].type == TR_SENSE)
+                    {
+                        double dt = (ev[k].t_ms - e->t_ms) / 1000.0;
+                        g[HM_DWELL][cell] += dt;
+                        total += dt;
+                        break;
+                    }
+                break;
+            case TR_PANIC:
+                g[HM_PANIC][cell] += 1.0;
+                break;
+            case TR_ANCHOR:
+                g[HM_ANCHOR][cell] += 100.0;
+                has_anchor = 1;
+                break;
+            }
+        }
+        anchored += has_anchor;
+    }
+    for (int m = 0; m < HM_N; m++)
+        for (int c = 0; c < 25; c++)
+            g[m][c] /= ns;
+
+    printf("heatmap over %d sessions, per session (rows A1..A5, columns F1..F5)\n\n", ns);
+    static const int row1[] = {HM_VISITS, HM_STEPS, HM_DWELL};
+    static const int row2[] = {HM_BACK, HM_WALL, HM_PANIC};
+    static const int row3[] = {HM_ANCHOR};
+    print_grids(g, row1, HM_PER_ROW);
+    print_grids(g, row2, HM_PER_ROW);
+    if (anchored)
+        print_grids(g, row3, 1);
+    else
+        printf("no ANCHOR records (trace from an older sim)\n\n");
+
+    // where the waiting goes
+    int order[25];
+    for (int c = 0; c < 25; c++)
+        order[c] = c;
+    for (int x = 0; x < 25; x++)
+        for (int y = x + 1; y < 25; y++)
+            if (g[HM_DWELL][order[y]] > g[HM_DWELL][order[x]])
+            {
+                int t = order[x];
+                order[x] = order[y];
+                order[y] = t;
+            }
+    total /= ns;
+    printf("most time spent (of %.1f s per session):\n", total);
+    for (int x = 0; x < HM_TOP && g[HM_DWELL][order[x]] > 0.0; x++)
+    {
+        int c = order[x];
+        printf("  A%d F%d  %5.1f s (%4.1f%%)  %.2f steps  %.2f backtracks  %.2f wall hits\n", c / 5 + 1, c % 5 + 1,
+               g[HM_DWELL][c], total > 0.0 ? 100.0 * g[HM_DWELL][c] / total : 0.0, g[HM_STEPS][c], g[HM_BACK][c],
+               g[HM_WALL][c]);
+    }
+    return 0;
+}
+
+// REPLAY
+// the controller only sees the vitals and the clock, so a session's SENSE records are all it needs. the hooks
+// note what it commands instead of moving anything.
+typedef struct
+{
+    double now_ms;
+    int n_cmd;
+    int cmd_a[MAX_CMDS], cmd_f[MAX_CMDS];
+    int verbose;
+} Replay;
+
+static void replay_command_cell(void *ctx, int aIndex, int fIndex)
+{
+    Replay *r = ctx;
+    if (r->n_cmd < MAX_CMDS)
+    {
+        r->cmd_a[r->n_cmd] = aIndex;
+        r->cmd_f[r->n_cmd] = fIndex;
+    }
+    r->n_cmd++;
+}
+
+static void replay_log(void *ctx, const char *msg)
+{
+    Replay *r = ctx;
+    if (r->verbose)
+        printf("%s", msg);
+}
+
+static double replay_now_ms(void *ctx)
+{
+    return ((Replay *)ctx)->now_ms;
+}
+
+// 0 = the controller did exactly what the trace says, 1 = divergence (reported)
+static int replay_session(const Session *s, int verbose)
+{
+    const TraceEvent *ev = s->ev;
+    Replay r = {.now_ms = ev[0].t_ms, .verbose = verbose};
+    controller_hooks_t hooks = {replay_command_cell, replay_log, replay_now_ms, &r};
+    controller_t c;
+    controller_init(&c, &hooks);
+    c.thresholdBPM = ev[0].a;
+    static controller_mpc_t mpc;
+    c.policy = ev[0].k == 1 ? &policy_table : NULL;
+    c.mpc = ev[0].k == 2 ? &mpc : NULL;
+    controller_start(&c);
+
+    int steps = 0;
+    for (int i = 1; i < s->n; i++)
+    {
+        if (ev[i].type != TR_SENSE)
+            continue;
+
+        int bpm = ev[i].val & 0xFF, cry = (ev[i].val >> 8) & 0xFF;
+        r.now_ms = ev[i].t_ms;
+        r.n_cmd = 0;
+        controller_step(&c, bpm, cry);
+        steps++;
+
+        // what the trace says happened on this step: MOVEs until the DECISION record
+        int j = i + 1, n_move = 0;
+        for (; j < s->n && ev[j].type != TR_DECISION && ev[j].type != TR_SENSE; j++)
+        {
+            if (ev[j].type != TR_MOVE)
+                continue;
+            if (n_move >= r.n_cmd || n_move >= MAX_CMDS || r.cmd_a[n_move] != ev[j].a || r.cmd_f[n_move] != ev[j].f)
+            {
+                printf("seed %u step %d @%.3f s: trace moves to A%d F%d, controller ", s->ev[0].val, steps,
+                       ev[i].t_ms / 1000.0, ev[j].a + 1, ev[j].f + 1);
+                if (n_move < r.n_cmd && n_move < MAX_CMDS)
+                    printf("commands A%d F%d\n", r.cmd_a[n_move] + 1, r.cmd_f[n_move] + 1);
+                else
+                    printf("commands nothing\n");
+                return 1;
+            }
+            n_move++;
+        }
+        if (n_move != r.n_cmd)
+        {
+            printf("seed %u step %d @%.3f s: trace has %d move(s), controller commands %d\n", s->ev[0].val, steps,
+                   ev[i].t_ms / 1000.0, n_move, r.n_cmd);
+            return 1;
+        }
+        if (j >= s->n || ev[j].type != TR_DECISION)
+        {
+            printf("seed %u step %d: no DECISION record, trace is truncated\n", s->ev[0].val, steps);
+            return 1;
+        }
+
+        uint8_t k = (uint8_t)(c.lastMoveDir | c.probe << 2 | c.panic_mode << 4 | c.is_crying_activated << 5 |
+                              c.hit_wall << 6);
+        uint32_t period = (uint32_t)controller_step_period_ms(&c);
+        if (ev[j].a != c.curA || ev[j].f != c.curF || ev[j].k != k || ev[j].val != period)
+        {
+            printf("seed %u step %d @%.3f s: decision differs\n  trace:      ", s->ev[0].val, steps,
+                   ev[i].t_ms / 1000.0);
+            print_event(&ev[j]);
+            TraceEvent mine = {ev[j].t_ms, TR_DECISION, (uint8_t)c.curA, (uint8_t)c.curF, k, period};
+            printf("  controller: ");
+            print_event(&mine);
+            return 1;
+        }
+    }
+    if (verbose)
+        printf("seed %u: %d steps replayed, no divergence\n", s->ev[0].val, steps);
+    return 0;
+}
+
+static void usage(void)
+{
+    printf("usage: trace_tool dump FILE\n"
+           "       trace_tool summary FILE\n"
+           "       trace_tool heatmap FILE\n"
+           "       trace_tool replay FILE [--session N | --seed S] [-v]\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        usage();
+        return 1;
+    }
+    const char *cmd = argv[1], *path = argv[2];
+    int session = -1, verbose = 0;
+    long long seed = -1;
+    for (int i = 3; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--session") == 0 && v)
+            session = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoll(argv[++i], NULL, 0);
+        else if (strcmp(a, "-v") == 0)
+            verbose = 1;
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+
+    TraceEvent *ev;
+    int n;
+    if (trace_read(path, &ev, &n) != 0)
+    {
+        printf("[SYSTEM][ERROR] %s is not a trace file (version %d)\n", path, TRACE_VERSION);
+        return 1;
+    }
+
+    int rc = 0;
+    if (strcmp(cmd, "dump") == 0)
+    {
+        for (int i = 0; i < n; i++)
+            print_event(&ev[i]);
+    }
+    else if (strcmp(cmd, "summary") == 0 || strcmp(cmd, "heatmap") == 0 || strcmp(cmd, "replay") == 0)
+    {
+        Session *s;
+        int ns = split_sessions(ev, n, &s);
+        if (ns <= 0)
+        {
+            printf("no sessions in %s\n", path);
+            free(ev);
+            return 1;
+        }
+
+        if (strcmp(cmd, "summary") == 0)
+            rc = summary(s, ns);
+        else if (strcmp(cmd, "heatmap") == 0)
+            rc = heatmap(s, ns);
+        else
+        {
+            int checked = 0, diverged = 0;
+            for (int i = 0; i < ns; i++)
+            {
+                if ((session >= 0 && i != session) || (seed >= 0 && s[i].ev[0].val != (uint32_t)seed))
+                    continue;
+                checked++;
+                if (replay_session(&s[i], verbose))
+                {
+                    diverged++;
+                    break; // the first divergence is the interesting one
+                }
+            }
+            if (!checked)
+                printf("no matching session\n");
+            else if (!diverged)
+                printf("%d session(s) replayed, no divergence\n", checked);
+            rc = (!checked || diverged) ? 1 : 0;
+        }
+        free(s);
+    }
+    else
+    {
+        usage();
+        rc = 1;
+    }
+
+    free(ev);
+    return rc;
+}
@@ -0,0 +1,352 @@
+// tune.c — search the controller's hand-picked constants against the simulator
+// thresholdBPM, thresholdCRY, the crying regime switch (CRY_REGIME_BPM / CRY_REGIME_LEVEL), the panic jump
+// (PANIC_JUMP_BPM), the three step periods (HEARTBEAT_DELAY / CRYING_DELAY / CONVERGENCE_DELAY) and the
+// decision node's VITALS_POLL_MS. Two objectives: the expected time-to-calm (a session that never calms costs
+// FAIL_COST, as in policy_solver) and the panic rate (sessions with a plant panic or ending in controller panic
+// mode). There is no single best answer, so the result is the Pareto front of the two.
+//
+// Search: successive halving. Draw random candidates on each knob's grid (candidate 0 is the shipped set),
+// run all of them on a few sessions, keep the best 1/eta by Pareto rank (crowding distance breaks ties, so
+// the survivors spread along the front), multiply the sessions by eta and repeat until --keep are left. Every
+// candidate sees the same seeds, so they are compared on identical babies. The survivors and the shipped set
+// are then scored on a separate test set.
+//
+// The poll period goes in as SimParams.poll_ms (see run_controller): a step period that is not a multiple of it
+// steps on vitals that are period % poll_ms old. With HEARTBEAT_DELAY == TAU even a few ms of that means the
+// BPM read comes from before the last move.
+//
+// usage: tune [--candidates N] [--eta N] [--sessions N] [--keep N] [--test N] [--seed N] [--threads T]
+//             [--policy] [--lockstep] [--changepoint] [--tau S] [--convergence S] [--continuous]
+//             [--stress-tau S] [--sensor ideal|real] [sensor options, see sim.h]
+// build: gcc -O2 -pthread -o tune tune.c sim.c batch.c corpus.c trace.c lockstep.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+
+#define FAIL_COST 1200.0 // seconds charged for a session that never calms (as in policy_solver)
+#define TEST_SEED_OFFSET 1000000
+#define VITALS_POLL_MS 100 // decision/main.c
+
+typedef struct
+{
+    const char *name;
+    int lo, hi, step;
+    int def;
+} Knob;
+
+enum
+{
+    KN_THR_BPM,
+    KN_THR_CRY,
+    KN_CRY_BPM,
+    KN_CRY_LEVEL,
+    KN_JUMP,
+    KN_HB_DELAY,
+    KN_CRY_DELAY,
+    KN_CONV_DELAY,
+    KN_POLL,
+    N_KNOBS
+};
+
+static const Knob g_knob[N_KNOBS] = {
+    {"thrBPM", 2, 20, 1, 10},
+    {"thrCRY", 0, 10, 1, 1},
+    {"cryBPM", 120, 200, 5, CRY_REGIME_BPM},
+    {"cry%", 30, 80, 2, CRY_REGIME_LEVEL},
+    {"jump", 15, 60, 5, PANIC_JUMP_BPM},
+    {"hb_ms", 4000, 16000, 500, HEARTBEAT_DELAY},
+    {"cry_ms", 1000, 8000, 250, CRYING_DELAY},
+    {"conv_ms", 1000, 8000, 250, CONVERGENCE_DELAY},
+    {"poll_ms", 20, 1000, 20, VITALS_POLL_MS},
+};
+
+typedef struct
+{
+    int v[N_KNOBS];
+    double cost;  // mean time-to-calm, FAIL_COST for a session that never calmed
+    double panic; // fraction of sessions with a plant or controller panic
+    double calm;  // fraction that calmed
+    double ttc;   // mean time-to-calm of the calm ones
+    int rank;     // Pareto front it is on, 0 = non-dominated
+    double crowd; // crowding distance on its front
+} Cand;
+
+static SimParams g_base;
+static SimResult *g_res;
+static int g_lockstep;
+static long g_sessions;
+static SimWorld g_rng; // only its PRNG is used
+
+static int rand_below(int n)
+{
+    return (int)(sim_rand(&g_rng) % (uint32_t)n);
+}
+
+static void cand_params(const Cand *c, SimParams *p)
+{
+    *p = g_base;
+    p->thresholdBPM = c->v[KN_THR_BPM];
+    p->thresholdCRY = c->v[KN_THR_CRY];
+    p->consts.cry_bpm = c->v[KN_CRY_BPM];
+    p->consts.cry_level = c->v[KN_CRY_LEVEL];
+    p->consts.jump_bpm = c->v[KN_JUMP];
+    p->consts.hb_delay_ms = c->v[KN_HB_DELAY];
+    p->consts.cry_delay_ms = c->v[KN_CRY_DELAY];
+    p->consts.conv_delay_ms = c->v[KN_CONV_DELAY];
+    p->poll_ms = c->v[KN_POLL];
+}
+
+static int evaluate(Cand *c, int n, uint64_t seed, int threads)
+{
+    SimParams p;
+    cand_params(c, &p);
+    int rc = g_lockstep ? sim_lockstep_batch(&p, n, threads, seed, g_res) : sim_batch(&p, n, threads, seed, g_res);
+    if (rc != 0)
+        return -1;
+    g_sessions += n;
+
+    double cost = 0.0, ttc = 0.0;
+    int calm = 0, panicked = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (g_res[i].calm)
+        {
+            cost += g_res[i].calm_t;
+            ttc += g_res[i].calm_t;
+            calm++;
+        }
+        else
+            cost += FAIL_COST;
+        panicked += g_res[i].panics > 0 || g_res[i].ctrl_panic;
+    }
+    c->cost = cost / n;
+    c->panic = (double)panicked / n;
+    c->calm = (double)calm / n;
+    c->ttc = calm ? ttc / calm : 0.0;
+    return 0;
+}
+
+static int dominates(const Cand *a, const Cand *b)
+{
+    return a->cost <= b->cost && a->panic <= b->panic && (a->cost < b->cost || a->panic < b->panic);
+}
+
+static int cmp_cost(const Cand *x, const Cand *y)
+{
+    return (x->cost > y->cost) - (x->cost < y->cost);
+}
+
+static int cmp_cost_ptr(const void *a, const void *b)
+{
+    return cmp_cost(*(Cand *const *)a, *(Cand *const *)b);
+}
+
+static int cmp_cost_val(const void *a, const void *b)
+{
+    return cmp_cost(a, b);
+}
+
+// peel off the fronts one by one, then the crowding distance inside each (NSGA-II). n is small, O(n^3) is fine
+static void rank_fronts(Cand *c, int n)
+{
+    Cand **f = malloc((size_t)n * sizeof *f);
+    if (!f)
+        return;
+    for (int i = 0; i < n; i++)
+        c[i].rank = -1;
+    int left = n;
+    for (int r = 0; left > 0; r++)
+    {
+        int nf = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (c[i].rank >= 0)
+                continue;
+            int dom = 0;
+            for (int j = 0; j < n && !dom; j++)
+                dom = j != i && (c[j].rank < 0 || c[j].rank == r) && dominates(&c[j], &c[i]);
+            if (!dom)
+                f[nf++] = &c[i];
+        }
+        for (int i = 0; i < nf; i++)
+            f[i]->rank = r;
+        left -= nf;
+
+        // sorted by cost the front runs down in panic, so both objectives share the neighbours
+        qsort(f, (size_t)nf, sizeof *f, cmp_cost_ptr);
+        double dc = f[nf - 1]->cost - f[0]->cost, dp = f[0]->panic - f[nf - 1]->panic;
+        for (int i = 0; i < nf; i++)
+        {
+            if (i == 0 || i == nf - 1)
+            {
+                f[i]->crowd = 1e30;
+                continue;
+            }
+            f[i]->crowd = (dc > 0.0 ? (f[i + 1]->cost - f[i - 1]->cost) / dc : 0.0) +
+                          (dp > 0.0 ? (f[i - 1]->panic - f[i + 1]->panic) / dp : 0.0);
+        }
+    }
+    free(f);
+}
+
+// best first: lower front, then more room around it
+static int cmp_select(const void *a, const void *b)
+{
+    const Cand *x = a, *y = b;
+    if (x->rank != y->rank)
+        return x->rank - y->rank;
+    return (x->crowd < y->crowd) - (x->crowd > y->crowd);
+}
+
+static void print_cand(const Cand *c, const char *tag)
+{
+    printf("  %c", c->rank == 0 ? '*' : ' ');
+    for (int k = 0; k < N_KNOBS; k++)
+        printf(" %*d", (int)strlen(g_knob[k].name), c->v[k]);
+    printf("  %7.1f  %6.2f%%  %6.1f%%  %6.1f  %s\n", c->cost, 100.0 * c->panic, 100.0 * c->calm, c->ttc, tag);
+}
+
+static void print_head(void)
+{
+    printf("   ");
+    for (int k = 0; k < N_KNOBS; k++)
+        printf(" %s", g_knob[k].name);
+    printf("     cost    panic     calm     ttc\n");
+}
+
+int main(int argc, char **argv)
+{
+    sim_params_default(&g_base);
+    int n_cand = 81, eta = 3, sessions = 250, keep = 6, test = 20000, threads = 0, use_policy = 0;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (sim_sensor_option(&g_base.sensor, argc, argv, &i))
+            continue;
+        if (strcmp(a, "--candidates") == 0 && v)
+            n_cand = atoi(argv[++i]);
+        else if (strcmp(a, "--eta") == 0 && v)
+            eta = atoi(argv[++i]);
+        else if (strcmp(a, "--sessions") == 0 && v)
+            sessions = atoi(argv[++i]);
+        else if (strcmp(a, "--keep") == 0 && v)
+            keep = atoi(argv[++i]);
+        else if (strcmp(a, "--test") == 0 && v)
+            test = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--threads") == 0 && v)
+            threads = atoi(argv[++i]);
+        else if (strcmp(a, "--policy") == 0)
+            use_policy = 1;
+        else if (strcmp(a, "--lockstep") == 0)
+        {
+            g_lockstep = 1;
+            g_base.hist_mode = HIST_CHANGEPOINT;
+        }
+        else if (strcmp(a, "--changepoint") == 0)
+            g_base.hist_mode = HIST_CHANGEPOINT;
+        else if (strcmp(a, "--tau") == 0 && v)
+            g_base.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            g_base.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            g_base.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            g_base.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    if (n_cand < 1 || eta < 2 || sessions < 1 || keep < 1 || test < 1)
+        return 1;
+    const char *bad = sim_sensor_check(&g_base.sensor);
+    if (bad)
+    {
+        printf("%s\n", bad);
+        return 1;
+    }
+    if (use_policy)
+        g_base.policy = &policy_table; // the table has its own waits, the step periods do nothing there
+
+    // the largest batch: the last rung or the test set
+    long max_n = test;
+    int alive = n_cand;
+    for (long n = sessions; alive > 0; n *= eta)
+    {
+        if (n > max_n)
+            max_n = n;
+        if (alive <= keep)
+            break;
+        alive = (alive + eta - 1) / eta;
+        if (alive < keep)
+            alive = keep;
+    }
+    g_res = calloc((size_t)max_n, sizeof *g_res);
+    Cand *c = calloc((size_t)n_cand, sizeof *c);
+    if (!g_res || !c)
+        return 1;
+
+    sim_seed(&g_rng, seed);
+    for (int k = 0; k < N_KNOBS; k++)
+        c[0].v[k] = g_knob[k].def;
+    for (int i = 1; i < n_cand; i++)
+        for (int k = 0; k < N_KNOBS; k++)
+            c[i].v[k] = g_knob[k].lo + g_knob[k].step * rand_below((g_knob[k].hi - g_knob[k].lo) / g_knob[k].step + 1);
+
+    printf("tune: %d candidates, eta %d, %s controller, seeds %llu..\n", n_cand, eta, use_policy ? "policy" : "rules",
+           (unsigned long long)seed);
+    alive = n_cand;
+    for (long n = sessions;; n *= eta)
+    {
+        for (int i = 0; i < alive; i++)
+            if (evaluate(&c[i], (int)n, seed, threads) != 0)
+                return 1;
+        rank_fronts(c, alive);
+        qsort(c, (size_t)alive, sizeof *c, cmp_select);
+        int front = 0;
+        while (front < alive && c[front].rank == 0)
+            front++;
+        printf("rung: %3d candidates x %6ld sessions, %d on the front, best cost %.1f s, lowest panic %.2f%%\n",
+               alive, n, front, c[0].cost, 100.0 * c[0].panic);
+        if (alive <= keep)
+            break;
+        alive = (alive + eta - 1) / eta;
+        if (alive < keep)
+            alive = keep;
+    }
+
+    // held-out seeds: the survivors and the shipped constants, which may have been dropped on the way
+    Cand shipped = {0};
+    for (int k = 0; k < N_KNOBS; k++)
+        shipped.v[k] = g_knob[k].def;
+    int has_shipped = 0;
+    for (int i = 0; i < alive; i++)
+        has_shipped |= memcmp(c[i].v, shipped.v, sizeof shipped.v) == 0;
+    if (!has_shipped)
+        c[alive++] = shipped; // slot is free: alive < n_cand whenever a halving happened
+    for (int i = 0; i < alive; i++)
+        if (evaluate(&c[i], test, seed + TEST_SEED_OFFSET, threads) != 0)
+            return 1;
+    rank_fronts(c, alive);
+    qsort(c, (size_t)alive, sizeof *c, cmp_cost_val);
+
+    printf("\ntest set, %d sessions (* = on the Pareto front of time-to-calm cost vs panic rate):\n", test);
+    print_head();
+    for (int i = 0; i < alive; i++)
+        print_cand(&c[i], memcmp(c[i].v, shipped.v, sizeof shipped.v) == 0 ? "<- shipped" : "");
+    printf("%ld sessions in total\n", g_sessions);
+
+    free(c);
+    free(g_res);
+    return 0;
+}
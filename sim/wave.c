@@ -0,0 +1,75 @@
+// wave.c — raw sensor signals, as the nodes' ADC0 would see them
+// The plant only knows S. The real nodes never see S or even a BPM; they see volts: a photodiode trace with a
+// pulse per heartbeat and a microphone swinging around mid-rail. These are made up to look like that closely
+// enough for the nodes' detectors (threshold beat detection, 200 ms peak-to-peak windows) to have realistic
+// work to do, with a known truth underneath.
+//
+// PPG: a systolic peak and a smaller dicrotic bump per beat on a 1 V baseline, the baseline wandering with
+//      breathing, plus sample noise. The beat rate follows the bpm passed in, integrated as phase, so a rate
+//      change shows up smoothly like it would in a heart.
+// MIC: mid-rail (1.65 V) plus a cry tone whose amplitude follows the cry level, in breathing-paced bursts,
+//      on a small noise floor that is there even when the baby is quiet.
+
+#include <math.h>
+
+#include "sim.h"
+
+#define PPG_BASE 1.0   // volts
+#define PPG_PEAK 0.9   // systolic peak above the baseline, volts
+#define PPG_WANDER 0.05
+#define MIC_MID 1.65
+#define MIC_LOUD 0.5   // tone amplitude at cry 100, volts
+#define MIC_FLOOR 0.01 // noise sd with nobody crying, volts
+#define CRY_F0 437.0   // Hz, the cry's fundamental (aliases at the node's 200 Hz, which P2P does not mind)
+
+static uint32_t wave_rand(SimWave *g)
+{
+    uint64_t x = g->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    g->rng = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static double wave_gauss(SimWave *g)
+{
+    double u1 = (wave_rand(g) + 0.5) / 4294967296.0;
+    double u2 = (wave_rand(g) + 0.5) / 4294967296.0;
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+static double clamp_adc(double v)
+{
+    return v < 0.0 ? 0.0 : v > 3.3 ? 3.3 : v;
+}
+
+void wave_init(SimWave *g, uint64_t seed, double noise)
+{
+    g->phase = 0.0;
+    g->t_last = 0.0;
+    g->rng = seed * 0x9E3779B97F4A7C15ull + 1;
+    g->noise = noise;
+}
+
+double wave_ppg(SimWave *g, double t, double bpm)
+{
+    if (t > g->t_last)
+        g->phase += (t - g->t_last) * bpm / 60.0;
+    g->t_last = t;
+
+    double u = g->phase - floor(g->phase); // where in the beat we are, 0..1
+    double sys = (u - 0.15) / 0.05;
+    double dic = (u - 0.45) / 0.06;
+    double shape = exp(-0.5 * sys * sys) + 0.35 * exp(-0.5 * dic * dic);
+    double wander = PPG_WANDER * sin(6.283185307179586 * 0.25 * t);
+    return clamp_adc(PPG_BASE + PPG_PEAK * shape + wander + g->noise * wave_gauss(g));
+}
+
+double wave_mic(SimWave *g, double t, double cry)
+{
+    double burst = 0.85 + 0.15 * sin(6.283185307179586 * 0.8 * t);
+    double amp = MIC_LOUD * (cry / 100.0) * burst;
+    double tone = sin(6.283185307179586 * CRY_F0 * t) + 0.3 * sin(6.283185307179586 * 2.0 * CRY_F0 * t);
+    return clamp_adc(MIC_MID + amp * tone / 1.3 + (MIC_FLOOR + g->noise) * wave_gauss(g));
+}
@@ -0,0 +1,386 @@
+// wave_bench.c — the nodes' real signal processing against a known truth
+// Each session runs the plant, turns its true heart rate and cry level into ADC waveforms (wave.c) and feeds
+// them, sample by sample on a virtual clock, to the unmodified heartbeat_update() and cry_sampler_update()
+// (sim/host/node_*.c, after the crying node's own boot calibration). The decision node polls them every
+// VITALS_POLL_MS like decision/main.c and the controller steps on what they answered, so this is the whole
+// chain: plant -> signal -> node -> controller -> plant.
+//
+// Reported per signal:
+//   settled error   answer - truth, on polls where the truth has held for the node's whole averaging window
+//                   (10 beats for the heartbeat, plus SETTLE_S)
+//   step latency    from a change in the truth (more than the tolerance) until an answer is within tolerance
+// once on a scripted open-loop stress staircase (PROFILE, no controller) and once in the closed loop, followed by
+// the closed-loop outcome next to the same seeds with the ideal sensor (sim_run_session()). The staircase is
+// what measures the crying node: the closed loop hardly ever gets S below 50, and above that crying_of() is a
+// flat 100, so its truth never steps there.
+//
+// usage: wave_bench [--sessions N] [--seed N] [--rules] [--noise V] [--tau S] [--convergence S]
+//                   [--threshold-bpm N] [--continuous] [--stress-tau S]
+// build: gcc -O2 -pthread -Ihost -o wave_bench wave_bench.c wave.c sim.c batch.c corpus.c trace.c lockstep.c
+//            host/libpynq.c host/node_heartbeat.c host/node_crying.c ../decision/controller.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sim.h"
+#include "../decision/policy_table.h"
+#include "host/libpynq.h"
+#include "host/nodes.h"
+
+#define TICK_MS 2           // the crying node's loop period; it samples on its own 5 ms gate
+#define HB_EVERY 10         // heartbeat node loop: every 20 ms
+#define POLL_MS 100         // VITALS_POLL_MS in decision/main.c
+#define WARMUP_S 10.0       // the nodes run a while before the controller starts
+#define SETTLE_S 1.0
+#define TOL_BPM 3.0
+#define TOL_CRY 5.0
+
+// the open-loop pass: S set to each level in turn and held PROFILE_HOLD_S, long enough for TAU, the 10-beat
+// window and SETTLE_S. Crosses 50 both ways and steps the cry truth by 12-100 points, the BPM by 27-108
+static const double PROFILE[] = {80, 45, 30, 15, 40, 25, 60, 35, 10, 70};
+#define PROFILE_LEVELS (int)(sizeof PROFILE / sizeof PROFILE[0])
+#define PROFILE_HOLD_S 20.0
+
+// what the ADC source reads: the plant, right now
+typedef struct
+{
+    SimWorld *w;
+    SimWave ppg, mic;
+    int cal; // -1 = calibrating quiet, 1 = calibrating loud, 0 = the plant
+} Signals;
+
+static double true_bpm(const SimWorld *w)
+{
+    return sim_bpm_of(w, stress_delayed(w, now_sec(w), w->TAU)); // get_heartbeat() without touching the world
+}
+
+// one node reads at a time, the harness says which before it calls into a node
+static int g_reading_hb;
+
+static float adc_read(int channel, void *ctx)
+{
+    Signals *s = ctx;
+    double t = libpynq_host_time_ms() / 1000.0;
+    if (channel != ADC0)
+        return 0.0f;
+    if (s->cal)
+        return (float)wave_mic(&s->mic, t, s->cal > 0 ? 100.0 : 0.0);
+    if (g_reading_hb)
+        return (float)wave_ppg(&s->ppg, t, true_bpm(s->w));
+    return (float)wave_mic(&s->mic, t, get_crying(s->w));
+}
+
+static void cal_quiet(void *ctx)
+{
+    ((Signals *)ctx)->cal = -1;
+}
+
+static void cal_loud(void *ctx)
+{
+    ((Signals *)ctx)->cal = 1;
+}
+
+// one signal's error and latency bookkeeping
+typedef struct
+{
+    double tol;
+    double truth_ref, t_change; // truth when the last change was noticed
+    int pending;                // waiting for an answer within tolerance
+    double err_sum, abs_sum;
+    double *abs_err;
+    int n_err, cap_err;
+    double *lat;
+    int n_lat, cap_lat, missed;
+} Track;
+
+static void push(double **v, int *n, int *cap, double x)
+{
+    if (*n == *cap)
+    {
+        *cap = *cap ? 2 * *cap : 1024;
+        *v = realloc(*v, (size_t)*cap * sizeof **v);
+        if (!*v)
+            exit(1);
+    }
+    (*v)[(*n)++] = x;
+}
+
+// window: how long the node needs to see a new value in full, seconds
+static void track_poll(Track *k, double t, double truth, double answer, double window)
+{
+    if (fabs(truth - k->truth_ref) > k->tol)
+    {
+        if (k->pending)
+            k->missed++; // superseded before the node caught up
+        k->truth_ref = truth;
+        k->t_change = t;
+        k->pending = 1;
+    }
+    if (k->pending && fabs(answer - truth) <= k->tol)
+    {
+        push(&k->lat, &k->n_lat, &k->cap_lat, t - k->t_change);
+        k->pending = 0;
+    }
+    if (t - k->t_change >= window + SETTLE_S)
+    {
+        k->err_sum += answer - truth;
+        k->abs_sum += fabs(answer - truth);
+        push(&k->abs_err, &k->n_err, &k->cap_err, fabs(answer - truth));
+    }
+}
+
+static void track_session_end(Track *k)
+{
+    if (k->pending)
+        k->missed++;
+    k->pending = 0;
+}
+
+static void track_report(const char *name, const char *unit, Track *k)
+{
+    printf("%-10s settled error  bias %+6.2f  mae %5.2f  p95 %5.2f %s  (%d polls)\n", name,
+           k->n_err ? k->err_sum / k->n_err : 0.0, k->n_err ? k->abs_sum / k->n_err : 0.0,
+           k->n_err ? sim_percentile(k->abs_err, k->n_err, 0.95) : 0.0, unit, k->n_err);
+    printf("%-10s step latency   median %5.2f s  p95 %5.2f s  (%d steps, %d never within %.0f %s)\n", "",
+           k->n_lat ? sim_percentile(k->lat, k->n_lat, 0.50) : 0.0,
+           k->n_lat ? sim_percentile(k->lat, k->n_lat, 0.95) : 0.0, k->n_lat, k->missed, k->tol, unit);
+}
+
+// one session's plant, waveforms and nodes, stepped TICK_MS at a time
+typedef struct
+{
+    SimWorld w;
+    Signals sig;
+    double clock0; // node clock at plant t = 0
+    double next_poll;
+    long tick;
+    int bpm, cry; // the nodes' last answers
+} Rig;
+
+static int rig_start(Rig *r, const SimParams *p, uint64_t seed, double noise, Track *hb, Track *cry)
+{
+    // 2 ms ticks: a dense history would not reach TAU back (see ring.c), so change points
+    SimParams q = *p;
+    q.hist_mode = HIST_CHANGEPOINT;
+    if (sim_world_init(&r->w, seed) != 0 || sim_world_apply(&r->w, &q) != 0)
+    {
+        sim_world_free(&r->w);
+        return -1;
+    }
+    r->w.verbose = 0;
+    sim_session_start(&r->w, NULL);
+
+    r->sig.w = &r->w;
+    r->sig.cal = 0;
+    wave_init(&r->sig.ppg, seed, noise);
+    wave_init(&r->sig.mic, seed ^ 0xC0FFEEull, noise);
+    libpynq_host_adc_source(adc_read, &r->sig);
+
+    // the crying node boots (and calibrates) on its own clock, before the plant starts. that clock carries on
+    // from the last session: the nodes' statics do too, and heartbeat_update() times beats against it
+    libpynq_host_virtual_clock(libpynq_host_time_ms());
+    node_crying_calibrate(cal_quiet, cal_loud, &r->sig);
+    r->sig.cal = 0;
+    r->clock0 = libpynq_host_time_ms();
+
+    r->next_poll = 0.0;
+    r->tick = 0;
+    r->bpm = r->cry = 0;
+    hb->truth_ref = true_bpm(&r->w);
+    cry->truth_ref = get_crying(&r->w);
+    hb->t_change = cry->t_change = 0.0;
+    return 0;
+}
+
+// sample the nodes at plant time now, poll them when a poll is due (tracked once WARMUP_S is over)
+static void rig_sample(Rig *r, Track *hb, Track *cry)
+{
+    double t = now_sec(&r->w);
+    double t_ms = r->clock0 + t * 1000.0;
+    libpynq_host_virtual_clock(t_ms);
+
+    if (r->tick++ % HB_EVERY == 0)
+    {
+        g_reading_hb = 1;
+        node_heartbeat_sample(t_ms);
+        g_reading_hb = 0;
+    }
+    node_crying_sample();
+
+    if (t >= r->next_poll)
+    {
+        r->next_poll += POLL_MS / 1000.0;
+        r->bpm = node_heartbeat_bpm();
+        r->cry = node_crying_level();
+        if (t >= WARMUP_S)
+        {
+            double truth = true_bpm(&r->w);
+            track_poll(hb, t, truth, r->bpm, 10.0 * 60.0 / truth);
+            track_poll(cry, t, get_crying(&r->w), r->cry, 0.2);
+        }
+    }
+}
+
+static void rig_end(Rig *r, Track *hb, Track *cry)
+{
+    track_session_end(hb);
+    track_session_end(cry);
+    sim_world_free(&r->w);
+}
+
+// one open-loop pass over PROFILE: no controller, the stress is set by hand
+static int run_profile(const SimParams *p, uint64_t seed, double noise, Track *hb, Track *cry)
+{
+    Rig r;
+    if (rig_start(&r, p, seed, noise, hb, cry) != 0)
+        return -1;
+    for (int i = 0; i < PROFILE_LEVELS; i++)
+    {
+        r.w.S = PROFILE[i];
+        record_stress_sample(&r.w, now_sec(&r.w), r.w.S);
+        double until = WARMUP_S + (i + 1) * PROFILE_HOLD_S;
+        while (now_sec(&r.w) < until)
+        {
+            rig_sample(&r, hb, cry);
+            advance_time(&r.w, TICK_MS / 1000.0);
+        }
+    }
+    rig_end(&r, hb, cry);
+    return 0;
+}
+
+// one closed-loop session through the nodes' code. returns 0 and fills out like sim_run_session()
+static int run_session(const SimParams *p, uint64_t seed, double noise, Track *hb, Track *cry, SimResult *out)
+{
+    Rig r;
+    if (rig_start(&r, p, seed, noise, hb, cry) != 0)
+        return -1;
+    SimWorld *w = &r.w;
+    controller_t *c = &w->ctrl;
+    int started = 0, steps = 0;
+    double next_step = WARMUP_S;
+
+    for (;;)
+    {
+        double t = now_sec(w);
+        rig_sample(&r, hb, cry);
+
+        if (t >= next_step)
+        {
+            if (!started)
+            {
+                controller_start(c);
+                started = 1;
+            }
+            controller_step(c, r.bpm, r.cry);
+            steps++;
+            if (c->calm_reached)
+            {
+                if (in_range(w, 1, w->S))
+                    w->calm_t = c->calm_elapsed_ms / 1000.0;
+                break;
+            }
+            if (c->panic_mode || steps >= SIM_MAX_STEPS)
+                break;
+            next_step = t + controller_step_period_ms(c) / 1000.0;
+        }
+        advance_time(w, TICK_MS / 1000.0);
+    }
+
+    out->calm = w->calm_t >= 0.0;
+    out->calm_t = w->calm_t;
+    out->moves = w->moves;
+    out->panics = w->panics;
+    out->ctrl_panic = c->panic_mode;
+    rig_end(&r, hb, cry);
+    return 0;
+}
+
+static void track_free(Track *k)
+{
+    free(k->abs_err);
+    free(k->lat);
+}
+
+int main(int argc, char **argv)
+{
+    SimParams p;
+    sim_params_default(&p);
+    p.policy = &policy_table;
+    int n = 20;
+    uint64_t seed = 1;
+    double noise = 0.01;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--sessions") == 0 && v)
+            n = atoi(argv[++i]);
+        else if (strcmp(a, "--seed") == 0 && v)
+            seed = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--rules") == 0)
+            p.policy = NULL;
+        else if (strcmp(a, "--noise") == 0 && v)
+            noise = atof(argv[++i]);
+        else if (strcmp(a, "--threshold-bpm") == 0 && v)
+            p.thresholdBPM = atoi(argv[++i]);
+        else if (strcmp(a, "--tau") == 0 && v)
+            p.TAU = atof(argv[++i]);
+        else if (strcmp(a, "--convergence") == 0 && v)
+            p.convergence_time = atof(argv[++i]);
+        else if (strcmp(a, "--continuous") == 0)
+            p.stress_model = STRESS_EXP;
+        else if (strcmp(a, "--stress-tau") == 0 && v)
+            p.stress_tau = atof(argv[++i]);
+        else
+        {
+            printf("unknown option %s\n", a);
+            return 1;
+        }
+    }
+    if (n <= 0)
+        return 1;
+
+    printf("wave_bench: %d sessions, seeds %llu.., %s, ADC noise %.3f V\n", n, (unsigned long long)seed,
+           p.policy ? "policy" : "rules", noise);
+
+    Track hb_o = {.tol = TOL_BPM}, cry_o = {.tol = TOL_CRY}; // open loop
+    Track hb = {.tol = TOL_BPM}, cry = {.tol = TOL_CRY};
+    int calm_w = 0, calm_i = 0;
+    double ttc_w = 0.0, ttc_i = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        SimResult rw, ri;
+        if (run_profile(&p, seed + (uint64_t)i, noise, &hb_o, &cry_o) != 0 ||
+            run_session(&p, seed + (uint64_t)i, noise, &hb, &cry, &rw) != 0 ||
+            sim_run_session(&p, seed + (uint64_t)i, 0, &ri) != 0)
+        {
+            printf("[SYSTEM][ERROR] could not run a session\n");
+            return 1;
+        }
+        calm_w += rw.calm;
+        ttc_w += rw.calm ? rw.calm_t : 0.0;
+        calm_i += ri.calm;
+        ttc_i += ri.calm ? ri.calm_t : 0.0;
+    }
+
+    printf("open loop, stress");
+    for (int i = 0; i < PROFILE_LEVELS; i++)
+        printf(" %.0f", PROFILE[i]);
+    printf(" held %.0f s each\n", PROFILE_HOLD_S);
+    track_report("heartbeat", "BPM", &hb_o);
+    track_report("crying", "%", &cry_o);
+    printf("closed loop, %s in charge\n", p.policy ? "policy" : "rules");
+    track_report("heartbeat", "BPM", &hb);
+    track_report("crying", "%", &cry);
+    printf("closed loop   calm %d/%d, mean time-to-calm %.1f s   (ideal sensors: %d/%d, %.1f s)\n", calm_w, n,
+           calm_w ? ttc_w / calm_w : 0.0, calm_i, n, calm_i ? ttc_i / calm_i : 0.0);
+    track_free(&hb_o);
+    track_free(&cry_o);
+    track_free(&hb);
+    track_free(&cry);
+    return 0;
+}